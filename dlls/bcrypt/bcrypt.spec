@@ -5,6 +5,7 @@
 @ stub BCryptConfigureContextFunction
 @ stub BCryptCreateContext
 @ stdcall BCryptCreateHash(ptr ptr ptr long ptr long long)
+@ stdcall BCryptCreateMultiHash(ptr ptr long ptr long ptr long long)
 @ stdcall BCryptDecrypt(ptr ptr long ptr ptr long ptr long ptr long)
 @ stub BCryptDeleteContext
 @ stdcall BCryptDeriveKey(ptr wstr ptr ptr long ptr long)
@@ -36,6 +37,7 @@
 @ stdcall BCryptImportKey(ptr ptr wstr ptr ptr long ptr long long)
 @ stdcall BCryptImportKeyPair(ptr ptr wstr ptr ptr long long)
 @ stdcall BCryptOpenAlgorithmProvider(ptr wstr wstr long)
+@ stdcall BCryptProcessMultiOperations(ptr long ptr long long)
 @ stub BCryptQueryContextConfiguration
 @ stub BCryptQueryContextFunctionConfiguration
 @ stub BCryptQueryContextFunctionProperty
@@ -41,6 +41,7 @@ typedef struct
 
 void sha256_init(SHA256_CTX *ctx) DECLSPEC_HIDDEN;
 void sha256_update(SHA256_CTX *ctx, const UCHAR *buffer, ULONG len) DECLSPEC_HIDDEN;
+void sha256_update_multi(SHA256_CTX **ctx, const UCHAR **input, const ULONG *len, ULONG count) DECLSPEC_HIDDEN;
 void sha256_finalize(SHA256_CTX *ctx, UCHAR *buffer) DECLSPEC_HIDDEN;
 
 typedef struct
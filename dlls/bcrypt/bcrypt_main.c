@@ -219,7 +219,7 @@ NTSTATUS WINAPI BCryptGenRandom(BCRYPT_ALG_HANDLE handle, UCHAR *buffer, ULONG c
 NTSTATUS WINAPI BCryptOpenAlgorithmProvider( BCRYPT_ALG_HANDLE *handle, const WCHAR *id, const WCHAR *implementation,
                                              DWORD flags )
 {
-    const DWORD supported_flags = BCRYPT_ALG_HANDLE_HMAC_FLAG | BCRYPT_HASH_REUSABLE_FLAG;
+    const DWORD supported_flags = BCRYPT_ALG_HANDLE_HMAC_FLAG | BCRYPT_HASH_REUSABLE_FLAG | BCRYPT_MULTI_FLAG;
     struct algorithm *alg;
     enum alg_id alg_id;
     ULONG i;
@@ -422,6 +422,7 @@ static NTSTATUS hash_finish( struct hash_impl *hash, enum alg_id alg_id,
 
 #define HASH_FLAG_HMAC      0x01
 #define HASH_FLAG_REUSABLE  0x02
+#define HASH_FLAG_MULTI     0x04
 struct hash
 {
     struct object     hdr;
@@ -431,6 +432,8 @@ struct hash
     ULONG             secret_len;
     struct hash_impl  outer;
     struct hash_impl  inner;
+    struct hash     **elements;  /* states of a multi-hash object */
+    ULONG             element_count;
 };
 
 #define BLOCK_LENGTH_3DES       8
@@ -450,6 +453,22 @@ static NTSTATUS generic_alg_property( enum alg_id id, const WCHAR *prop, UCHAR *
         return STATUS_SUCCESS;
     }
 
+    if (!wcscmp( prop, BCRYPT_MULTI_OBJECT_LENGTH ))
+    {
+        BCRYPT_MULTI_OBJECT_LENGTH_STRUCT *multi = (void *)buf;
+        if (!builtin_algorithms[id].hash_length)
+            return STATUS_NOT_SUPPORTED;
+        *ret_size = sizeof(*multi);
+        if (size < sizeof(*multi))
+            return STATUS_BUFFER_TOO_SMALL;
+        if (multi)
+        {
+            multi->cbPerObject = builtin_algorithms[id].object_length;
+            multi->cbPerElement = builtin_algorithms[id].object_length;
+        }
+        return STATUS_SUCCESS;
+    }
+
     if (!wcscmp( prop, BCRYPT_HASH_LENGTH ))
     {
         if (!builtin_algorithms[id].hash_length)
@@ -898,6 +917,11 @@ NTSTATUS WINAPI BCryptDuplicateHash( BCRYPT_HASH_HANDLE handle, BCRYPT_HASH_HAND
     if (!hash_orig || hash_orig->hdr.magic != MAGIC_HASH) return STATUS_INVALID_HANDLE;
     if (!handle_copy) return STATUS_INVALID_PARAMETER;
     if (object) FIXME( "ignoring object buffer\n" );
+    if (hash_orig->flags & HASH_FLAG_MULTI)
+    {
+        FIXME( "duplicating multi-hash objects not supported\n" );
+        return STATUS_NOT_IMPLEMENTED;
+    }
 
     if (!(hash_copy = malloc( sizeof(*hash_copy) ))) return STATUS_NO_MEMORY;
 
@@ -915,8 +939,12 @@ NTSTATUS WINAPI BCryptDuplicateHash( BCRYPT_HASH_HANDLE handle, BCRYPT_HASH_HAND
 
 static void hash_destroy( struct hash *hash )
 {
+    ULONG i;
+
     if (!hash) return;
     hash->hdr.magic = 0;
+    for (i = 0; i < hash->element_count; i++) hash_destroy( hash->elements[i] );
+    free( hash->elements );
     free( hash->secret );
     free( hash );
 }
@@ -939,6 +967,7 @@ NTSTATUS WINAPI BCryptHashData( BCRYPT_HASH_HANDLE handle, UCHAR *input, ULONG s
     TRACE( "%p, %p, %lu, %#lx\n", handle, input, size, flags );
 
     if (!hash || hash->hdr.magic != MAGIC_HASH) return STATUS_INVALID_HANDLE;
+    if (hash->flags & HASH_FLAG_MULTI) return STATUS_INVALID_PARAMETER;
     if (!input) return STATUS_SUCCESS;
 
     return hash_update( &hash->inner, hash->alg_id, input, size );
@@ -973,11 +1002,122 @@ NTSTATUS WINAPI BCryptFinishHash( BCRYPT_HASH_HANDLE handle, UCHAR *output, ULON
     TRACE( "%p, %p, %lu, %#lx\n", handle, output, size, flags );
 
     if (!hash || hash->hdr.magic != MAGIC_HASH) return STATUS_INVALID_HANDLE;
-    if (!output) return STATUS_INVALID_PARAMETER;
+    if (!output || (hash->flags & HASH_FLAG_MULTI)) return STATUS_INVALID_PARAMETER;
 
     return hash_finalize( hash, output, size );
 }
 
+NTSTATUS WINAPI BCryptCreateMultiHash( BCRYPT_ALG_HANDLE algorithm, BCRYPT_HASH_HANDLE *handle, ULONG count,
+                                       UCHAR *object, ULONG object_len, UCHAR *secret, ULONG secret_len,
+                                       ULONG flags )
+{
+    struct algorithm *alg = algorithm;
+    struct hash *hash;
+    NTSTATUS status;
+    ULONG i;
+
+    TRACE( "%p, %p, %lu, %p, %lu, %p, %lu, %#lx\n", algorithm, handle, count, object, object_len, secret,
+           secret_len, flags );
+    if (flags & ~BCRYPT_HASH_REUSABLE_FLAG)
+    {
+        FIXME( "unimplemented flags %#lx\n", flags );
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+    if (!alg || alg->hdr.magic != MAGIC_ALG) return STATUS_INVALID_HANDLE;
+    if (!handle || !count || !(alg->flags & BCRYPT_MULTI_FLAG)) return STATUS_INVALID_PARAMETER;
+    if (object) FIXME( "ignoring object buffer\n" );
+
+    if (!(hash = calloc( 1, sizeof(*hash) ))) return STATUS_NO_MEMORY;
+    hash->hdr.magic = MAGIC_HASH;
+    hash->alg_id    = alg->id;
+    hash->flags     = HASH_FLAG_MULTI;
+    if (!(hash->elements = calloc( count, sizeof(*hash->elements) )))
+    {
+        free( hash );
+        return STATUS_NO_MEMORY;
+    }
+    hash->element_count = count;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((status = hash_create( alg, secret, secret_len, flags, &hash->elements[i] )))
+        {
+            hash_destroy( hash );
+            return status;
+        }
+    }
+
+    *handle = hash;
+    return STATUS_SUCCESS;
+}
+
+/* Run the operations in order, except that consecutive SHA-256 updates of
+ * distinct states are hashed side by side. */
+static NTSTATUS hash_multi_operations( struct hash *hash, const BCRYPT_MULTI_HASH_OPERATION *ops, ULONG count )
+{
+    SHA256_CTX *ctx[32];
+    const UCHAR *input[32];
+    ULONG len[32], pending = 0, i, j;
+    NTSTATUS status = STATUS_SUCCESS;
+
+    for (i = 0; i < count && !status; i++)
+    {
+        struct hash *element = hash->elements[ops[i].iHash];
+
+        if (ops[i].hashOperation == BCRYPT_HASH_OPERATION_HASH_DATA && hash->alg_id == ALG_ID_SHA256)
+        {
+            for (j = 0; j < pending; j++) if (ctx[j] == &element->inner.u.sha256) break;
+            if (j < pending || pending == ARRAY_SIZE(ctx))
+            {
+                sha256_update_multi( ctx, input, len, pending );
+                pending = 0;
+            }
+            if (!ops[i].pbBuffer) continue;
+            ctx[pending] = &element->inner.u.sha256;
+            input[pending] = ops[i].pbBuffer;
+            len[pending++] = ops[i].cbBuffer;
+            continue;
+        }
+
+        if (pending) sha256_update_multi( ctx, input, len, pending );
+        pending = 0;
+
+        if (ops[i].hashOperation == BCRYPT_HASH_OPERATION_HASH_DATA)
+        {
+            if (ops[i].pbBuffer) status = hash_update( &element->inner, hash->alg_id, ops[i].pbBuffer, ops[i].cbBuffer );
+        }
+        else if (!ops[i].pbBuffer) status = STATUS_INVALID_PARAMETER;
+        else status = hash_finalize( element, ops[i].pbBuffer, ops[i].cbBuffer );
+    }
+
+    if (pending) sha256_update_multi( ctx, input, len, pending );
+    return status;
+}
+
+NTSTATUS WINAPI BCryptProcessMultiOperations( BCRYPT_HANDLE handle, BCRYPT_MULTI_OPERATION_TYPE type, void *operations,
+                                              ULONG size, ULONG flags )
+{
+    struct hash *hash = handle;
+    const BCRYPT_MULTI_HASH_OPERATION *ops = operations;
+    ULONG i, count = size / sizeof(*ops);
+
+    TRACE( "%p, %u, %p, %lu, %#lx\n", handle, type, operations, size, flags );
+
+    if (!hash || hash->hdr.magic != MAGIC_HASH || !(hash->flags & HASH_FLAG_MULTI)) return STATUS_INVALID_HANDLE;
+    if (type != BCRYPT_OPERATION_TYPE_HASH || flags) return STATUS_INVALID_PARAMETER;
+    if (!ops || !count || size % sizeof(*ops)) return STATUS_INVALID_PARAMETER;
+
+    for (i = 0; i < count; i++)
+    {
+        if (ops[i].iHash >= hash->element_count) return STATUS_INVALID_PARAMETER;
+        if (ops[i].hashOperation != BCRYPT_HASH_OPERATION_HASH_DATA &&
+            ops[i].hashOperation != BCRYPT_HASH_OPERATION_FINISH_HASH) return STATUS_INVALID_PARAMETER;
+    }
+
+    return hash_multi_operations( hash, ops, count );
+}
+
 NTSTATUS WINAPI BCryptHash( BCRYPT_ALG_HANDLE algorithm, UCHAR *secret, ULONG secret_len,
                             UCHAR *input, ULONG input_len, UCHAR *output, ULONG output_len )
 {
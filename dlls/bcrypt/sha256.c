@@ -22,6 +22,15 @@
 
 #include "bcrypt_internal.h"
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <intrin.h>
+#include <immintrin.h>
+#define USE_SHA_NI
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_SHA2)
+#include <arm_neon.h>
+#define USE_SHA_ARM
+#endif
+
 static DWORD ror(DWORD n, int k) { return (n >> k) | (n << (32-k)); }
 #define Ch(x,y,z)  (z ^ (x & (y ^ z)))
 #define Maj(x,y,z) ((x & y) | (z & (x | y)))
@@ -91,6 +100,286 @@ static void processblock(SHA256_CTX *ctx, const UCHAR *buffer)
     ctx->h[7] += h;
 }
 
+#ifdef USE_SHA_NI
+
+static __attribute__((target("sha,sse4.1"))) void processblocks_sha_ni(SHA256_CTX *ctx, const UCHAR *buffer, ULONG count)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, abef, cdgh, tmp, msg[4];
+    int i;
+
+    /* the instructions want the state as ABEF and CDGH */
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&ctx->h[0]), 0xb1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&ctx->h[4]), 0x1b);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+    for (; count; count--, buffer += 64)
+    {
+        abef = state0;
+        cdgh = state1;
+
+        for (i = 0; i < 16; i++)
+        {
+            if (i < 4)
+                msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buffer + 16 * i)), mask);
+            else
+                msg[i & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]),
+                        _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4)), msg[(i + 3) & 3]);
+            tmp = _mm_add_epi32(msg[i & 3], _mm_loadu_si128((const __m128i *)&K[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, tmp);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(tmp, 0x0e));
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);
+    state1 = _mm_shuffle_epi32(state1, 0xb1);
+    _mm_storeu_si128((__m128i *)&ctx->h[0], _mm_blend_epi16(tmp, state1, 0xf0));
+    _mm_storeu_si128((__m128i *)&ctx->h[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+
+static BOOL use_sha_ni(void)
+{
+    static int supported = -1;
+    int regs[4];
+
+    if (supported == -1)
+    {
+        __cpuid(regs, 0);
+        if (regs[0] < 7) supported = 0;
+        else
+        {
+            __cpuidex(regs, 7, 0);
+            supported = (regs[1] >> 29) & 1; /* SHA */
+            __cpuid(regs, 1);
+            supported &= (regs[2] >> 9) & (regs[2] >> 19) & 1; /* SSSE3, SSE4.1 */
+        }
+    }
+    return supported;
+}
+
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+static BOOL use_avx2(void)
+{
+    static int supported = -1;
+    int regs[4];
+
+    if (supported == -1)
+    {
+        __cpuid(regs, 0);
+        if (regs[0] < 7) supported = 0;
+        else
+        {
+            __cpuidex(regs, 7, 0);
+            supported = (regs[1] >> 5) & 1; /* AVX2 */
+            __cpuid(regs, 1);
+            supported &= (regs[2] >> 27) & 1; /* OSXSAVE */
+            if (supported)
+            {
+                unsigned int xcr0_lo, xcr0_hi;
+                __asm__ __volatile__( "xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0) );
+                supported = (xcr0_lo & 6) == 6; /* XMM and YMM state */
+            }
+        }
+    }
+    return supported;
+}
+
+/* transpose eight rows of eight 32-bit words, the rows being the lanes */
+static AVX2_TARGET void transpose_8x8(__m256i r[8])
+{
+    __m256i t[8], u[8];
+    int i;
+
+    for (i = 0; i < 8; i += 2)
+    {
+        t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (i = 0; i < 8; i += 4)
+    {
+        u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (i = 0; i < 4; i++)
+    {
+        r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+#define VROR(x,k) _mm256_or_si256(_mm256_srli_epi32(x, k), _mm256_slli_epi32(x, 32 - (k)))
+#define VS0(x)    _mm256_xor_si256(_mm256_xor_si256(VROR(x,2), VROR(x,13)), VROR(x,22))
+#define VS1(x)    _mm256_xor_si256(_mm256_xor_si256(VROR(x,6), VROR(x,11)), VROR(x,25))
+#define VR0(x)    _mm256_xor_si256(_mm256_xor_si256(VROR(x,7), VROR(x,18)), _mm256_srli_epi32(x,3))
+#define VR1(x)    _mm256_xor_si256(_mm256_xor_si256(VROR(x,17), VROR(x,19)), _mm256_srli_epi32(x,10))
+
+/* Process the same number of blocks of eight independent streams, one
+ * stream per 32-bit lane. */
+static AVX2_TARGET void processblocks_x8(SHA256_CTX *ctx[8], const UCHAR *data[8], ULONG count)
+{
+    const __m256i bswap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+                                            0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m256i state[8], v[8], W[16], t1, t2;
+    ULONG offset;
+    int i, j;
+
+    for (j = 0; j < 8; j++) state[j] = _mm256_loadu_si256((const __m256i *)ctx[j]->h);
+    transpose_8x8(state);
+
+    for (offset = 0; count; count--, offset += 64)
+    {
+        for (i = 0; i < 16; i += 8)
+        {
+            for (j = 0; j < 8; j++) W[i + j] = _mm256_loadu_si256((const __m256i *)(data[j] + offset + 4 * i));
+            transpose_8x8(W + i);
+            for (j = 0; j < 8; j++) W[i + j] = _mm256_shuffle_epi8(W[i + j], bswap);
+        }
+
+        for (j = 0; j < 8; j++) v[j] = state[j];
+
+        for (i = 0; i < 64; i++)
+        {
+            if (i >= 16)
+                W[i & 15] = _mm256_add_epi32(_mm256_add_epi32(VR1(W[(i - 2) & 15]), W[(i - 7) & 15]),
+                                             _mm256_add_epi32(VR0(W[(i - 15) & 15]), W[i & 15]));
+            /* h + S1(e) + Ch(e,f,g) + K[i] + W[i] */
+            t1 = _mm256_add_epi32(_mm256_add_epi32(v[7], VS1(v[4])),
+                                  _mm256_xor_si256(v[6], _mm256_and_si256(v[4], _mm256_xor_si256(v[5], v[6]))));
+            t1 = _mm256_add_epi32(t1, _mm256_add_epi32(_mm256_set1_epi32(K[i]), W[i & 15]));
+            /* S0(a) + Maj(a,b,c) */
+            t2 = _mm256_add_epi32(VS0(v[0]), _mm256_or_si256(_mm256_and_si256(v[0], v[1]),
+                                  _mm256_and_si256(v[2], _mm256_or_si256(v[0], v[1]))));
+            v[7] = v[6];
+            v[6] = v[5];
+            v[5] = v[4];
+            v[4] = _mm256_add_epi32(v[3], t1);
+            v[3] = v[2];
+            v[2] = v[1];
+            v[1] = v[0];
+            v[0] = _mm256_add_epi32(t1, t2);
+        }
+
+        for (j = 0; j < 8; j++) state[j] = _mm256_add_epi32(state[j], v[j]);
+    }
+
+    transpose_8x8(state);
+    for (j = 0; j < 8; j++) _mm256_storeu_si256((__m256i *)ctx[j]->h, state[j]);
+}
+
+#elif defined(USE_SHA_ARM)
+
+static void processblocks_sha_arm(SHA256_CTX *ctx, const UCHAR *buffer, ULONG count)
+{
+    uint32x4_t state0, state1, abcd, save0, save1, tmp, msg[4];
+    int i;
+
+    state0 = vld1q_u32((const uint32_t *)&ctx->h[0]);
+    state1 = vld1q_u32((const uint32_t *)&ctx->h[4]);
+
+    for (; count; count--, buffer += 64)
+    {
+        save0 = state0;
+        save1 = state1;
+
+        for (i = 0; i < 4; i++)
+            msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(buffer + 16 * i)));
+
+        for (i = 0; i < 16; i++)
+        {
+            tmp = vaddq_u32(msg[i & 3], vld1q_u32((const uint32_t *)&K[4 * i]));
+            if (i < 12)
+                msg[i & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[i & 3], msg[(i + 1) & 3]),
+                                             msg[(i + 2) & 3], msg[(i + 3) & 3]);
+            abcd = state0;
+            state0 = vsha256hq_u32(state0, state1, tmp);
+            state1 = vsha256h2q_u32(state1, abcd, tmp);
+        }
+
+        state0 = vaddq_u32(state0, save0);
+        state1 = vaddq_u32(state1, save1);
+    }
+
+    vst1q_u32((uint32_t *)&ctx->h[0], state0);
+    vst1q_u32((uint32_t *)&ctx->h[4], state1);
+}
+
+#endif
+
+/* Process whole blocks with the SHA extensions when the CPU has them. */
+static void processblocks(SHA256_CTX *ctx, const UCHAR *buffer, ULONG count)
+{
+#ifdef USE_SHA_NI
+    if (use_sha_ni())
+    {
+        processblocks_sha_ni(ctx, buffer, count);
+        return;
+    }
+#elif defined(USE_SHA_ARM)
+    processblocks_sha_arm(ctx, buffer, count);
+    return;
+#endif
+    for (; count; count--, buffer += 64)
+        processblock(ctx, buffer);
+}
+
+/* Process whole blocks of several streams, running streams side by side
+ * when the CPU has no SHA extensions but has AVX2. */
+static void processblocks_multi(SHA256_CTX **ctx, const UCHAR **data, ULONG *blocks, ULONG count)
+{
+    ULONG i;
+
+#ifdef USE_SHA_NI
+    if (!use_sha_ni() && use_avx2())
+    {
+        SHA256_CTX *lane_ctx[8], dummy_ctx;
+        const UCHAR *lane_data[8];
+        ULONG lanes, min_blocks;
+
+        for (;;)
+        {
+            for (i = lanes = 0, min_blocks = ~0u; i < count && lanes < 8; i++)
+            {
+                if (!blocks[i]) continue;
+                lane_ctx[lanes] = ctx[i];
+                lane_data[lanes++] = data[i];
+                min_blocks = min(min_blocks, blocks[i]);
+            }
+            if (lanes < 2) break;
+
+            /* idle lanes hash the data of the first one into a scratch state */
+            dummy_ctx = *lane_ctx[0];
+            for (i = lanes; i < 8; i++)
+            {
+                lane_ctx[i] = &dummy_ctx;
+                lane_data[i] = lane_data[0];
+            }
+            processblocks_x8(lane_ctx, lane_data, min_blocks);
+
+            for (i = lanes = 0; i < count && lanes < 8; i++)
+            {
+                if (!blocks[i]) continue;
+                data[i] += min_blocks * 64;
+                blocks[i] -= min_blocks;
+                lanes++;
+            }
+        }
+    }
+#endif
+    for (i = 0; i < count; i++)
+    {
+        processblocks(ctx[i], data[i], blocks[i]);
+        data[i] += blocks[i] * 64;
+        blocks[i] = 0;
+    }
+}
+
 static void pad(SHA256_CTX *ctx)
 {
     ULONG64 r = ctx->len % 64;
@@ -101,7 +390,7 @@ static void pad(SHA256_CTX *ctx)
     {
         memset(ctx->buf + r, 0, 64 - r);
         r = 0;
-        processblock(ctx, ctx->buf);
+        processblocks(ctx, ctx->buf, 1);
     }
 
     memset(ctx->buf + r, 0, 56 - r);
@@ -115,7 +404,7 @@ static void pad(SHA256_CTX *ctx)
     ctx->buf[62] = ctx->len >> 8;
     ctx->buf[63] = ctx->len;
 
-    processblock(ctx, ctx->buf);
+    processblocks(ctx, ctx->buf, 1);
 }
 
 void sha256_init(SHA256_CTX *ctx)
@@ -147,13 +436,43 @@ void sha256_update(SHA256_CTX *ctx, const UCHAR *buffer, ULONG len)
         memcpy(ctx->buf + r, p, 64 - r);
         len -= 64 - r;
         p += 64 - r;
-        processblock(ctx, ctx->buf);
+        processblocks(ctx, ctx->buf, 1);
     }
-    for (; len >= 64; len -= 64, p += 64)
-        processblock(ctx, p);
+    processblocks(ctx, p, len / 64);
+    p += len & ~63;
+    len &= 63;
     memcpy(ctx->buf, p, len);
 }
 
+/* Update several independent streams at once. */
+void sha256_update_multi(SHA256_CTX **ctx, const UCHAR **input, const ULONG *len, ULONG count)
+{
+    const UCHAR *data[8];
+    ULONG i, j, n, head, blocks[8];
+
+    for (i = 0; i < count; i += n)
+    {
+        n = min(count - i, ARRAY_SIZE(data));
+        for (j = 0; j < n; j++)
+        {
+            ULONG64 r = ctx[i + j]->len % 64;
+
+            /* complete the buffered block first */
+            head = r ? min(64 - r, len[i + j]) : 0;
+            sha256_update(ctx[i + j], input[i + j], head);
+            data[j] = input[i + j] + head;
+            blocks[j] = (len[i + j] - head) / 64;
+            ctx[i + j]->len += blocks[j] * 64;
+        }
+        processblocks_multi(ctx + i, data, blocks, n);
+        for (j = 0; j < n; j++)
+        {
+            head = data[j] - input[i + j];
+            sha256_update(ctx[i + j], data[j], len[i + j] - head);
+        }
+    }
+}
+
 void sha256_finalize(SHA256_CTX *ctx, UCHAR *buffer)
 {
     int i;
@@ -28,6 +28,10 @@
 #include "wine/test.h"
 
 static NTSTATUS (WINAPI *pBCryptHash)(BCRYPT_ALG_HANDLE, UCHAR *, ULONG, UCHAR *, ULONG, UCHAR *, ULONG);
+static NTSTATUS (WINAPI *pBCryptCreateMultiHash)(BCRYPT_ALG_HANDLE, BCRYPT_HASH_HANDLE *, ULONG, UCHAR *, ULONG,
+                                                 UCHAR *, ULONG, ULONG);
+static NTSTATUS (WINAPI *pBCryptProcessMultiOperations)(BCRYPT_HANDLE, BCRYPT_MULTI_OPERATION_TYPE, void *, ULONG,
+                                                        ULONG);
 
 static void test_BCryptGenRandom(void)
 {
@@ -427,6 +431,171 @@ static void test_BcryptHash(void)
     ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
 }
 
+/* test vectors from FIPS 180-2, hashed in pieces of various sizes */
+static void test_sha256_blocks(void)
+{
+    static const char msg[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    static const char expected[] =
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1";
+    static const char expected_million[] =
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+    static const ULONG sizes[] = { 1, 63, 64, 65, 1000, 4096, 10000 };
+    BCRYPT_ALG_HANDLE alg;
+    BCRYPT_HASH_HANDLE hash;
+    UCHAR hash_buf[32], *data;
+    ULONG i, len, total = 1000000;
+    char str[65];
+    NTSTATUS ret;
+
+    alg = NULL;
+    ret = BCryptOpenAlgorithmProvider(&alg, BCRYPT_SHA256_ALGORITHM, MS_PRIMITIVE_PROVIDER, 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+
+    hash = NULL;
+    ret = BCryptCreateHash(alg, &hash, NULL, 0, NULL, 0, 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+    ret = BCryptHashData(hash, (UCHAR *)msg, strlen(msg), 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+    ret = BCryptFinishHash(hash, hash_buf, sizeof(hash_buf), 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+    format_hash( hash_buf, sizeof(hash_buf), str );
+    ok(!strcmp(str, expected), "got %s\n", str);
+    BCryptDestroyHash(hash);
+
+    data = malloc(total);
+    memset(data, 'a', total);
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        ULONG offset;
+
+        hash = NULL;
+        ret = BCryptCreateHash(alg, &hash, NULL, 0, NULL, 0, 0);
+        ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+        for (offset = 0; offset < total; offset += len)
+        {
+            len = min(sizes[(i + offset) % ARRAY_SIZE(sizes)], total - offset);
+            ret = BCryptHashData(hash, data + offset, len, 0);
+            ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+        }
+        memset(hash_buf, 0, sizeof(hash_buf));
+        ret = BCryptFinishHash(hash, hash_buf, sizeof(hash_buf), 0);
+        ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+        format_hash( hash_buf, sizeof(hash_buf), str );
+        ok(!strcmp(str, expected_million), "%lu: got %s\n", i, str);
+        BCryptDestroyHash(hash);
+    }
+
+    if (pBCryptHash)
+    {
+        memset(hash_buf, 0, sizeof(hash_buf));
+        ret = pBCryptHash(alg, NULL, 0, data, total, hash_buf, sizeof(hash_buf));
+        ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+        format_hash( hash_buf, sizeof(hash_buf), str );
+        ok(!strcmp(str, expected_million), "got %s\n", str);
+    }
+    free(data);
+
+    ret = BCryptCloseAlgorithmProvider(alg, 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+}
+
+static void test_multi_hash(void)
+{
+    static const ULONG sizes[] = { 5, 64, 1000, 65536, 100000 };
+    BCRYPT_MULTI_HASH_OPERATION ops[2 * ARRAY_SIZE(sizes) + 1];
+    BCRYPT_MULTI_OBJECT_LENGTH_STRUCT multi_len;
+    UCHAR hashes[ARRAY_SIZE(sizes)][32], expected[32], *data;
+    BCRYPT_ALG_HANDLE alg;
+    BCRYPT_HASH_HANDLE hash;
+    ULONG i, size;
+    NTSTATUS ret;
+
+    if (!pBCryptCreateMultiHash || !pBCryptProcessMultiOperations || !pBCryptHash) /* < Win10 1803 */
+    {
+        win_skip("multi-hash functions are not available\n");
+        return;
+    }
+
+    /* the provider has to be opened for multi-hash objects */
+    alg = NULL;
+    ret = BCryptOpenAlgorithmProvider(&alg, BCRYPT_SHA256_ALGORITHM, MS_PRIMITIVE_PROVIDER, 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+
+    hash = NULL;
+    ret = pBCryptCreateMultiHash(alg, &hash, ARRAY_SIZE(sizes), NULL, 0, NULL, 0, 0);
+    ok(ret == STATUS_INVALID_PARAMETER, "got %#lx\n", ret);
+    ok(!hash, "got %p\n", hash);
+
+    ret = BCryptCloseAlgorithmProvider(alg, 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+
+    alg = NULL;
+    ret = BCryptOpenAlgorithmProvider(&alg, BCRYPT_SHA256_ALGORITHM, MS_PRIMITIVE_PROVIDER, BCRYPT_MULTI_FLAG);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+
+    size = 0;
+    memset(&multi_len, 0, sizeof(multi_len));
+    ret = BCryptGetProperty(alg, BCRYPT_MULTI_OBJECT_LENGTH, (UCHAR *)&multi_len, sizeof(multi_len), &size, 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+    ok(size == sizeof(multi_len), "got %lu\n", size);
+    ok(multi_len.cbPerObject && multi_len.cbPerElement, "got %lu, %lu\n", multi_len.cbPerObject,
+       multi_len.cbPerElement);
+
+    hash = NULL;
+    ret = pBCryptCreateMultiHash(alg, &hash, ARRAY_SIZE(sizes), NULL, 0, NULL, 0, 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+
+    data = malloc(2 * 100000 + ARRAY_SIZE(sizes));
+    for (i = 0; i < 2 * 100000 + ARRAY_SIZE(sizes); i++) data[i] = i * 7;
+
+    /* every state gets two pieces of data, the second one hashed after
+     * the other states were updated */
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        ops[i].iHash = i;
+        ops[i].hashOperation = BCRYPT_HASH_OPERATION_HASH_DATA;
+        ops[i].pbBuffer = data + i;
+        ops[i].cbBuffer = sizes[i];
+        ops[ARRAY_SIZE(sizes) + i].iHash = i;
+        ops[ARRAY_SIZE(sizes) + i].hashOperation = BCRYPT_HASH_OPERATION_HASH_DATA;
+        ops[ARRAY_SIZE(sizes) + i].pbBuffer = data + i + sizes[i];
+        ops[ARRAY_SIZE(sizes) + i].cbBuffer = sizes[i];
+    }
+    ops[2 * ARRAY_SIZE(sizes)].iHash = ARRAY_SIZE(sizes);
+    ops[2 * ARRAY_SIZE(sizes)].hashOperation = BCRYPT_HASH_OPERATION_HASH_DATA;
+    ops[2 * ARRAY_SIZE(sizes)].pbBuffer = data;
+    ops[2 * ARRAY_SIZE(sizes)].cbBuffer = 1;
+    ret = pBCryptProcessMultiOperations(hash, BCRYPT_OPERATION_TYPE_HASH, ops, sizeof(ops), 0);
+    ok(ret == STATUS_INVALID_PARAMETER, "got %#lx\n", ret);
+
+    ret = pBCryptProcessMultiOperations(hash, BCRYPT_OPERATION_TYPE_HASH, ops, sizeof(ops) - sizeof(ops[0]), 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        ops[i].iHash = i;
+        ops[i].hashOperation = BCRYPT_HASH_OPERATION_FINISH_HASH;
+        ops[i].pbBuffer = hashes[i];
+        ops[i].cbBuffer = sizeof(hashes[i]);
+    }
+    ret = pBCryptProcessMultiOperations(hash, BCRYPT_OPERATION_TYPE_HASH, ops, ARRAY_SIZE(sizes) * sizeof(ops[0]), 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        ret = pBCryptHash(alg, NULL, 0, data + i, 2 * sizes[i], expected, sizeof(expected));
+        ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+        ok(!memcmp(hashes[i], expected, sizeof(expected)), "%lu: wrong hash\n", i);
+    }
+
+    ret = BCryptDestroyHash(hash);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+    free(data);
+
+    ret = BCryptCloseAlgorithmProvider(alg, 0);
+    ok(ret == STATUS_SUCCESS, "got %#lx\n", ret);
+}
+
 /* test vectors from RFC 6070 */
 static UCHAR password[] = "password";
 static UCHAR salt[] = "salt";
@@ -3440,11 +3609,15 @@ START_TEST(bcrypt)
         return;
     }
     pBCryptHash = (void *)GetProcAddress(module, "BCryptHash");
+    pBCryptCreateMultiHash = (void *)GetProcAddress(module, "BCryptCreateMultiHash");
+    pBCryptProcessMultiOperations = (void *)GetProcAddress(module, "BCryptProcessMultiOperations");
 
     test_BCryptGenRandom();
     test_BCryptGetFipsAlgorithmMode();
     test_hashes();
     test_BcryptHash();
+    test_sha256_blocks();
+    test_multi_hash();
     test_BcryptDeriveKeyPBKDF2();
     test_rng();
     test_3des();
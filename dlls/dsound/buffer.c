@@ -1182,6 +1182,8 @@ void secondarybuffer_destroy(IDirectSoundBufferImpl *This)
     HeapFree(GetProcessHeap(), 0, This->notifies);
     HeapFree(GetProcessHeap(), 0, This->pwfx);
     HeapFree(GetProcessHeap(), 0, This->committedbuff);
+    HeapFree(GetProcessHeap(), 0, This->tmp_buffer);
+    HeapFree(GetProcessHeap(), 0, This->cp_buffer);
 
     if (This->filters) {
         int i;
@@ -1262,6 +1264,8 @@ HRESULT IDirectSoundBufferImpl_Duplicate(
     dsb->committedbuff = committedbuff;
     dsb->use_committed = FALSE;
     dsb->committed_mixpos = 0;
+    dsb->tmp_buffer = dsb->cp_buffer = NULL;
+    dsb->tmp_buffer_len = dsb->cp_buffer_len = 0;
     DSOUND_RecalcFormat(dsb);
 
     InitializeSRWLock(&dsb->lock);
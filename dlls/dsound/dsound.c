@@ -233,9 +233,10 @@ static ULONG DirectSoundDevice_Release(DirectSoundDevice * device)
             IAudioStreamVolume_Release(device->volume);
         if(device->mmdevice)
             IMMDevice_Release(device->mmdevice);
+        if (device->underruns)
+            WARN("%lu buffer underruns\n", device->underruns);
+        DSOUND_DestroyMixWorkers(device);
         CloseHandle(device->sleepev);
-        HeapFree(GetProcessHeap(), 0, device->tmp_buffer);
-        HeapFree(GetProcessHeap(), 0, device->cp_buffer);
         HeapFree(GetProcessHeap(), 0, device->buffer);
         device->mixlock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&device->mixlock);
@@ -382,6 +383,7 @@ static HRESULT DirectSoundDevice_Initialize(DirectSoundDevice ** ppDevice, LPCGU
 
     ZeroMemory(&device->volpan, sizeof(device->volpan));
 
+    DSOUND_CreateMixWorkers(device);
     device->thread = CreateThread(0, 0, DSOUND_mixthread, device, 0, 0);
     SetThreadPriority(device->thread, THREAD_PRIORITY_TIME_CRITICAL);
 
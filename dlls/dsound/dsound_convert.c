@@ -45,6 +45,14 @@
 #include "dsound.h"
 #include "dsound_private.h"
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#define USE_SSE
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define USE_NEON
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(dsound);
 
 #ifdef WORDS_BIGENDIAN
@@ -149,14 +157,14 @@ static inline LONG f_to_32(float value)
 
 void putieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
 {
-    BYTE *buf = (BYTE *)dsb->device->tmp_buffer;
+    BYTE *buf = (BYTE *)dsb->tmp_buffer;
     float *fbuf = (float*)(buf + pos + sizeof(float) * channel);
     *fbuf = value;
 }
 
 void putieee32_sum(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
 {
-    BYTE *buf = (BYTE *)dsb->device->tmp_buffer;
+    BYTE *buf = (BYTE *)dsb->tmp_buffer;
     float *fbuf = (float*)(buf + pos + sizeof(float) * channel);
     *fbuf += value;
 }
@@ -324,10 +332,92 @@ void put_quad2stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel
 void mixieee32(float *src, float *dst, unsigned samples)
 {
     TRACE("%p - %p %d\n", src, dst, samples);
+#if defined(USE_SSE)
+    for (; samples >= 4; samples -= 4, src += 4, dst += 4)
+        _mm_storeu_ps(dst, _mm_add_ps(_mm_loadu_ps(dst), _mm_loadu_ps(src)));
+#elif defined(USE_NEON)
+    for (; samples >= 4; samples -= 4, src += 4, dst += 4)
+        vst1q_f32(dst, vaddq_f32(vld1q_f32(dst), vld1q_f32(src)));
+#endif
     while (samples--)
         *(dst++) += *(src++);
 }
 
+/* mix interleaved frames, applying a volume to each channel */
+void mixieee32_vol(float *src, float *dst, unsigned frames, unsigned channels, const float *vols)
+{
+    float pattern[4 * DS_MAX_CHANNELS];
+    unsigned samples = frames * channels, block = 4 * channels, i, j;
+
+    TRACE("%p - %p %d %d\n", src, dst, frames, channels);
+
+    /* a block of four frames is a whole number of vectors for any channel count */
+    for (i = 0; i < block; i++) pattern[i] = vols[i % channels];
+
+    for (i = 0; i + block <= samples; i += block)
+    {
+        for (j = 0; j < block; j += 4)
+        {
+#if defined(USE_SSE)
+            _mm_storeu_ps(dst + i + j, _mm_add_ps(_mm_loadu_ps(dst + i + j),
+                    _mm_mul_ps(_mm_loadu_ps(src + i + j), _mm_loadu_ps(pattern + j))));
+#elif defined(USE_NEON)
+            vst1q_f32(dst + i + j, vmlaq_f32(vld1q_f32(dst + i + j),
+                    vld1q_f32(src + i + j), vld1q_f32(pattern + j)));
+#else
+            dst[i + j + 0] += src[i + j + 0] * pattern[j + 0];
+            dst[i + j + 1] += src[i + j + 1] * pattern[j + 1];
+            dst[i + j + 2] += src[i + j + 2] * pattern[j + 2];
+            dst[i + j + 3] += src[i + j + 3] * pattern[j + 3];
+#endif
+        }
+    }
+    for (; i < samples; i++)
+        dst[i] += src[i] * pattern[i % block];
+}
+
+/* dot product of the filter coefficients and the samples */
+float fir_sum(const float *coeffs, const float *samples, unsigned count)
+{
+    float sum;
+    unsigned i = 0;
+#if defined(USE_SSE)
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    float partial[4];
+
+    for (; i + 8 <= count; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(coeffs + i), _mm_loadu_ps(samples + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(coeffs + i + 4), _mm_loadu_ps(samples + i + 4)));
+    }
+    _mm_storeu_ps(partial, _mm_add_ps(acc0, acc1));
+    sum = (partial[0] + partial[1]) + (partial[2] + partial[3]);
+#elif defined(USE_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(coeffs + i), vld1q_f32(samples + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(coeffs + i + 4), vld1q_f32(samples + i + 4));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#else
+    float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        sum0 += coeffs[i + 0] * samples[i + 0];
+        sum1 += coeffs[i + 1] * samples[i + 1];
+        sum2 += coeffs[i + 2] * samples[i + 2];
+        sum3 += coeffs[i + 3] * samples[i + 3];
+    }
+    sum = (sum0 + sum1) + (sum2 + sum3);
+#endif
+    for (; i < count; i++)
+        sum += coeffs[i] * samples[i];
+    return sum;
+}
+
 static void norm8(float *src, unsigned char *dst, unsigned samples)
 {
     TRACE("%p - %p %d\n", src, dst, samples);
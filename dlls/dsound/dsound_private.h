@@ -49,6 +49,8 @@ extern const bitsgetfunc getbpp[5] DECLSPEC_HIDDEN;
 void putieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
 void putieee32_sum(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
 void mixieee32(float *src, float *dst, unsigned samples) DECLSPEC_HIDDEN;
+void mixieee32_vol(float *src, float *dst, unsigned frames, unsigned channels, const float *vols) DECLSPEC_HIDDEN;
+float fir_sum(const float *coeffs, const float *samples, unsigned count) DECLSPEC_HIDDEN;
 typedef void (*normfunc)(const void *, void *, unsigned);
 extern const normfunc normfunctions[4] DECLSPEC_HIDDEN;
 
@@ -88,8 +90,13 @@ struct DirectSoundDevice
     int                         speaker_num[DS_MAX_CHANNELS];
     int                         num_speakers;
     int                         lfe_channel;
-    float *tmp_buffer, *cp_buffer;
-    DWORD                       tmp_buffer_len, cp_buffer_len;
+    struct mix_job             *mix_jobs;
+    int                         mix_jobs_size, mix_workers;
+    LONG                        mix_next, mix_count;
+    DWORD                       mix_frames;
+    PTP_POOL                    mix_pool;
+    PTP_WORK                    mix_work;
+    DWORD                       underruns;
 
     DSVOLUMEPAN                 volpan;
 
@@ -170,6 +177,8 @@ struct IDirectSoundBufferImpl
     int                         mix_channels;
     bitsgetfunc get, get_aux;
     bitsputfunc put, put_aux;
+    float *tmp_buffer, *cp_buffer;
+    DWORD                       tmp_buffer_len, cp_buffer_len;
     int                         num_filters;
     DSFilter*                   filters;
 
@@ -228,6 +237,9 @@ LONG capped_refcount_dec(LONG *ref) DECLSPEC_HIDDEN;
 HRESULT DSOUND_FullDuplexCreate(REFIID riid, void **ppv) DECLSPEC_HIDDEN;
 
 /* mixer.c */
+void DSOUND_FreeFirBanks(void) DECLSPEC_HIDDEN;
+void DSOUND_CreateMixWorkers(DirectSoundDevice *device) DECLSPEC_HIDDEN;
+void DSOUND_DestroyMixWorkers(DirectSoundDevice *device) DECLSPEC_HIDDEN;
 void DSOUND_CheckEvent(const IDirectSoundBufferImpl *dsb, DWORD playpos, int len) DECLSPEC_HIDDEN;
 void DSOUND_RecalcVolPan(PDSVOLUMEPAN volpan) DECLSPEC_HIDDEN;
 void DSOUND_AmpFactorToVolPan(PDSVOLUMEPAN volpan) DECLSPEC_HIDDEN;
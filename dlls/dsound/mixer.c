@@ -311,12 +311,84 @@ static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, UINT count)
     return count;
 }
 
+/**
+ * Polyphase decomposition of the FIR for a given step.
+ *
+ * Row r holds the points used for an output frame at (fir step position % firstep) == r,
+ * lo[] at the rounded down position and hi[] one point further, so that the coefficients
+ * are interpolated from two contiguous rows instead of being gathered all over the FIR.
+ */
+struct fir_bank
+{
+    UINT firstep;
+    UINT taps;     /* row length */
+    UINT *counts;  /* number of points in each row */
+    float *lo;
+    float *hi;
+};
+
+static struct fir_bank *fir_banks[128];
+
+static struct fir_bank *create_fir_bank(UINT firstep)
+{
+    UINT taps = (fir_len + firstep - 2) / firstep, r, n, idx;
+    struct fir_bank *bank;
+
+    if (!(bank = HeapAlloc(GetProcessHeap(), 0, sizeof(*bank) + firstep * sizeof(UINT) +
+                           2 * firstep * taps * sizeof(float))))
+        return NULL;
+
+    bank->firstep = firstep;
+    bank->taps = taps;
+    bank->lo = (float *)(bank + 1);
+    bank->hi = bank->lo + firstep * taps;
+    bank->counts = (UINT *)(bank->hi + firstep * taps);
+
+    for (r = 0; r < firstep; r++)
+    {
+        for (n = 0, idx = firstep - 1 - r; idx < fir_len - 1; n++, idx += firstep)
+        {
+            bank->lo[r * taps + n] = fir[idx];
+            bank->hi[r * taps + n] = fir[idx + 1];
+        }
+        bank->counts[r] = n;
+    }
+    return bank;
+}
+
+static const struct fir_bank *get_fir_bank(UINT firstep)
+{
+    struct fir_bank *bank;
+
+    if (firstep >= ARRAY_SIZE(fir_banks)) return NULL;
+    if ((bank = fir_banks[firstep])) return bank;
+
+    if (!(bank = create_fir_bank(firstep))) return NULL;
+    if (InterlockedCompareExchangePointer((void **)&fir_banks[firstep], bank, NULL))
+    {
+        /* another mixer thread was faster */
+        HeapFree(GetProcessHeap(), 0, bank);
+        bank = fir_banks[firstep];
+    }
+    return bank;
+}
+
+void DSOUND_FreeFirBanks(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(fir_banks); i++)
+        HeapFree(GetProcessHeap(), 0, fir_banks[i]);
+}
+
 static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum)
 {
+    const struct fir_bank *bank;
     UINT i, channel;
     UINT istride = dsb->pwfx->nBlockAlign;
     UINT ostride = dsb->device->pwfx->nChannels * sizeof(float);
     UINT committed_samples = 0;
+    int j;
 
     LONG64 freqAcc_start = *freqAccNum;
     LONG64 freqAcc_end = freqAcc_start + count * dsb->freqAdjustNum;
@@ -337,16 +409,17 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
     if (!secondarybuffer_is_audible(dsb))
         return max_ipos;
 
-    if (!dsb->device->cp_buffer) {
-        dsb->device->cp_buffer = HeapAlloc(GetProcessHeap(), 0, len);
-        dsb->device->cp_buffer_len = len;
-    } else if (len > dsb->device->cp_buffer_len) {
-        dsb->device->cp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->device->cp_buffer, len);
-        dsb->device->cp_buffer_len = len;
+    if (!dsb->cp_buffer) {
+        dsb->cp_buffer = HeapAlloc(GetProcessHeap(), 0, len);
+        dsb->cp_buffer_len = len;
+    } else if (len > dsb->cp_buffer_len) {
+        dsb->cp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->cp_buffer, len);
+        dsb->cp_buffer_len = len;
     }
 
-    fir_copy = dsb->device->cp_buffer;
+    fir_copy = dsb->cp_buffer;
     intermediate = fir_copy + fir_cachesize;
+    bank = get_fir_bank(dsbfirstep);
 
     if(dsb->use_committed) {
         committed_samples = (dsb->writelead - dsb->committed_mixpos) / istride;
@@ -376,21 +449,26 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
         float rem = int_fir_steps + 1.0 - total_fir_steps;
 
         int fir_used = 0;
-        while (idx < fir_len - 1) {
-            fir_copy[fir_used++] = fir[idx] * (1.0 - rem) + fir[idx + 1] * rem;
-            idx += dsb->firstep;
+        if (bank) {
+            UINT row = (int_fir_steps % dsbfirstep) * bank->taps;
+            const float *lo = bank->lo + row, *hi = bank->hi + row;
+
+            fir_used = bank->counts[int_fir_steps % dsbfirstep];
+            for (j = 0; j < fir_used; j++)
+                fir_copy[j] = lo[j] * (1.0f - rem) + hi[j] * rem;
+        } else {
+            while (idx < fir_len - 1) {
+                fir_copy[fir_used++] = fir[idx] * (1.0 - rem) + fir[idx + 1] * rem;
+                idx += dsb->firstep;
+            }
         }
 
         assert(fir_used <= fir_cachesize);
         assert(ipos + fir_used <= required_input);
 
         for (channel = 0; channel < dsb->mix_channels; channel++) {
-            int j;
-            float sum = 0.0;
             float* cache = &intermediate[channel * required_input + ipos];
-            for (j = 0; j < fir_used; j++)
-                sum += fir_copy[j] * cache[j];
-            dsb->put(dsb, i * ostride, channel, sum * dsb->firgain);
+            dsb->put(dsb, i * ostride, channel, fir_sum(fir_copy, cache, fir_used) * dsb->firgain);
         }
     }
 
@@ -459,23 +537,23 @@ static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
 	HRESULT hr;
 	int i;
 
-	if (dsb->device->tmp_buffer_len < size_bytes || !dsb->device->tmp_buffer)
+	if (dsb->tmp_buffer_len < size_bytes || !dsb->tmp_buffer)
 	{
-		dsb->device->tmp_buffer_len = size_bytes;
-		if (dsb->device->tmp_buffer)
-			dsb->device->tmp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->device->tmp_buffer, size_bytes);
+		dsb->tmp_buffer_len = size_bytes;
+		if (dsb->tmp_buffer)
+			dsb->tmp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->tmp_buffer, size_bytes);
 		else
-			dsb->device->tmp_buffer = HeapAlloc(GetProcessHeap(), 0, size_bytes);
+			dsb->tmp_buffer = HeapAlloc(GetProcessHeap(), 0, size_bytes);
 	}
 	if(dsb->put_aux == putieee32_sum)
-		memset(dsb->device->tmp_buffer, 0, dsb->device->tmp_buffer_len);
+		memset(dsb->tmp_buffer, 0, dsb->tmp_buffer_len);
 
 	cp_fields(dsb, frames, &dsb->freqAccNum);
 
 	if (size_bytes > 0) {
 		for (i = 0; i < dsb->num_filters; i++) {
 			if (dsb->filters[i].inplace) {
-				hr = IMediaObjectInPlace_Process(dsb->filters[i].inplace, size_bytes, (BYTE*)dsb->device->tmp_buffer, 0, DMO_INPLACE_NORMAL);
+				hr = IMediaObjectInPlace_Process(dsb->filters[i].inplace, size_bytes, (BYTE*)dsb->tmp_buffer, 0, DMO_INPLACE_NORMAL);
 
 				if (FAILED(hr))
 					WARN("IMediaObjectInPlace_Process failed for filter %u\n", i);
@@ -485,52 +563,70 @@ static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
 	}
 }
 
-static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
+/**
+ * Get the volume to apply to each channel of the mixed frames.
+ *
+ * Returns FALSE if the frames are mixed at full volume.
+ */
+static BOOL DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, float *vols)
 {
-	INT	i;
-	float vols[DS_MAX_CHANNELS];
-	UINT channels = dsb->device->pwfx->nChannels, chan;
+	UINT	i;
+	UINT channels = dsb->device->pwfx->nChannels;
 
-	TRACE("(%p,%d)\n",dsb,frames);
+	TRACE("(%p)\n",dsb);
 	TRACE("left = %lx, right = %lx\n", dsb->volpan.dwTotalAmpFactor[0],
 		dsb->volpan.dwTotalAmpFactor[1]);
 
 	if ((!(dsb->dsbd.dwFlags & DSBCAPS_CTRLPAN) || (dsb->volpan.lPan == 0)) &&
 	    (!(dsb->dsbd.dwFlags & DSBCAPS_CTRLVOLUME) || (dsb->volpan.lVolume == 0)) &&
 	     !(dsb->dsbd.dwFlags & DSBCAPS_CTRL3D))
-		return; /* Nothing to do */
+		return FALSE; /* Nothing to do */
 
 	if (channels > DS_MAX_CHANNELS)
 	{
 		FIXME("There is no support for %u channels\n", channels);
-		return;
+		return FALSE;
 	}
 
 	for (i = 0; i < channels; ++i)
 		vols[i] = dsb->volpan.dwTotalAmpFactor[i] / ((float)0xFFFF);
-
-	for(i = 0; i < frames; ++i){
-		for(chan = 0; chan < channels; ++chan){
-			dsb->device->tmp_buffer[i * channels + chan] *= vols[chan];
-		}
-	}
+	return TRUE;
 }
 
 /**
- * Mix (at most) the given number of bytes into the given position of the
- * device buffer, from the secondary buffer "dsb" (starting at the current
- * mix position for that buffer).
+ * State of the mixing of one secondary buffer during a mixer period. The
+ * buffers are converted independently, possibly by several threads, and
+ * then added to the primary buffer in order, so that the output doesn't
+ * depend on the threads.
+ */
+struct mix_job
+{
+	IDirectSoundBufferImpl *dsb;
+	DWORD frames;       /* frames converted in the buffer's temporary buffer */
+	BOOL playing;
+	BOOL audible;
+	BOOL use_vols;
+	float vols[DS_MAX_CHANNELS];
+};
+
+/* minimum number of playing buffers to mix them on several threads */
+#define MIX_PARALLEL_MIN_BUFFERS 4
+#define MIX_MAX_WORKERS 4
+
+/**
+ * Convert (at most) the given number of frames from the secondary buffer
+ * "dsb" (starting at the current mix position for that buffer) into its
+ * temporary buffer, to be mixed into the device buffer later.
  *
- * Returns the number of bytes actually mixed into the device buffer. This
- * will match fraglen unless the end of the secondary buffer is reached
- * (and it is not looping).
+ * Returns the number of frames actually converted. This will match frames
+ * unless the end of the secondary buffer is reached (and it is not looping).
  *
  * dsb  = the secondary buffer to mix from
- * fraglen = number of bytes to mix
+ * job  = the mixing state of the buffer
+ * frames = number of frames to mix
  */
-static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD frames)
+static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, struct mix_job *job, DWORD frames)
 {
-	float *ibuf;
 	DWORD oldpos;
 
 	TRACE("sec_mixpos=%ld/%ld\n", dsb->sec_mixpos, dsb->buflen);
@@ -539,13 +635,12 @@ static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer,
 	/* Resample buffer to temporary buffer specifically allocated for this purpose, if needed */
 	oldpos = dsb->sec_mixpos;
 	DSOUND_MixToTemporary(dsb, frames);
-	ibuf = dsb->device->tmp_buffer;
 
 	if (secondarybuffer_is_audible(dsb)) {
-		/* Apply volume if needed */
-		DSOUND_MixerVol(dsb, frames);
-
-		mixieee32(ibuf, mix_buffer, frames * dsb->device->pwfx->nChannels);
+		/* Volume is applied while mixing into the device buffer */
+		job->audible = TRUE;
+		job->frames = frames;
+		job->use_vols = DSOUND_MixerVol(dsb, job->vols);
 	}
 
 	/* check for notification positions */
@@ -559,17 +654,17 @@ static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer,
 }
 
 /**
- * Mix some frames from the given secondary buffer "dsb" into the device
- * primary buffer.
+ * Mix some frames from the given secondary buffer "dsb" into its temporary
+ * buffer.
  *
  * dsb = the secondary buffer
- * playpos = the current play position in the device buffer (primary buffer)
+ * job = the mixing state of the buffer
  * frames = the maximum number of frames in the primary buffer to mix, from the
  *          current writepos.
  *
  * Returns: the number of frames beyond the writepos that were mixed.
  */
-static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD frames)
+static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, struct mix_job *job, DWORD frames)
 {
 	DWORD primary_done = 0;
 
@@ -594,7 +689,7 @@ static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD
 	/* First try to mix to the end of the buffer if possible
 	 * Theoretically it would allow for better optimization
 	*/
-	primary_done += DSOUND_MixInBuffer(dsb, mix_buffer, frames);
+	primary_done += DSOUND_MixInBuffer(dsb, job, frames);
 
 	TRACE("total mixed data=%ld\n", primary_done);
 
@@ -602,6 +697,87 @@ static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD
 	return primary_done;
 }
 
+static void DSOUND_MixJob(struct mix_job *job, DWORD frames)
+{
+	IDirectSoundBufferImpl *dsb = job->dsb;
+
+	TRACE("Checking %p, frames=%ld\n", dsb, frames);
+	AcquireSRWLockShared(&dsb->lock);
+	if (dsb->state != STATE_STOPPED) {
+
+		/* if the buffer was starting, it must be playing now */
+		if (dsb->state == STATE_STARTING)
+			dsb->state = STATE_PLAYING;
+
+		/* mix next buffer into its temporary buffer */
+		DSOUND_MixOne(dsb, job, frames);
+
+		job->playing = TRUE;
+	}
+	ReleaseSRWLockShared(&dsb->lock);
+}
+
+static void DSOUND_RunMixJobs(DirectSoundDevice *device)
+{
+	LONG i;
+
+	while ((i = InterlockedIncrement(&device->mix_next) - 1) < device->mix_count)
+		DSOUND_MixJob(&device->mix_jobs[i], device->mix_frames);
+}
+
+static void CALLBACK DSOUND_MixWorker(TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work)
+{
+	/* the pool is private, keep its threads at the priority of the mixer thread */
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+	DSOUND_RunMixJobs(context);
+}
+
+/**
+ * Create the worker threads used to mix the buffers of a device in parallel.
+ * Mixing falls back to the mixer thread alone if they can't be created.
+ */
+void DSOUND_CreateMixWorkers(DirectSoundDevice *device)
+{
+	TP_CALLBACK_ENVIRON environment;
+	SYSTEM_INFO info;
+	int workers;
+
+	GetSystemInfo(&info);
+	/* the mixer thread mixes too */
+	workers = min(info.dwNumberOfProcessors - 1, MIX_MAX_WORKERS);
+	if (workers <= 0)
+		return;
+
+	if (!(device->mix_pool = CreateThreadpool(NULL))) {
+		WARN("failed to create mixer thread pool\n");
+		return;
+	}
+	SetThreadpoolThreadMaximum(device->mix_pool, workers);
+
+	memset(&environment, 0, sizeof(environment));
+	environment.Version = 1;
+	environment.Pool = device->mix_pool;
+	if (!(device->mix_work = CreateThreadpoolWork(DSOUND_MixWorker, device, &environment))) {
+		WARN("failed to create mixer work item\n");
+		CloseThreadpool(device->mix_pool);
+		device->mix_pool = NULL;
+		return;
+	}
+	device->mix_workers = workers;
+	TRACE("using %d mixer worker threads\n", workers);
+}
+
+void DSOUND_DestroyMixWorkers(DirectSoundDevice *device)
+{
+	if (device->mix_work) {
+		WaitForThreadpoolWorkCallbacks(device->mix_work, TRUE);
+		CloseThreadpoolWork(device->mix_work);
+	}
+	if (device->mix_pool)
+		CloseThreadpool(device->mix_pool);
+	HeapFree(GetProcessHeap(), 0, device->mix_jobs);
+}
+
 /**
  * For a DirectSoundDevice, go through all the currently playing buffers and
  * mix them in to the device buffer.
@@ -612,36 +788,69 @@ static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD
  * Returns:  the length beyond the writepos that was mixed to.
  */
 
-static void DSOUND_MixToPrimary(const DirectSoundDevice *device, float *mix_buffer, DWORD frames, BOOL *all_stopped)
+static void DSOUND_MixToPrimary(DirectSoundDevice *device, float *mix_buffer, DWORD frames, BOOL *all_stopped)
 {
-	INT i;
+	INT i, count = 0, submitted = 0;
+	UINT channels = device->pwfx->nChannels;
 	IDirectSoundBufferImpl	*dsb;
+	struct mix_job *job;
 
 	/* unless we find a running buffer, all have stopped */
 	*all_stopped = TRUE;
 
 	TRACE("(frames %ld)\n", frames);
+
+	if (device->nrofbuffers > device->mix_jobs_size) {
+		struct mix_job *jobs;
+
+		if (device->mix_jobs)
+			jobs = HeapReAlloc(GetProcessHeap(), 0, device->mix_jobs, device->nrofbuffers * sizeof(*jobs));
+		else
+			jobs = HeapAlloc(GetProcessHeap(), 0, device->nrofbuffers * sizeof(*jobs));
+		if (!jobs) {
+			ERR("out of memory\n");
+			return;
+		}
+		device->mix_jobs = jobs;
+		device->mix_jobs_size = device->nrofbuffers;
+	}
+
 	for (i = 0; i < device->nrofbuffers; i++) {
 		dsb = device->buffers[i];
 
 		TRACE("MixToPrimary for %p, state=%ld\n", dsb, dsb->state);
 
 		if (dsb->buflen && dsb->state) {
-			TRACE("Checking %p, frames=%ld\n", dsb, frames);
-			AcquireSRWLockShared(&dsb->lock);
-			if (dsb->state != STATE_STOPPED) {
-
-				/* if the buffer was starting, it must be playing now */
-				if (dsb->state == STATE_STARTING)
-					dsb->state = STATE_PLAYING;
+			job = &device->mix_jobs[count++];
+			memset(job, 0, sizeof(*job));
+			job->dsb = dsb;
+		}
+	}
 
-				/* mix next buffer into the main buffer */
-				DSOUND_MixOne(dsb, mix_buffer, frames);
+	device->mix_next = 0;
+	device->mix_count = count;
+	device->mix_frames = frames;
 
-				*all_stopped = FALSE;
-			}
-			ReleaseSRWLockShared(&dsb->lock);
-		}
+	if (device->mix_work && count >= MIX_PARALLEL_MIN_BUFFERS) {
+		submitted = min(count - 1, device->mix_workers);
+		for (i = 0; i < submitted; i++)
+			SubmitThreadpoolWork(device->mix_work);
+	}
+	DSOUND_RunMixJobs(device);
+	if (submitted)
+		WaitForThreadpoolWorkCallbacks(device->mix_work, FALSE);
+
+	/* add the buffers in order, the result doesn't depend on which thread converted them */
+	for (i = 0; i < count; i++) {
+		job = &device->mix_jobs[i];
+		if (job->playing)
+			*all_stopped = FALSE;
+		if (!job->audible)
+			continue;
+		if (job->use_vols)
+			mixieee32_vol(job->dsb->tmp_buffer, mix_buffer, job->frames, channels, job->vols);
+		else
+			mixieee32(job->dsb->tmp_buffer, mix_buffer, job->frames * channels);
 	}
 }
 
@@ -688,8 +897,8 @@ static void DSOUND_WaveQueue(DirectSoundDevice *device, LPBYTE pos, DWORD bytes)
  * The mixing procedure goes:
  *
  * secondary->buffer (secondary format)
- *   =[Resample]=> device->tmp_buffer (float format)
- *   =[Volume]=> device->tmp_buffer (float format)
+ *   =[Resample]=> dsb->tmp_buffer (float format, possibly on a worker thread)
+ *   =[Volume, Mix]=> device->buffer (float format, in buffer order)
  *   =[Reformat]=> device->buffer (device format, skipped on float)
  */
 static void DSOUND_PerformMix(DirectSoundDevice *device)
@@ -735,7 +944,10 @@ static void DSOUND_PerformMix(DirectSoundDevice *device)
 		/* check for underrun. underrun occurs when the write position passes the mix position
 		 * also wipe out just-played sound data */
 		if (!pad_frames)
-			WARN("Probable buffer underrun\n");
+		{
+			device->underruns++;
+			WARN("Probable buffer underrun (%lu so far)\n", device->underruns);
+		}
 
 		hr = IAudioRenderClient_GetBuffer(device->render, frames, (BYTE **)&buffer);
 		if(FAILED(hr)){
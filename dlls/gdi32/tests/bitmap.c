@@ -3850,6 +3850,266 @@ static void test_GdiAlphaBlend(void)
     HeapFree(GetProcessHeap(), 0, bmi);
 }
 
+static DWORD blend_pixel_src_alpha( DWORD dst, DWORD src )
+{
+    DWORD alpha = src >> 24, ret = 0;
+    int i;
+
+    /* color channels larger than alpha carry into the next channel */
+    for (i = 0; i < 32; i += 8)
+        ret |= (((src >> i) & 0xff) + (((dst >> i) & 0xff) * (255 - alpha) + 127) / 255) << i;
+    return ret;
+}
+
+static DWORD blend_pixel_constant_alpha( DWORD dst, DWORD src, DWORD alpha )
+{
+    DWORD ret = 0;
+    int i;
+
+    for (i = 0; i < 32; i += 8)
+        ret |= ((((src >> i) & 0xff) * alpha + ((dst >> i) & 0xff) * (255 - alpha) + 127) / 255) << i;
+    return ret;
+}
+
+/* Wide rows go through vectorized code in the DIB engine, check that every
+ * position in a row gives the same result. */
+static void test_GdiAlphaBlend_rows(void)
+{
+    static const int width = 67, height = 4;
+    DWORD *src_bits, *dst_bits, *dst_copy, *src24_copy, expect;
+    BYTE *src24_bits;
+    BLENDFUNCTION blend;
+    BITMAPINFO bmi;
+    HBITMAP src_bmp, dst_bmp, src24_bmp;
+    HDC src_dc, dst_dc, src24_dc;
+    unsigned int seed = 0x1234;
+    int x, y, i;
+    BOOL ret;
+
+    if (!pGdiAlphaBlend)
+    {
+        win_skip("GdiAlphaBlend() is not implemented\n");
+        return;
+    }
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    src_bmp = CreateDIBSection( NULL, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    ok( src_bmp != NULL, "failed to create bitmap\n" );
+    dst_bmp = CreateDIBSection( NULL, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    ok( dst_bmp != NULL, "failed to create bitmap\n" );
+    bmi.bmiHeader.biBitCount = 24;
+    src24_bmp = CreateDIBSection( NULL, &bmi, DIB_RGB_COLORS, (void **)&src24_bits, NULL, 0 );
+    ok( src24_bmp != NULL, "failed to create bitmap\n" );
+
+    src_dc = CreateCompatibleDC( NULL );
+    dst_dc = CreateCompatibleDC( NULL );
+    src24_dc = CreateCompatibleDC( NULL );
+    SelectObject( src_dc, src_bmp );
+    SelectObject( dst_dc, dst_bmp );
+    SelectObject( src24_dc, src24_bmp );
+
+    dst_copy = HeapAlloc( GetProcessHeap(), 0, width * height * sizeof(DWORD) );
+    src24_copy = HeapAlloc( GetProcessHeap(), 0, width * height * sizeof(DWORD) );
+
+    for (i = 0; i < width * height; i++)
+    {
+        DWORD alpha = (seed = seed * 1103515245 + 12345) >> 24;
+
+        src_bits[i] = alpha << 24;
+        for (x = 0; x < 24; x += 8)
+            src_bits[i] |= ((((seed = seed * 1103515245 + 12345) >> 24) * alpha) / 255) << x;
+        dst_bits[i] = (seed = seed * 1103515245 + 12345);
+    }
+    /* make the last row invalid premultiplied data, which can't be blended by channel */
+    for (i = width * (height - 1); i < width * height; i += 3) src_bits[i] |= 0xff;
+    memcpy( dst_copy, dst_bits, width * height * sizeof(DWORD) );
+
+    blend.BlendOp = AC_SRC_OVER;
+    blend.BlendFlags = 0;
+    blend.SourceConstantAlpha = 255;
+    blend.AlphaFormat = AC_SRC_ALPHA;
+    ret = pGdiAlphaBlend( dst_dc, 0, 0, width, height, src_dc, 0, 0, width, height, blend );
+    ok( ret, "GdiAlphaBlend failed err %lu\n", GetLastError() );
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++)
+        {
+            i = y * width + x;
+            expect = blend_pixel_src_alpha( dst_copy[i], src_bits[i] );
+            if (dst_bits[i] != expect) break;
+        }
+        ok( x == width || broken( y == height - 1 ),
+            "%d,%d: got %08lx, expected %08lx\n", x, y, dst_bits[i], expect );
+    }
+
+    memcpy( dst_copy, dst_bits, width * height * sizeof(DWORD) );
+    blend.SourceConstantAlpha = 0x60;
+    blend.AlphaFormat = 0;
+    ret = pGdiAlphaBlend( dst_dc, 0, 0, width, height, src_dc, 0, 0, width, height, blend );
+    ok( ret, "GdiAlphaBlend failed err %lu\n", GetLastError() );
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++)
+        {
+            i = y * width + x;
+            expect = blend_pixel_constant_alpha( dst_copy[i], src_bits[i], 0x60 ) & 0xffffff;
+            if ((dst_bits[i] & 0xffffff) != expect) break;
+        }
+        ok( x == width, "%d,%d: got %08lx, expected %08lx\n", x, y, dst_bits[i], expect );
+    }
+
+    memcpy( dst_copy, dst_bits, width * height * sizeof(DWORD) );
+    SelectObject( dst_dc, GetStockObject( WHITE_BRUSH ));
+    ret = PatBlt( dst_dc, 1, 0, width - 1, height, PATINVERT );
+    ok( ret, "PatBlt failed err %lu\n", GetLastError() );
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++)
+        {
+            i = y * width + x;
+            expect = x ? dst_copy[i] ^ 0xffffff : dst_copy[i];
+            if (dst_bits[i] != expect) break;
+        }
+        ok( x == width, "%d,%d: got %08lx, expected %08lx\n", x, y, dst_bits[i], expect );
+    }
+
+    for (y = 0; y < height; y++)
+    {
+        BYTE *row = src24_bits + y * ((width * 3 + 3) & ~3);
+
+        for (x = 0; x < width; x++)
+        {
+            row[x * 3] = (seed = seed * 1103515245 + 12345) >> 24;
+            row[x * 3 + 1] = (seed = seed * 1103515245 + 12345) >> 24;
+            row[x * 3 + 2] = (seed = seed * 1103515245 + 12345) >> 24;
+            src24_copy[y * width + x] = row[x * 3] | (row[x * 3 + 1] << 8) | (row[x * 3 + 2] << 16);
+        }
+    }
+    ret = BitBlt( dst_dc, 0, 0, width, height, src24_dc, 0, 0, SRCCOPY );
+    ok( ret, "BitBlt failed err %lu\n", GetLastError() );
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++)
+        {
+            i = y * width + x;
+            if ((dst_bits[i] & 0xffffff) != src24_copy[i]) break;
+        }
+        ok( x == width, "%d,%d: got %08lx, expected %08lx\n", x, y, dst_bits[i], src24_copy[i] );
+    }
+
+    HeapFree( GetProcessHeap(), 0, dst_copy );
+    HeapFree( GetProcessHeap(), 0, src24_copy );
+    DeleteDC( src_dc );
+    DeleteDC( dst_dc );
+    DeleteDC( src24_dc );
+    DeleteObject( src_bmp );
+    DeleteObject( dst_bmp );
+    DeleteObject( src24_bmp );
+}
+
+static void do_large_blit( HDC hdc, HDC src_dc, int op, int width, int height )
+{
+    TRIVERTEX vert[2] = { { 0, 0, 0x1200, 0x3400, 0xff00, 0x8000 }, { width, height, 0xff00, 0x0100, 0x2000, 0x0000 } };
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    GRADIENT_RECT rect = { 0, 1 };
+
+    switch (op)
+    {
+    case 0:
+        SetStretchBltMode( hdc, COLORONCOLOR );
+        StretchBlt( hdc, 3, 5, width - 10, height - 7, src_dc, 10, 20, 170, 130, SRCCOPY );
+        break;
+    case 1:
+        SetStretchBltMode( hdc, BLACKONWHITE );
+        StretchBlt( hdc, width - 1, height - 1, -width + 2, -height + 2,
+                    src_dc, 0, 0, width, height * 2 / 3, SRCCOPY );
+        break;
+    case 2:
+        pGdiAlphaBlend( hdc, 0, 0, width, height, src_dc, 0, 0, width, height, blend );
+        break;
+    case 3:
+        pGdiGradientFill( hdc, vert, 2, &rect, 1, GRADIENT_FILL_RECT_V );
+        break;
+    }
+}
+
+/* Large operations may be processed in bands, check that they match the same
+ * operation clipped to thin strips. */
+static void test_large_blits(void)
+{
+    static const int width = 700, height = 600, strip = 16;
+    DWORD *src_bits, *full_bits, *strip_bits;
+    HBITMAP src_bmp, full_bmp, strip_bmp;
+    HDC src_dc, full_dc, strip_dc;
+    unsigned int seed = 0x4321;
+    BITMAPINFO bmi;
+    int i, y, op;
+    HRGN rgn;
+
+    if (!pGdiAlphaBlend || !pGdiGradientFill)
+    {
+        win_skip( "GdiAlphaBlend() or GdiGradientFill() is not implemented\n" );
+        return;
+    }
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    src_bmp = CreateDIBSection( NULL, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    full_bmp = CreateDIBSection( NULL, &bmi, DIB_RGB_COLORS, (void **)&full_bits, NULL, 0 );
+    strip_bmp = CreateDIBSection( NULL, &bmi, DIB_RGB_COLORS, (void **)&strip_bits, NULL, 0 );
+    ok( src_bmp && full_bmp && strip_bmp, "failed to create bitmaps\n" );
+
+    src_dc = CreateCompatibleDC( NULL );
+    full_dc = CreateCompatibleDC( NULL );
+    strip_dc = CreateCompatibleDC( NULL );
+    SelectObject( src_dc, src_bmp );
+    SelectObject( full_dc, full_bmp );
+    SelectObject( strip_dc, strip_bmp );
+
+    for (i = 0; i < width * height; i++)
+    {
+        DWORD alpha = (seed = seed * 1103515245 + 12345) >> 24;
+        src_bits[i] = (alpha << 24) | ((((seed = seed * 1103515245 + 12345) >> 8) & 0xffffff) & (alpha * 0x010101));
+    }
+
+    for (op = 0; op < 4; op++)
+    {
+        for (i = 0; i < width * height; i++) full_bits[i] = strip_bits[i] = i * 0x01020305;
+
+        do_large_blit( full_dc, src_dc, op, width, height );
+        for (y = 0; y < height; y += strip)
+        {
+            rgn = CreateRectRgn( 0, y, width, y + strip );
+            SelectClipRgn( strip_dc, rgn );
+            DeleteObject( rgn );
+            do_large_blit( strip_dc, src_dc, op, width, height );
+        }
+        SelectClipRgn( strip_dc, NULL );
+
+        for (i = 0; i < width * height - 1; i++) if (full_bits[i] != strip_bits[i]) break;
+        ok( full_bits[i] == strip_bits[i], "%d: %d,%d: got %08lx, expected %08lx\n",
+            op, i % width, i / width, full_bits[i], strip_bits[i] );
+    }
+
+    DeleteDC( src_dc );
+    DeleteDC( full_dc );
+    DeleteDC( strip_dc );
+    DeleteObject( src_bmp );
+    DeleteObject( full_bmp );
+    DeleteObject( strip_bmp );
+}
+
 static void test_GdiGradientFill(void)
 {
     HDC hdc;
@@ -6005,6 +6265,8 @@ START_TEST(bitmap)
     test_StretchBlt();
     test_StretchDIBits();
     test_GdiAlphaBlend();
+    test_GdiAlphaBlend_rows();
+    test_large_blits();
     test_GdiGradientFill();
     test_32bit_ddb();
     test_bitmapinfoheadersize();
@@ -3020,6 +3020,8 @@ static void draw_text_2( HDC hdc, const BITMAPINFO *bmi, BYTE *bits, BOOL aa )
     static const char str[] = "Hello Wine";
     POINT origin, g_org;
     static const BYTE vals[4] = { 0x00, 0x00, 0x00, 0x00 };
+    static const int spacing[] = { 20, 0 };
+    INT dx[ARRAY_SIZE(str)];
     COLORREF bk_color, text_color;
     TEXTMETRICA tm;
     RECT rect;
@@ -3132,6 +3134,28 @@ static void draw_text_2( HDC hdc, const BITMAPINFO *bmi, BYTE *bits, BOOL aa )
     HeapFree( GetProcessHeap(), 0, diy_hash );
     HeapFree( GetProcessHeap(), 0, eto_hash );
 
+    /* a string gives the same result as its glyphs drawn one by one, both
+     * when they are apart and when they are drawn on top of each other */
+    for (i = 0; i < ARRAY_SIZE(spacing); i++)
+    {
+        for (x = 0; x < dib_size; x++)
+            bits[x] = vals[x % 4];
+        for (x = 0; x < strlen(str); x++)
+            dx[x] = spacing[i];
+        ExtTextOutA( hdc, 10, 100, 0, NULL, str, strlen(str), dx );
+        eto_hash = hash_dib( hdc, bmi, bits );
+
+        for (x = 0; x < dib_size; x++)
+            bits[x] = vals[x % 4];
+        for (x = 0; x < strlen(str); x++)
+            ExtTextOutA( hdc, 10 + x * spacing[i], 100, 0, NULL, str + x, 1, NULL );
+        diy_hash = hash_dib( hdc, bmi, bits );
+        ok( !strcmp( eto_hash, diy_hash ), "hash mismatch - aa %d spacing %d\n", aa, spacing[i] );
+
+        HeapFree( GetProcessHeap(), 0, diy_hash );
+        HeapFree( GetProcessHeap(), 0, eto_hash );
+    }
+
     font = SelectObject( hdc, font );
     DeleteObject( font );
 }
@@ -7743,6 +7743,252 @@ static void test_GetOutlineTextMetrics_subst(void)
     ReleaseDC(0, hdc);
 }
 
+static void run_font_child(const char *args)
+{
+    char path_name[MAX_PATH], **argv;
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+
+    winetest_get_mainargs(&argv);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    sprintf(path_name, "%s font %s", argv[0], args);
+    ok(CreateProcessA(NULL, path_name, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info),
+       "CreateProcess failed.\n");
+    wait_child_process(info.hProcess);
+    CloseHandle(info.hProcess);
+    CloseHandle(info.hThread);
+}
+
+static BOOL write_font_file(const char *path, const char *fontname)
+{
+    void *rsrc_data;
+    DWORD rsrc_size;
+    HANDLE file;
+    BOOL ret;
+
+    if (!(rsrc_data = get_res_data(fontname, &rsrc_size))) return FALSE;
+
+    file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE) return FALSE;
+    ret = WriteFile(file, rsrc_data, rsrc_size, &rsrc_size, NULL);
+    CloseHandle(file);
+    return ret;
+}
+
+static BOOL get_file_write_time(const char *path, FILETIME *time)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) return FALSE;
+    *time = data.ftLastWriteTime;
+    return TRUE;
+}
+
+static void test_font_catalog_child(const char *present, const char *absent)
+{
+    if (strcmp(present, "-")) ok(is_font_installed(present), "%s is not installed\n", present);
+    ok(!is_font_installed(absent), "%s is installed\n", absent);
+}
+
+static void test_font_catalog(void)
+{
+    char fonts_dir[MAX_PATH], font_path[MAX_PATH], catalog_path[MAX_PATH];
+    FILETIME time, time2;
+    BOOL ret;
+
+    /* the faces of the font directories are cached in a file by Wine, check
+     * that new processes see the fonts as they are on disk */
+    if (strcmp(winetest_platform, "wine"))
+    {
+        skip("no font catalog\n");
+        return;
+    }
+
+    GetWindowsDirectoryA(fonts_dir, MAX_PATH);
+    sprintf(catalog_path, "%s\\fntcache.dat", fonts_dir);
+    strcat(fonts_dir, "\\Fonts");
+    sprintf(font_path, "%s\\wine_catalog_test.ttf", fonts_dir);
+
+    if (!write_font_file(font_path, "wine_test.ttf"))
+    {
+        skip("cannot write to %s\n", fonts_dir);
+        return;
+    }
+
+    /* the directory has changed, so the catalog is built again */
+    run_font_child("font_catalog wine_test wine_vdmx");
+    ret = get_file_write_time(catalog_path, &time);
+    ok(ret, "catalog not found\n");
+
+    /* nothing has changed, the catalog is reused */
+    run_font_child("font_catalog wine_test wine_vdmx");
+    ret = get_file_write_time(catalog_path, &time2);
+    ok(ret, "catalog not found\n");
+    ok(!CompareFileTime(&time, &time2), "catalog was saved again\n");
+
+    /* replacing the file doesn't change the directory */
+    ret = write_font_file(font_path, "wine_vdmx.ttf");
+    ok(ret, "failed to replace %s\n", font_path);
+    run_font_child("font_catalog wine_vdmx wine_test");
+    ret = get_file_write_time(catalog_path, &time2);
+    ok(ret, "catalog not found\n");
+    ok(CompareFileTime(&time, &time2), "catalog was not saved again\n");
+
+    ret = DeleteFileA(font_path);
+    ok(ret, "DeleteFile failed, error %lu\n", GetLastError());
+    run_font_child("font_catalog - wine_vdmx");
+}
+
+static void test_lazy_faces_child(const char *mode)
+{
+    static const WCHAR family[] = L"Wine Lang Cond (en)";
+    static const WCHAR fullname[] = L"Wine Lang Cond Reg (en)";
+    struct enum_fullname_data_w efnd;
+    char ttf_name[MAX_PATH];
+    LOGFONTW lf = {0};
+    WCHAR buffer[LF_FULLFACESIZE];
+    HFONT hfont, old_hfont;
+    BOOL ret;
+    HDC hdc;
+    int i;
+
+    /* every lookup is done on a fresh process, so that the faces loaded from
+     * the catalog are still lazy when they are first looked up */
+    hdc = CreateCompatibleDC(0);
+
+    if (!strcmp(mode, "family") || !strcmp(mode, "fullname"))
+    {
+        wcscpy(lf.lfFaceName, !strcmp(mode, "family") ? family : fullname);
+        lf.lfHeight = 20;
+        hfont = CreateFontIndirectW(&lf);
+        old_hfont = SelectObject(hdc, hfont);
+        ret = get_ttf_nametable_entry(hdc, TT_NAME_ID_FULL_NAME, buffer, sizeof(buffer),
+                                      TT_MS_LANGID_ENGLISH_UNITED_STATES);
+        ok(ret, "%s: full name not found\n", mode);
+        ok(!wcscmp(buffer, fullname), "%s: got %s\n", mode, wine_dbgstr_w(buffer));
+        SelectObject(hdc, old_hfont);
+        DeleteObject(hfont);
+
+        lf.lfCharSet = DEFAULT_CHARSET;
+        memset(&efnd, 0, sizeof(efnd));
+        EnumFontFamiliesExW(hdc, &lf, enum_fullname_data_proc_w, (LPARAM)&efnd, 0);
+        ok(efnd.total == 1, "%s: got %u faces\n", mode, efnd.total);
+        if (efnd.total)
+        {
+            ok(!wcscmp(efnd.elf[0].elfLogFont.lfFaceName, family), "%s: got family %s\n",
+               mode, wine_dbgstr_w(efnd.elf[0].elfLogFont.lfFaceName));
+            ok(!wcscmp(efnd.elf[0].elfFullName, fullname), "%s: got full name %s\n",
+               mode, wine_dbgstr_w(efnd.elf[0].elfFullName));
+        }
+        heap_free(efnd.elf);
+    }
+    else if (!strcmp(mode, "enum"))
+    {
+        /* enumerating every family has to load the lazy ones */
+        lf.lfCharSet = DEFAULT_CHARSET;
+        memset(&efnd, 0, sizeof(efnd));
+        EnumFontFamiliesExW(hdc, &lf, enum_fullname_data_proc_w, (LPARAM)&efnd, 0);
+        for (i = 0; i < efnd.total; i++)
+            if (!wcscmp(efnd.elf[i].elfLogFont.lfFaceName, family)) break;
+        ok(i < efnd.total, "%s not enumerated\n", wine_dbgstr_w(family));
+        if (i < efnd.total)
+            ok(!wcscmp(efnd.elf[i].elfFullName, fullname), "got full name %s\n",
+               wine_dbgstr_w(efnd.elf[i].elfFullName));
+        heap_free(efnd.elf);
+
+        /* the localized family names are still there */
+        wcscpy(lf.lfFaceName, L"Wine Lang Cond (zh-tw)");
+        memset(&efnd, 0, sizeof(efnd));
+        EnumFontFamiliesExW(hdc, &lf, enum_fullname_data_proc_w, (LPARAM)&efnd, 0);
+        ok(efnd.total == 1, "got %u faces\n", efnd.total);
+        heap_free(efnd.elf);
+    }
+    else if (!strcmp(mode, "add"))
+    {
+        /* a face added to a lazy family doesn't hide the catalog ones */
+        if (!write_ttf_file("wine_langnames2.ttf", ttf_name))
+        {
+            skip("Failed to create ttf file for testing\n");
+            DeleteDC(hdc);
+            return;
+        }
+        ret = AddFontResourceExA(ttf_name, FR_PRIVATE, 0);
+        ok(ret, "AddFontResourceEx() failed\n");
+
+        wcscpy(lf.lfFaceName, family);
+        lf.lfCharSet = DEFAULT_CHARSET;
+        memset(&efnd, 0, sizeof(efnd));
+        EnumFontFamiliesExW(hdc, &lf, enum_fullname_data_proc_w, (LPARAM)&efnd, 0);
+        ok(efnd.total == 2, "got %u faces\n", efnd.total);
+        heap_free(efnd.elf);
+
+        ret = RemoveFontResourceExA(ttf_name, FR_PRIVATE, 0);
+        ok(ret, "RemoveFontResourceEx() failed\n");
+        DeleteFileA(ttf_name);
+
+        memset(&efnd, 0, sizeof(efnd));
+        EnumFontFamiliesExW(hdc, &lf, enum_fullname_data_proc_w, (LPARAM)&efnd, 0);
+        ok(efnd.total == 1, "got %u faces\n", efnd.total);
+        heap_free(efnd.elf);
+    }
+    else if (!strcmp(mode, "removed"))
+    {
+        wcscpy(lf.lfFaceName, family);
+        lf.lfCharSet = DEFAULT_CHARSET;
+        memset(&efnd, 0, sizeof(efnd));
+        EnumFontFamiliesExW(hdc, &lf, enum_fullname_data_proc_w, (LPARAM)&efnd, 0);
+        ok(!efnd.total, "got %u faces\n", efnd.total);
+        heap_free(efnd.elf);
+    }
+
+    DeleteDC(hdc);
+}
+
+static void test_lazy_faces(void)
+{
+    static const char *modes[] = { "family", "fullname", "enum", "add" };
+    char fonts_dir[MAX_PATH], font_path[MAX_PATH], args[64];
+    BOOL ret;
+    int i;
+
+    /* the faces read from the font catalog are only loaded when their family
+     * is looked up */
+    if (strcmp(winetest_platform, "wine"))
+    {
+        skip("no font catalog\n");
+        return;
+    }
+    if (PRIMARYLANGID(GetSystemDefaultLangID()) != LANG_ENGLISH)
+    {
+        skip("Primary language is not English, skipping test\n");
+        return;
+    }
+
+    GetWindowsDirectoryA(fonts_dir, MAX_PATH);
+    strcat(fonts_dir, "\\Fonts");
+    sprintf(font_path, "%s\\wine_lazy_test.ttf", fonts_dir);
+
+    if (!write_font_file(font_path, "wine_langnames.ttf"))
+    {
+        skip("cannot write to %s\n", fonts_dir);
+        return;
+    }
+
+    /* the first child builds the catalog and loads every face */
+    run_font_child("lazy_faces family");
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        sprintf(args, "lazy_faces %s", modes[i]);
+        run_font_child(args);
+    }
+
+    ret = DeleteFileA(font_path);
+    ok(ret, "DeleteFile failed, error %lu\n", GetLastError());
+    run_font_child("lazy_faces removed");
+}
+
 START_TEST(font)
 {
     static const char *test_names[] =
@@ -7761,6 +8007,10 @@ START_TEST(font)
     {
         if (!strcmp(argv[2], "AddFontMemResource"))
             test_AddFontMemResource();
+        else if (!strcmp(argv[2], "font_catalog") && argc >= 5)
+            test_font_catalog_child(argv[3], argv[4]);
+        else if (!strcmp(argv[2], "lazy_faces") && argc >= 4)
+            test_lazy_faces_child(argv[3]);
         return;
     }
 
@@ -7832,6 +8082,8 @@ START_TEST(font)
     test_lang_names();
     test_char_width();
     test_select_object();
+    test_font_catalog();
+    test_lazy_faces();
 
     /* These tests should be last test until RemoveFontResource
      * is properly implemented.
@@ -380,6 +380,8 @@ static void load_locale_nls(void)
 }
 
 
+static void init_ascii_keys(void);
+
 static void init_sortkeys( DWORD *ptr )
 {
     WORD *ctype;
@@ -1783,6 +1785,7 @@ void init_locale( HMODULE module )
     NtGetNlsSectionPtr( 9, 0, NULL, &sort_ptr, &size );
     NtGetNlsSectionPtr( 12, NormalizationC, NULL, (void **)&norm_info, &size );
     init_sortkeys( sort_ptr );
+    init_ascii_keys();
 
     ansi_ptr = NtCurrentTeb()->Peb->AnsiCodePageData ? NtCurrentTeb()->Peb->AnsiCodePageData : utf8;
     oem_ptr = NtCurrentTeb()->Peb->OemCodePageData ? NtCurrentTeb()->Peb->OemCodePageData : utf8;
@@ -3161,6 +3164,75 @@ static int get_sortkey( DWORD flags, const WCHAR *src, int srclen, char *dst, in
 }
 
 
+/* cache of the sort keys of short strings, applications tend to request the same keys repeatedly */
+#define SORTKEY_CACHE_SIZE    64
+#define SORTKEY_CACHE_MAX_SRC 32
+#define SORTKEY_CACHE_MAX_KEY (SORTKEY_CACHE_MAX_SRC * 6 + 5)  /* 6 bytes per char, separators and null */
+
+struct sortkey_cache_entry
+{
+    DWORD        flags;
+    unsigned int hash;
+    int          srclen;
+    int          len;      /* key length without the final null, 0 if unused */
+    WCHAR        src[SORTKEY_CACHE_MAX_SRC];
+    char         key[SORTKEY_CACHE_MAX_KEY];
+};
+
+static struct sortkey_cache_entry sortkey_cache[SORTKEY_CACHE_SIZE];
+static SRWLOCK sortkey_cache_lock = SRWLOCK_INIT;
+
+static unsigned int hash_sortkey_source( DWORD flags, const WCHAR *src, int srclen )
+{
+    unsigned int hash = 2166136261u ^ flags;
+
+    while (srclen--) hash = (hash ^ *src++) * 16777619u;
+    return hash;
+}
+
+static int copy_cached_sortkey( const struct sortkey_cache_entry *entry, char *dst, int dstlen )
+{
+    if (!dstlen) return entry->len;
+    if (dstlen < entry->len + 1) return 0; /* overflow */
+    memcpy( dst, entry->key, entry->len + 1 );
+    return entry->len;
+}
+
+/* same as get_sortkey, going through the sort key cache for short strings */
+static int get_cached_sortkey( DWORD flags, const WCHAR *src, int srclen, char *dst, int dstlen )
+{
+    struct sortkey_cache_entry *entry;
+    unsigned int hash;
+    char key[SORTKEY_CACHE_MAX_KEY];
+    int len, ret = -1;
+
+    if (srclen > SORTKEY_CACHE_MAX_SRC) return get_sortkey( flags, src, srclen, dst, dstlen );
+
+    hash = hash_sortkey_source( flags, src, srclen );
+    entry = &sortkey_cache[hash % SORTKEY_CACHE_SIZE];
+
+    RtlAcquireSRWLockShared( &sortkey_cache_lock );
+    if (entry->len && entry->hash == hash && entry->flags == flags && entry->srclen == srclen &&
+        !memcmp( entry->src, src, srclen * sizeof(WCHAR) ))
+        ret = copy_cached_sortkey( entry, dst, dstlen );
+    RtlReleaseSRWLockShared( &sortkey_cache_lock );
+    if (ret != -1) return ret;
+
+    if (!(len = get_sortkey( flags, src, srclen, key, sizeof(key) ))) return 0;
+
+    RtlAcquireSRWLockExclusive( &sortkey_cache_lock );
+    entry->flags = flags;
+    entry->hash = hash;
+    entry->srclen = srclen;
+    entry->len = len;
+    memcpy( entry->src, src, srclen * sizeof(WCHAR) );
+    memcpy( entry->key, key, len + 1 );
+    ret = copy_cached_sortkey( entry, dst, dstlen );
+    RtlReleaseSRWLockExclusive( &sortkey_cache_lock );
+    return ret;
+}
+
+
 /* compose a full-width katakana. return consumed source characters. */
 static int compose_katakana( const WCHAR *src, int srclen, WCHAR *dst )
 {
@@ -3393,6 +3465,141 @@ static unsigned int get_weight( WCHAR ch, enum weight type )
 }
 
 
+/* collation elements of the ASCII characters that have non-zero weights, with the low bit
+ * set for the characters ignored by NORM_IGNORESYMBOLS; 0 for the other characters */
+static unsigned int ascii_keys[0x80];
+static BOOL ascii_printable_keys;  /* all the characters from 0x20 to 0x7e have a key */
+
+#define ASCII_KEY_SYMBOL 1
+
+static void init_ascii_keys(void)
+{
+    unsigned int ch, ce;
+
+    ascii_printable_keys = TRUE;
+    for (ch = 0; ch < 0x80; ch++)
+    {
+        ce = collation_table[collation_table[collation_table[0] + (ch >> 4)] + (ch & 0xf)];
+        if (ce == ~0u || !(ce >> 16) || !((ce >> 8) & 0xff) || !((ce >> 4) & 0x0f)) ce = 0;
+        else
+        {
+            ce &= ~0xf;
+            if (get_char_type( CT_CTYPE1, ch ) & (C1_PUNCT | C1_SPACE)) ce |= ASCII_KEY_SYMBOL;
+        }
+        ascii_keys[ch] = ce;
+        if (!ce && ch >= 0x20 && ch < 0x7f) ascii_printable_keys = FALSE;
+    }
+}
+
+static inline BOOL is_printable_ascii( UINT64 chars )
+{
+    /* four characters in 0x20..0x7e, the additions can't carry into the next character */
+    return !(chars & 0xff80ff80ff80ff80ull) &&
+           ((chars + 0x0060006000600060ull) & 0x0080008000800080ull) == 0x0080008000800080ull &&
+           !((chars + 0x0001000100010001ull) & 0x0080008000800080ull);
+}
+
+/* length of the common prefix made of ASCII characters with non-zero weights; such characters
+ * compare equal in all the passes and don't change the alignment of the remaining strings */
+static int get_common_ascii_prefix( const WCHAR *str1, const WCHAR *str2, int len )
+{
+    UINT64 chars1, chars2;
+    int pos = 0;
+
+    if (ascii_printable_keys)
+    {
+        for (; pos + 4 <= len; pos += 4)
+        {
+            memcpy( &chars1, str1 + pos, sizeof(chars1) );
+            memcpy( &chars2, str2 + pos, sizeof(chars2) );
+            if (chars1 != chars2 || !is_printable_ascii( chars1 )) break;
+        }
+    }
+    while (pos < len && str1[pos] == str2[pos] && str1[pos] < 0x80 && ascii_keys[str1[pos]]) pos++;
+    return pos;
+}
+
+static BOOL is_ascii_compare_string( DWORD flags, const WCHAR *str, int len )
+{
+    for ( ; len; len--, str++)
+    {
+        if (*str >= 0x80 || !ascii_keys[*str]) return FALSE;
+        /* hyphen and apostrophe are only skipped in the Unicode weight pass */
+        if ((*str == '-' || *str == '\'') && !(flags & SORT_STRINGSORT) &&
+            !((flags & NORM_IGNORESYMBOLS) && (ascii_keys[*str] & ASCII_KEY_SYMBOL)))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* compare ASCII strings in a single pass for all the weights. This is only possible when no
+ * character is skipped in one pass and not in the others, so that the strings stay aligned. */
+static BOOL compare_ascii_strings( DWORD flags, const WCHAR *str1, int len1,
+                                   const WCHAR *str2, int len2, int *ret )
+{
+    int diacritic = 0, case_diff = 0;
+    unsigned int key1, key2;
+
+    if (!is_ascii_compare_string( flags, str1, len1 ) || !is_ascii_compare_string( flags, str2, len2 ))
+        return FALSE;
+
+    while (len1 > 0 && len2 > 0)
+    {
+        key1 = ascii_keys[*str1];
+        key2 = ascii_keys[*str2];
+        if (flags & NORM_IGNORESYMBOLS)
+        {
+            int skip = 0;
+            if (key1 & ASCII_KEY_SYMBOL)
+            {
+                str1++;
+                len1--;
+                skip = 1;
+            }
+            if (key2 & ASCII_KEY_SYMBOL)
+            {
+                str2++;
+                len2--;
+                skip = 1;
+            }
+            if (skip) continue;
+        }
+        if ((key1 >> 16) != (key2 >> 16))
+        {
+            *ret = (int)(key1 >> 16) - (int)(key2 >> 16);
+            return TRUE;
+        }
+        if (!diacritic) diacritic = (int)((key1 >> 8) & 0xff) - (int)((key2 >> 8) & 0xff);
+        if (!case_diff) case_diff = (int)((key1 >> 4) & 0x0f) - (int)((key2 >> 4) & 0x0f);
+        str1++;
+        str2++;
+        len1--;
+        len2--;
+    }
+    /* no zero weights, so the remaining characters are never skipped */
+    if (!(*ret = len1 - len2))
+    {
+        if (!(flags & NORM_IGNORENONSPACE)) *ret = diacritic;
+        if (!*ret && !(flags & NORM_IGNORECASE)) *ret = case_diff;
+    }
+    return TRUE;
+}
+
+
+static const WCHAR *get_compare_decomposition( const WCHAR *str, unsigned int *len )
+{
+    const WCHAR *ret;
+
+    /* ASCII characters never decompose */
+    if (*str < 0x80 || !(ret = get_decomposition( *str, len )))
+    {
+        *len = 1;
+        return str;
+    }
+    return ret;
+}
+
+
 static void inc_str_pos( const WCHAR **str, int *len, unsigned int *dpos, unsigned int *dlen )
 {
     (*dpos)++;
@@ -3413,8 +3620,8 @@ static int compare_weights(int flags, const WCHAR *str1, int len1,
 
     while (len1 > 0 && len2 > 0)
     {
-        if (!dlen1 && !(dstr1 = get_decomposition( *str1, &dlen1 ))) dstr1 = str1;
-        if (!dlen2 && !(dstr2 = get_decomposition( *str2, &dlen2 ))) dstr2 = str2;
+        if (!dlen1) dstr1 = get_compare_decomposition( str1, &dlen1 );
+        if (!dlen2) dstr2 = get_compare_decomposition( str2, &dlen2 );
 
         if (flags & NORM_IGNORESYMBOLS)
         {
@@ -3473,14 +3680,14 @@ static int compare_weights(int flags, const WCHAR *str1, int len1,
     }
     while (len1)
     {
-        if (!dlen1 && !(dstr1 = get_decomposition( *str1, &dlen1 ))) dstr1 = str1;
+        if (!dlen1) dstr1 = get_compare_decomposition( str1, &dlen1 );
         ce1 = get_weight( dstr1[dpos1], type );
         if (ce1) break;
         inc_str_pos( &str1, &len1, &dpos1, &dlen1 );
     }
     while (len2)
     {
-        if (!dlen2 && !(dstr2 = get_decomposition( *str2, &dlen2 ))) dstr2 = str2;
+        if (!dlen2) dstr2 = get_compare_decomposition( str2, &dlen2 );
         ce2 = get_weight( dstr2[dpos2], type );
         if (ce2) break;
         inc_str_pos( &str2, &len2, &dpos2, &dlen2 );
@@ -3997,7 +4204,7 @@ INT WINAPI CompareStringEx( const WCHAR *locale, DWORD flags, const WCHAR *str1,
     DWORD semistub_flags = NORM_LINGUISTIC_CASING | LINGUISTIC_IGNORECASE | LINGUISTIC_IGNOREDIACRITIC |
                            SORT_DIGITSASNUMBERS | 0x10000000;
     /* 0x10000000 is related to diacritics in Arabic, Japanese, and Hebrew */
-    INT ret;
+    INT ret, prefix;
     static int once;
 
     if (version) FIXME( "unexpected version parameter\n" );
@@ -4024,13 +4231,22 @@ INT WINAPI CompareStringEx( const WCHAR *locale, DWORD flags, const WCHAR *str1,
     if (len1 < 0) len1 = lstrlenW(str1);
     if (len2 < 0) len2 = lstrlenW(str2);
 
-    ret = compare_weights( flags, str1, len1, str2, len2, UNICODE_WEIGHT );
-    if (!ret)
+    prefix = get_common_ascii_prefix( str1, str2, min( len1, len2 ));
+    str1 += prefix;
+    str2 += prefix;
+    len1 -= prefix;
+    len2 -= prefix;
+
+    if (!compare_ascii_strings( flags, str1, len1, str2, len2, &ret ))
     {
-        if (!(flags & NORM_IGNORENONSPACE))
-            ret = compare_weights( flags, str1, len1, str2, len2, DIACRITIC_WEIGHT );
-        if (!ret && !(flags & NORM_IGNORECASE))
-            ret = compare_weights( flags, str1, len1, str2, len2, CASE_WEIGHT );
+        ret = compare_weights( flags, str1, len1, str2, len2, UNICODE_WEIGHT );
+        if (!ret)
+        {
+            if (!(flags & NORM_IGNORENONSPACE))
+                ret = compare_weights( flags, str1, len1, str2, len2, DIACRITIC_WEIGHT );
+            if (!ret && !(flags & NORM_IGNORECASE))
+                ret = compare_weights( flags, str1, len1, str2, len2, CASE_WEIGHT );
+        }
     }
     if (!ret) return CSTR_EQUAL;
     return (ret < 0) ? CSTR_LESS_THAN : CSTR_GREATER_THAN;
@@ -5842,7 +6058,7 @@ INT WINAPI DECLSPEC_HOTPATCH LCMapStringEx( const WCHAR *locale, DWORD flags, co
         TRACE( "(%s,0x%08lx,%s,%d,%p,%d)\n",
                debugstr_w(locale), flags, debugstr_wn(src, srclen), srclen, dst, dstlen );
 
-        if ((ret = get_sortkey( flags, src, srclen, (char *)dst, dstlen ))) ret++;
+        if ((ret = get_cached_sortkey( flags, src, srclen, (char *)dst, dstlen ))) ret++;
         else SetLastError( ERROR_INSUFFICIENT_BUFFER );
         return ret;
     }
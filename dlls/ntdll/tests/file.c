@@ -1079,6 +1079,76 @@ static void test_set_io_completion(void)
     pNtClose( h );
 }
 
+static void test_io_completion_order(void)
+{
+    FILE_IO_COMPLETION_INFORMATION info[16];
+    LARGE_INTEGER timeout = {{0}};
+    IO_STATUS_BLOCK iosb;
+    ULONG_PTR key, value;
+    ULONG i, j, count;
+    NTSTATUS res;
+    HANDLE h;
+
+    res = pNtCreateIoCompletion( &h, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+    ok( res == STATUS_SUCCESS, "NtCreateIoCompletion failed: %#lx\n", res );
+
+    /* queue enough packets to overflow any internal buffering */
+    for (i = 0; i < 3000; i++)
+    {
+        res = pNtSetIoCompletion( h, i, i * 2, STATUS_SUCCESS, i * 3 );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#lx\n", res );
+    }
+
+    count = get_pending_msgs(h);
+    ok( count == 3000, "Unexpected msg count: %ld\n", count );
+
+    for (i = 0; i < 1500; i++)
+    {
+        res = pNtRemoveIoCompletion( h, &key, &value, &iosb, &timeout );
+        ok( res == STATUS_SUCCESS, "NtRemoveIoCompletion failed: %#lx\n", res );
+        if (key != i || value != i * 2 || iosb.Information != i * 3)
+        {
+            ok( 0, "wrong packet %Iu %Iu %Iu, expected %lu\n", key, value, iosb.Information, i );
+            break;
+        }
+    }
+
+    /* packets posted now are queued after the remaining ones */
+    res = pNtSetIoCompletion( h, 3000, 6000, STATUS_SUCCESS, 9000 );
+    ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#lx\n", res );
+
+    if (pNtRemoveIoCompletionEx)
+    {
+        while (i <= 3000)
+        {
+            res = pNtRemoveIoCompletionEx( h, info, ARRAY_SIZE(info), &count, &timeout, FALSE );
+            ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#lx\n", res );
+            if (res) break;
+            for (j = 0; j < count; j++, i++)
+                ok( info[j].CompletionKey == i, "wrong key %Iu, expected %lu\n", info[j].CompletionKey, i );
+        }
+    }
+    else
+    {
+        while (i <= 3000)
+        {
+            res = pNtRemoveIoCompletion( h, &key, &value, &iosb, &timeout );
+            ok( res == STATUS_SUCCESS, "NtRemoveIoCompletion failed: %#lx\n", res );
+            if (res) break;
+            ok( key == i, "wrong key %Iu, expected %lu\n", key, i );
+            i++;
+        }
+    }
+
+    count = get_pending_msgs(h);
+    ok( !count, "Unexpected msg count: %ld\n", count );
+
+    res = pNtRemoveIoCompletion( h, &key, &value, &iosb, &timeout );
+    ok( res == STATUS_TIMEOUT, "NtRemoveIoCompletion failed: %#lx\n", res );
+
+    pNtClose( h );
+}
+
 static void test_file_io_completion(void)
 {
     static const char pipe_name[] = "\\\\.\\pipe\\iocompletiontestnamedpipe";
@@ -5291,6 +5361,7 @@ START_TEST(file)
     append_file_test();
     nt_mailslot_test();
     test_set_io_completion();
+    test_io_completion_order();
     test_file_io_completion();
     test_file_basic_information();
     test_file_all_information();
@@ -25,13 +25,19 @@
 #pragma makedep unix
 #endif
 
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
 #include "winternl.h"
 #include "unix_private.h"
+#include "wine/server.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(reg);
@@ -39,6 +45,178 @@ WINE_DEFAULT_DEBUG_CHANNEL(reg);
 /* maximum length of a value name in bytes (without terminating null) */
 #define MAX_VALUE_LENGTH (16383 * sizeof(WCHAR))
 
+/* cache of recently queried values, validated against the server generation counters */
+#define VALUE_CACHE_SIZE     256
+#define VALUE_CACHE_MAX_DATA 4096  /* max. size of cached name and data */
+
+struct value_cache_entry
+{
+    HANDLE        handle;    /* key handle the value was queried on */
+    unsigned int  slot;      /* slot of the key in the counters, 0 if entry is unused */
+    unsigned int  gen;       /* generation of the key when the value was queried */
+    NTSTATUS      status;    /* STATUS_SUCCESS or STATUS_OBJECT_NAME_NOT_FOUND */
+    int           type;      /* value type */
+    data_size_t   total;     /* total length of the value data */
+    USHORT        name_len;  /* length of the value name in bytes */
+    BOOL          has_data;  /* whether the full data is stored after the name */
+    void         *buffer;    /* value name followed by the data */
+};
+
+static struct value_cache_entry value_cache[VALUE_CACHE_SIZE];
+static const volatile unsigned int *cache_counters;
+static unsigned int cache_slots;
+static int cache_state;  /* 0 if not initialized yet, -1 if not available */
+static unsigned int cache_close_count;  /* incremented each time handles are invalidated */
+static unsigned int cache_used;
+static pthread_mutex_t value_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* map the generation counters shared by the server */
+static BOOL init_value_cache(void)
+{
+    sigset_t sigset;
+    obj_handle_t fd_handle;
+    data_size_t size = 0;
+    void *ptr;
+    int fd = -1;
+
+    if (cache_state) return cache_state > 0;
+
+    /* we need to hold the fd cache mutex so that our receive_fd doesn't race with the others */
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    if (!cache_state)
+    {
+        SERVER_START_REQ( get_registry_cache_fd )
+        {
+            if (!wine_server_call( req ))
+            {
+                fd = receive_fd( &fd_handle );
+                size = reply->size;
+            }
+        }
+        SERVER_END_REQ;
+
+        cache_state = -1;
+        if (fd != -1)
+        {
+            ptr = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+            if (ptr != MAP_FAILED)
+            {
+                cache_counters = ptr;
+                cache_slots = size / sizeof(*cache_counters);
+                cache_state = 1;
+            }
+            close( fd );
+        }
+        if (cache_state < 0) WARN( "registry cache not available\n" );
+    }
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    return cache_state > 0;
+}
+
+static struct value_cache_entry *get_value_cache_entry( HANDLE handle, const UNICODE_STRING *name )
+{
+    unsigned int i, hash = (ULONG_PTR)handle >> 2;
+
+    for (i = 0; i < name->Length / sizeof(WCHAR); i++) hash = hash * 31 + name->Buffer[i];
+    return &value_cache[hash % VALUE_CACHE_SIZE];
+}
+
+static BOOL is_cache_entry_valid( const struct value_cache_entry *entry, HANDLE handle,
+                                  const UNICODE_STRING *name )
+{
+    return entry->slot && entry->handle == handle && entry->name_len == name->Length &&
+           entry->slot < cache_slots && cache_counters[entry->slot] == entry->gen &&
+           !memcmp( entry->buffer, name->Buffer, name->Length );
+}
+
+/* look for a value in the cache; data is NULL if only the type and length are needed */
+static BOOL get_cached_value( HANDLE handle, const UNICODE_STRING *name, void *data, DWORD size,
+                              int *type, data_size_t *total, NTSTATUS *status )
+{
+    struct value_cache_entry *entry;
+    sigset_t sigset;
+    BOOL ret = FALSE;
+
+    if (!init_value_cache()) return FALSE;
+
+    server_enter_uninterrupted_section( &value_cache_mutex, &sigset );
+    entry = get_value_cache_entry( handle, name );
+    if (is_cache_entry_valid( entry, handle, name ) && (!data || !size || entry->has_data))
+    {
+        *status = entry->status;
+        *type   = entry->type;
+        *total  = entry->total;
+        if (data && size)
+            memcpy( data, (char *)entry->buffer + entry->name_len, min( size, entry->total ));
+        ret = TRUE;
+    }
+    server_leave_uninterrupted_section( &value_cache_mutex, &sigset );
+    return ret;
+}
+
+/* store the result of a get_key_value request; data_len is the amount of data received */
+static void cache_value( HANDLE handle, const UNICODE_STRING *name, NTSTATUS status,
+                         unsigned int slot, unsigned int gen, int type, data_size_t total,
+                         const void *data, data_size_t data_len, unsigned int close_count )
+{
+    struct value_cache_entry *entry;
+    BOOL has_data = (data_len == total);
+    sigset_t sigset;
+    void *buffer;
+
+    if (status && status != STATUS_OBJECT_NAME_NOT_FOUND) return;
+    if (cache_state <= 0 || !slot || slot >= cache_slots) return;
+    if (name->Length > VALUE_CACHE_MAX_DATA) return;
+    if (name->Length + total > VALUE_CACHE_MAX_DATA) has_data = FALSE;
+    if (!(buffer = malloc( name->Length + (has_data ? total : 0) ))) return;
+    memcpy( buffer, name->Buffer, name->Length );
+    if (has_data) memcpy( (char *)buffer + name->Length, data, total );
+
+    server_enter_uninterrupted_section( &value_cache_mutex, &sigset );
+    /* the handle may have been closed and reused while the request was in progress */
+    if (close_count == cache_close_count)
+    {
+        entry = get_value_cache_entry( handle, name );
+        free( entry->buffer );
+        entry->handle   = handle;
+        entry->slot     = slot;
+        entry->gen      = gen;
+        entry->status   = status;
+        entry->type     = type;
+        entry->total    = total;
+        entry->name_len = name->Length;
+        entry->has_data = has_data;
+        entry->buffer   = buffer;
+        buffer = NULL;
+        cache_used = 1;
+    }
+    server_leave_uninterrupted_section( &value_cache_mutex, &sigset );
+    free( buffer );
+}
+
+/***********************************************************************
+ *           close_registry_cache_handle
+ *
+ * Remove the cached values of a handle that is being closed.
+ */
+void close_registry_cache_handle( HANDLE handle )
+{
+    unsigned int i;
+    sigset_t sigset;
+
+    if (!cache_used) return;
+
+    server_enter_uninterrupted_section( &value_cache_mutex, &sigset );
+    cache_close_count++;
+    for (i = 0; i < VALUE_CACHE_SIZE; i++)
+    {
+        if (!value_cache[i].slot || value_cache[i].handle != handle) continue;
+        free( value_cache[i].buffer );
+        memset( &value_cache[i], 0, sizeof(value_cache[i]) );
+    }
+    server_leave_uninterrupted_section( &value_cache_mutex, &sigset );
+}
+
 
 NTSTATUS open_hkcu_key( const char *path, HANDLE *key )
 {
@@ -460,7 +638,9 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
 {
     NTSTATUS ret;
     UCHAR *data_ptr;
-    unsigned int fixed_size, min_size;
+    unsigned int fixed_size, min_size, close_count;
+    data_size_t total;
+    int type;
 
     TRACE( "(%p,%s,%d,%p,%d)\n", handle, debugstr_us(name), info_class, info, length );
 
@@ -501,21 +681,31 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
         return STATUS_INVALID_PARAMETER;
     }
 
-    SERVER_START_REQ( get_key_value )
+    if (!get_cached_value( handle, name, data_ptr, length > fixed_size ? length - fixed_size : 0,
+                           &type, &total, &ret ))
     {
-        req->hkey = wine_server_obj_handle( handle );
-        wine_server_add_data( req, name->Buffer, name->Length );
-        if (length > fixed_size && data_ptr) wine_server_set_reply( req, data_ptr, length - fixed_size );
-        if (!(ret = wine_server_call( req )))
+        close_count = cache_close_count;
+        SERVER_START_REQ( get_key_value )
         {
-            copy_key_value_info( info_class, info, length, reply->type,
-                                 name->Length, reply->total );
-            *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : reply->total);
-            if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
-            else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
+            req->hkey = wine_server_obj_handle( handle );
+            wine_server_add_data( req, name->Buffer, name->Length );
+            if (length > fixed_size && data_ptr) wine_server_set_reply( req, data_ptr, length - fixed_size );
+            ret = wine_server_call( req );
+            type = reply->type;
+            total = reply->total;
+            cache_value( handle, name, ret, reply->cache_slot, reply->cache_gen, type, total,
+                         data_ptr, data_ptr ? wine_server_reply_size( reply ) : 0, close_count );
         }
+        SERVER_END_REQ;
+    }
+
+    if (!ret)
+    {
+        copy_key_value_info( info_class, info, length, type, name->Length, total );
+        *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : total);
+        if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
+        else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
     }
-    SERVER_END_REQ;
     return ret;
 }
 
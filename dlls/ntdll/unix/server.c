@@ -179,6 +179,80 @@ static DECLSPEC_NORETURN void server_protocol_perror( const char *err )
 }
 
 
+/* check whether reply data of a given size is passed through the data window */
+static inline BOOL use_data_window( data_size_t size )
+{
+    return size >= DATA_WINDOW_THRESHOLD && size <= ntdll_get_thread_data()->data_window_size;
+}
+
+
+/***********************************************************************
+ *           set_data_window
+ *
+ * Get a shared memory window from the server, large enough for reply data of the given size.
+ */
+static void set_data_window( data_size_t size )
+{
+    static BOOL disabled;
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+    obj_handle_t fd_handle;
+    unsigned int status;
+    void *ptr = MAP_FAILED;
+    sigset_t sigset;
+    int fd = -1;
+
+    if (disabled) return;
+    size = max( size - 1, DATA_WINDOW_THRESHOLD - 1 );
+    while (size & (size + 1)) size |= size >> 1;  /* round up to a power of 2 */
+    size++;
+
+    /* the fd cache mutex serializes receive_fd(), but the caller may already hold it;
+     * the reply data can go through the pipe this time */
+    pthread_sigmask( SIG_BLOCK, &server_block_set, &sigset );
+    if (pthread_mutex_trylock( &fd_cache_mutex ))
+    {
+        pthread_sigmask( SIG_SETMASK, &sigset, NULL );
+        return;
+    }
+    SERVER_START_REQ( set_data_window )
+    {
+        req->size = size;
+        if (!(status = wine_server_call( req ))) fd = receive_fd( &fd_handle );
+    }
+    SERVER_END_REQ;
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+
+    if (fd != -1)
+    {
+        /* the server owns the window, we only get to read it */
+        ptr = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+        close( fd );
+    }
+    if (thread_data->data_window) munmap( thread_data->data_window, thread_data->data_window_size );
+    thread_data->data_window = NULL;
+    thread_data->data_window_size = 0;
+
+    if (ptr == MAP_FAILED)
+    {
+        WARN( "cannot map data window, status %#x\n", status );
+        disabled = TRUE;
+        /* make sure that the server doesn't send replies through a window we can't see */
+        if (!status)
+        {
+            SERVER_START_REQ( set_data_window )
+            {
+                req->size = 0;
+                wine_server_call( req );
+            }
+            SERVER_END_REQ;
+        }
+        return;
+    }
+    thread_data->data_window = ptr;
+    thread_data->data_window_size = size;
+}
+
+
 /***********************************************************************
  *           send_request
  *
@@ -249,11 +323,15 @@ static void read_reply_data( void *buffer, size_t size )
  *
  * Wait for a reply from the server.
  */
-static inline unsigned int wait_reply( struct __server_request_info *req )
+static inline unsigned int wait_reply( struct __server_request_info *req, BOOL reply_in_window )
 {
     read_reply_data( &req->u.reply, sizeof(req->u.reply) );
-    if (req->u.reply.reply_header.reply_size)
-        read_reply_data( req->reply_data, req->u.reply.reply_header.reply_size );
+    if (!req->u.reply.reply_header.reply_size)
+        return req->u.reply.reply_header.error;
+
+    if (reply_in_window)
+        memcpy( req->reply_data, ntdll_get_thread_data()->data_window, req->u.reply.reply_header.reply_size );
+    else read_reply_data( req->reply_data, req->u.reply.reply_header.reply_size );
     return req->u.reply.reply_header.error;
 }
 
@@ -264,10 +342,17 @@ static inline unsigned int wait_reply( struct __server_request_info *req )
 unsigned int server_call_unlocked( void *req_ptr )
 {
     struct __server_request_info * const req = req_ptr;
+    data_size_t size = req->u.req.request_header.reply_size;
+    BOOL reply_in_window;
     unsigned int ret;
 
+    if (size >= DATA_WINDOW_THRESHOLD && size <= DATA_WINDOW_MAX_SIZE &&
+        size > ntdll_get_thread_data()->data_window_size)
+        set_data_window( size );
+
+    reply_in_window = use_data_window( req->u.req.request_header.reply_size );
     if ((ret = send_request( req ))) return ret;
-    return wait_reply( req );
+    return wait_reply( req, reply_in_window );
 }
 
 
@@ -979,6 +1064,18 @@ static int remove_fd_from_cache( HANDLE handle )
 }
 
 
+/***********************************************************************
+ *           server_get_cached_unix_fd
+ *
+ * Look up the unix fd of a handle without calling the server. The returned
+ * fd belongs to the cache and must not be closed.
+ */
+NTSTATUS server_get_cached_unix_fd( HANDLE handle, int *unix_fd, enum server_fd_type *type )
+{
+    return get_cached_fd( handle, unix_fd, type, NULL, NULL );
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -1735,7 +1832,12 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     if (options & DUPLICATE_CLOSE_SOURCE)
+    {
         fd = remove_fd_from_cache( source );
+        close_registry_cache_handle( source );
+        close_completion_handle( source );
+        close_socket_handle( source );
+    }
 
     SERVER_START_REQ( dup_handle )
     {
@@ -1796,6 +1898,9 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     fd = remove_fd_from_cache( handle );
+    close_registry_cache_handle( handle );
+    close_completion_handle( handle );
+    close_socket_handle( handle );
 
     if (do_msync())
         msync_close( handle );
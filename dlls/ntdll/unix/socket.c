@@ -27,6 +27,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <unistd.h>
 #ifdef HAVE_IFADDRS_H
 # include <ifaddrs.h>
@@ -686,7 +687,7 @@ static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
     NTSTATUS status;
     unsigned int i;
     ULONG options;
-    BOOL nonblocking, alerted;
+    BOOL nonblocking, alerted, direct;
 
     if (unix_flags & MSG_OOB)
     {
@@ -737,19 +738,39 @@ static NTSTATUS sock_recv( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, voi
         }
     }
 
+    /* if the data can be received right away, the server may let us do it
+     * without creating an async, so the result doesn't need to be reported */
+    direct = !event && !apc && !force_async;
+
+retry:
     SERVER_START_REQ( recv_socket )
     {
         req->force_async = force_async;
         req->async  = server_async( handle, &async->io, event, apc, apc_user, io );
         req->oob    = !!(unix_flags & MSG_OOB);
+        req->direct = direct;
         status = wine_server_call( req );
         wait_handle = wine_server_ptr_handle( reply->wait );
         options     = reply->options;
         nonblocking = reply->nonblocking;
+        direct      = reply->direct;
     }
     SERVER_END_REQ;
 
     alerted = status == STATUS_ALERTED;
+    if (alerted && direct)
+    {
+        status = try_recv( fd, async, &information );
+        if (status == STATUS_DEVICE_NOT_READY && !nonblocking)
+        {
+            /* the data is gone, queue an async to wait for more */
+            direct = FALSE;
+            goto retry;
+        }
+        if (!NT_ERROR(status)) set_async_iosb( io, status, information );
+        release_fileio( &async->io );
+        return status;
+    }
     if (alerted)
     {
         status = try_recv( fd, async, &information );
@@ -1158,6 +1179,218 @@ static void complete_async( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, vo
 }
 
 
+/* maximum number of sockets for which a poll is handled without the server */
+#define MAX_UNIX_POLL_SOCKETS 64
+
+/* unix socket types of recently polled handles; each entry holds the handle
+ * in the high half and the type in the low half */
+#define SOCK_TYPE_CACHE_SIZE 64
+
+static LONG64 sock_type_cache[SOCK_TYPE_CACHE_SIZE];
+static unsigned int sock_close_count;  /* incremented each time a handle is closed */
+
+static LONG64 *get_sock_type_cache_slot( HANDLE handle )
+{
+    return &sock_type_cache[((ULONG_PTR)handle >> 2) % SOCK_TYPE_CACHE_SIZE];
+}
+
+static BOOL get_cached_sock_type( HANDLE handle, int fd, unsigned int close_count, int *type )
+{
+    LONG64 *slot = get_sock_type_cache_slot( handle ), entry;
+    socklen_t len = sizeof(*type);
+
+    entry = __atomic_load_n( slot, __ATOMIC_SEQ_CST );
+    if ((ULONG)(entry >> 32) == wine_server_obj_handle( handle ) && (int)entry)
+    {
+        *type = (int)entry;
+        return TRUE;
+    }
+
+    if (getsockopt( fd, SOL_SOCKET, SO_TYPE, (char *)type, &len )) return FALSE;
+    entry = ((LONG64)wine_server_obj_handle( handle ) << 32) | (ULONG)*type;
+    __atomic_store_n( slot, entry, __ATOMIC_SEQ_CST );
+    /* the handle may have been closed and reused in the meantime */
+    if (close_count != __atomic_load_n( &sock_close_count, __ATOMIC_SEQ_CST ))
+        __atomic_compare_exchange_n( slot, &entry, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+    return TRUE;
+}
+
+/***********************************************************************
+ *           close_socket_handle
+ *
+ * Forget the cached socket type of a handle that is being closed.
+ */
+void close_socket_handle( HANDLE handle )
+{
+    LONG64 *slot = get_sock_type_cache_slot( handle ), entry;
+
+    __atomic_add_fetch( &sock_close_count, 1, __ATOMIC_SEQ_CST );
+    entry = __atomic_load_n( slot, __ATOMIC_SEQ_CST );
+    if ((ULONG)(entry >> 32) == wine_server_obj_handle( handle ))
+        __atomic_compare_exchange_n( slot, &entry, 0, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+}
+
+/* Zero-timeout polls, as issued by most select() and WSAPoll() callers, can be
+ * answered with a single poll() as long as every socket is already in the fd
+ * cache and none of them is in a state that only the server knows about. In
+ * every other case this returns STATUS_BAD_DEVICE_TYPE to defer to the server.
+ *
+ * The server answers such polls by polling the unix fd too, so pending asyncs
+ * don't change the result; what differs is the socket state. Stream sockets
+ * are only handled once connected, since the server reports nothing at all for
+ * unconnected sockets and accepts rather than reads for listening ones, and
+ * the connection flags as well as stored connection errors are left to the
+ * server. */
+static NTSTATUS try_unix_poll( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc_user,
+                               client_ptr_t io, const void *in_buffer, ULONG in_size,
+                               void *out_buffer, ULONG out_size )
+{
+    struct pollfd pollfds[MAX_UNIX_POLL_SOCKETS];
+    ULONGLONG sockets[MAX_UNIX_POLL_SOCKETS];
+    int masks[MAX_UNIX_POLL_SOCKETS], flags[MAX_UNIX_POLL_SOCKETS];
+    BOOL stream[MAX_UNIX_POLL_SOCKETS], oobinline[MAX_UNIX_POLL_SOCKETS];
+    unsigned int i, count, signaled_count = 0;
+    unsigned int close_count = __atomic_load_n( &sock_close_count, __ATOMIC_SEQ_CST );
+    enum server_fd_type type;
+    ULONG_PTR output_size;
+    socklen_t len;
+    int value;
+
+    if (in_wow64_call())
+    {
+        const struct afd_poll_params_32 *params = in_buffer;
+
+        if (in_size < sizeof(*params) || params->timeout || params->exclusive) return STATUS_BAD_DEVICE_TYPE;
+        count = params->count;
+        if (!count || count > MAX_UNIX_POLL_SOCKETS ||
+            in_size < offsetof( struct afd_poll_params_32, sockets[count] ))
+            return STATUS_BAD_DEVICE_TYPE;
+        for (i = 0; i < count; ++i)
+        {
+            sockets[i] = params->sockets[i].socket;
+            masks[i] = params->sockets[i].flags;
+        }
+    }
+    else
+    {
+        const struct afd_poll_params *params = in_buffer;
+
+        if (in_size < sizeof(*params) || params->timeout || params->exclusive) return STATUS_BAD_DEVICE_TYPE;
+        count = params->count;
+        if (!count || count > MAX_UNIX_POLL_SOCKETS ||
+            in_size < offsetof( struct afd_poll_params, sockets[count] ))
+            return STATUS_BAD_DEVICE_TYPE;
+        for (i = 0; i < count; ++i)
+        {
+            sockets[i] = params->sockets[i].socket;
+            masks[i] = params->sockets[i].flags;
+        }
+    }
+    if (out_size < in_size) return STATUS_BAD_DEVICE_TYPE;
+
+    for (i = 0; i < count; ++i)
+    {
+        /* connections and their errors are tracked by the server */
+        if (masks[i] & (AFD_POLL_CONNECT | AFD_POLL_CONNECT_ERR | AFD_POLL_ACCEPT)) return STATUS_BAD_DEVICE_TYPE;
+
+        if (server_get_cached_unix_fd( ULongToHandle( sockets[i] ), &pollfds[i].fd, &type ) ||
+            type != FD_TYPE_SOCKET)
+            return STATUS_BAD_DEVICE_TYPE;
+
+        if (!get_cached_sock_type( ULongToHandle( sockets[i] ), pollfds[i].fd, close_count, &value ))
+            return STATUS_BAD_DEVICE_TYPE;
+        stream[i] = (value == SOCK_STREAM);
+        if (stream[i])
+        {
+            union unix_sockaddr addr;
+
+            /* unconnected and listening sockets have no peer */
+            len = sizeof(addr);
+            if (getpeername( pollfds[i].fd, &addr.addr, &len )) return STATUS_BAD_DEVICE_TYPE;
+        }
+        else if (value != SOCK_DGRAM) return STATUS_BAD_DEVICE_TYPE;
+
+        oobinline[i] = FALSE;
+        len = sizeof(value);
+        if ((masks[i] & AFD_POLL_OOB) &&
+            !getsockopt( pollfds[i].fd, SOL_SOCKET, SO_OOBINLINE, (char *)&value, &len ) && value)
+            oobinline[i] = TRUE;
+
+        pollfds[i].events = 0;
+        if (masks[i] & (AFD_POLL_READ | AFD_POLL_ACCEPT)) pollfds[i].events |= POLLIN;
+        if ((masks[i] & AFD_POLL_HUP) && stream[i]) pollfds[i].events |= POLLIN;
+        if (masks[i] & AFD_POLL_OOB) pollfds[i].events |= oobinline[i] ? POLLIN : POLLPRI;
+        if (masks[i] & AFD_POLL_WRITE) pollfds[i].events |= POLLOUT;
+        pollfds[i].revents = 0;
+    }
+
+    if (poll( pollfds, count, 0 ) < 0) return STATUS_BAD_DEVICE_TYPE;
+
+    for (i = 0; i < count; ++i)
+    {
+        int revents = pollfds[i].revents;
+
+        /* Hangups and errors may stand for a socket which was never connected or whose
+         * connection failed, which only the server can tell apart. */
+        if (revents & (POLLERR | POLLHUP | POLLNVAL)) return STATUS_BAD_DEVICE_TYPE;
+
+        flags[i] = 0;
+        if (revents & POLLIN)
+        {
+            if ((masks[i] & AFD_POLL_HUP) && stream[i])
+            {
+                char dummy;
+
+                if (!recv( pollfds[i].fd, &dummy, 1, MSG_PEEK ))
+                {
+                    revents &= ~POLLIN;
+                    flags[i] |= AFD_POLL_HUP;
+                }
+            }
+            if (revents & POLLIN) flags[i] |= AFD_POLL_READ;
+        }
+        if (revents & POLLPRI) flags[i] |= oobinline[i] ? AFD_POLL_READ : AFD_POLL_OOB;
+        if (revents & POLLOUT) flags[i] |= AFD_POLL_WRITE;
+
+        if ((flags[i] &= masks[i])) ++signaled_count;
+    }
+
+    if (in_wow64_call())
+    {
+        struct afd_poll_params_32 *output = out_buffer;
+
+        output_size = offsetof( struct afd_poll_params_32, sockets[signaled_count] );
+        memset( output, 0, output_size );
+        for (i = 0; i < count; ++i)
+        {
+            if (!flags[i]) continue;
+            output->sockets[output->count].socket = sockets[i];
+            output->sockets[output->count].flags = flags[i];
+            output->sockets[output->count].status = STATUS_SUCCESS;
+            ++output->count;
+        }
+    }
+    else
+    {
+        struct afd_poll_params *output = out_buffer;
+
+        output_size = offsetof( struct afd_poll_params, sockets[signaled_count] );
+        memset( output, 0, output_size );
+        for (i = 0; i < count; ++i)
+        {
+            if (!flags[i]) continue;
+            output->sockets[output->count].socket = sockets[i];
+            output->sockets[output->count].flags = flags[i];
+            output->sockets[output->count].status = STATUS_SUCCESS;
+            ++output->count;
+        }
+    }
+
+    complete_async( handle, event, apc, apc_user, io, STATUS_SUCCESS, output_size );
+    return STATUS_SUCCESS;
+}
+
+
 static NTSTATUS do_getsockopt( HANDLE handle, client_ptr_t io, int level,
                                int option, void *out_buffer, ULONG out_size )
 {
@@ -1263,7 +1496,9 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
             break;
 
         case IOCTL_AFD_POLL:
-            status = STATUS_BAD_DEVICE_TYPE;
+            if ((status = try_unix_poll( handle, event, apc, apc_user, io,
+                                         in_buffer, in_size, out_buffer, out_size )) != STATUS_BAD_DEVICE_TYPE)
+                return status;
             break;
 
         case IOCTL_AFD_RECV:
@@ -49,6 +49,7 @@
 #include <stdlib.h>
 #include <time.h>
 #ifdef __APPLE__
+# include <dlfcn.h>
 # include <mach/mach.h>
 # include <mach/task.h>
 # include <mach/semaphore.h>
@@ -111,7 +112,7 @@ static inline ULONGLONG monotonic_counter(void)
 
 static int futex_private = 128;
 
-static inline int futex_wait( const int *addr, int val, struct timespec *timeout )
+static inline int futex_wait_op( const int *addr, int op, int val, struct timespec *timeout )
 {
 #if (defined(__i386__) || defined(__arm__)) && _TIME_BITS==64
     if (timeout && sizeof(*timeout) != 8)
@@ -120,10 +121,15 @@ static inline int futex_wait( const int *addr, int val, struct timespec *timeout
             long tv_sec;
             long tv_nsec;
         } timeout32 = { timeout->tv_sec, timeout->tv_nsec };
-        return syscall( __NR_futex, addr, FUTEX_WAIT | futex_private, val, &timeout32, 0, 0 );
+        return syscall( __NR_futex, addr, op, val, &timeout32, 0, 0 );
     }
 #endif
-    return syscall( __NR_futex, addr, FUTEX_WAIT | futex_private, val, timeout, 0, 0 );
+    return syscall( __NR_futex, addr, op, val, timeout, 0, 0 );
+}
+
+static inline int futex_wait( const int *addr, int val, struct timespec *timeout )
+{
+    return futex_wait_op( addr, FUTEX_WAIT | futex_private, val, timeout );
 }
 
 static inline int futex_wake( const int *addr, int val )
@@ -131,6 +137,17 @@ static inline int futex_wake( const int *addr, int val )
     return syscall( __NR_futex, addr, FUTEX_WAKE | futex_private, val, NULL, 0, 0 );
 }
 
+/* futexes in memory shared with other processes */
+static inline int futex_wait_shared( const int *addr, int val, struct timespec *timeout )
+{
+    return futex_wait_op( addr, FUTEX_WAIT, val, timeout );
+}
+
+static inline int futex_wake_shared( const int *addr, int val )
+{
+    return syscall( __NR_futex, addr, FUTEX_WAKE, val, NULL, 0, 0 );
+}
+
 static inline int use_futexes(void)
 {
     static int supported = -1;
@@ -150,6 +167,28 @@ static inline int use_futexes(void)
 
 #endif
 
+#if defined(__linux__) || defined(__APPLE__)
+static LONGLONG get_absolute_timeout( const LARGE_INTEGER *timeout )
+{
+    LARGE_INTEGER now;
+
+    if (timeout->QuadPart >= 0) return timeout->QuadPart;
+    NtQuerySystemTime( &now );
+    return now.QuadPart - timeout->QuadPart;
+}
+
+static LONGLONG update_timeout( ULONGLONG end )
+{
+    LARGE_INTEGER now;
+    LONGLONG timeleft;
+
+    NtQuerySystemTime( &now );
+    timeleft = end - now.QuadPart;
+    if (timeleft < 0) timeleft = 0;
+    return timeleft;
+}
+#endif
+
 
 /* create a struct security_descriptor and contained information in one contiguous piece of memory */
 NTSTATUS alloc_object_attributes( const OBJECT_ATTRIBUTES *attr, struct object_attributes **ret,
@@ -1872,6 +1911,338 @@ NTSTATUS WINAPI NtReleaseKeyedEvent( HANDLE handle, const void *key,
 }
 
 
+#if defined(__linux__) || defined(__APPLE__)
+
+/* completion port queues shared with the server, see server/completion.c */
+
+#ifdef __APPLE__
+
+#define UL_COMPARE_AND_WAIT_SHARED  0x3
+#define ULF_NO_ERRNO                0x01000000
+extern int __ulock_wake( uint32_t operation, void *addr, uint64_t wake_value );
+
+typedef int (*__ulock_wait2_ptr_t)( uint32_t operation, void *addr, uint64_t value,
+                                    uint64_t timeout_ns, uint64_t value2 );
+static __ulock_wait2_ptr_t completion_ulock_wait2;
+
+static BOOL use_completion_shm(void)
+{
+    static int supported = -1;
+
+    if (supported == -1)
+    {
+        completion_ulock_wait2 = (__ulock_wait2_ptr_t)dlsym( RTLD_DEFAULT, "__ulock_wait2" );
+        supported = completion_ulock_wait2 != NULL;
+    }
+    return supported;
+}
+
+static void wake_completion_shm( completion_shm_t *shm )
+{
+    __ulock_wake( UL_COMPARE_AND_WAIT_SHARED | ULF_NO_ERRNO, (void *)&shm->futex, 0 );
+}
+
+/* wait for the futex to change from val; returns FALSE on timeout */
+static BOOL wait_completion_shm( completion_shm_t *shm, int val, const LONGLONG *timeleft )
+{
+    int ret;
+
+    /* a zero timeout means infinite for __ulock_wait2 */
+    ret = completion_ulock_wait2( UL_COMPARE_AND_WAIT_SHARED | ULF_NO_ERRNO, (void *)&shm->futex, val,
+                                  timeleft ? *timeleft * 100 : 0, 0 );
+    return ret != -ETIMEDOUT;
+}
+
+#else
+
+static BOOL use_completion_shm(void)
+{
+    return use_futexes();
+}
+
+static void wake_completion_shm( completion_shm_t *shm )
+{
+    futex_wake_shared( (int *)&shm->futex, 1 );
+}
+
+/* wait for the futex to change from val; returns FALSE on timeout */
+static BOOL wait_completion_shm( completion_shm_t *shm, int val, const LONGLONG *timeleft )
+{
+    struct timespec timespec;
+
+    if (!timeleft) return futex_wait_shared( (int *)&shm->futex, val, NULL ) != -1 || errno != ETIMEDOUT;
+    timespec.tv_sec = *timeleft / (ULONGLONG)TICKSPERSEC;
+    timespec.tv_nsec = (*timeleft % TICKSPERSEC) * 100;
+    return futex_wait_shared( (int *)&shm->futex, val, &timespec ) != -1 || errno != ETIMEDOUT;
+}
+
+#endif
+
+struct completion_cache_entry
+{
+    HANDLE            handle;
+    completion_shm_t *shm;
+    LONG              refcount;
+};
+
+#define COMPLETION_CACHE_SIZE 64
+
+static struct completion_cache_entry *completion_cache[COMPLETION_CACHE_SIZE];
+static pthread_mutex_t completion_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static BOOL completion_cache_used;
+static unsigned int completion_close_count;  /* incremented each time a handle is closed */
+
+static struct completion_cache_entry **get_completion_cache_slot( HANDLE handle )
+{
+    return &completion_cache[((ULONG_PTR)handle >> 2) % COMPLETION_CACHE_SIZE];
+}
+
+/* called with the cache mutex held */
+static void release_completion_entry_locked( struct completion_cache_entry *entry )
+{
+    if (--entry->refcount) return;
+    munmap( entry->shm, sizeof(*entry->shm) );
+    free( entry );
+}
+
+static void release_completion_entry( struct completion_cache_entry *entry )
+{
+    sigset_t sigset;
+
+    server_enter_uninterrupted_section( &completion_cache_mutex, &sigset );
+    release_completion_entry_locked( entry );
+    server_leave_uninterrupted_section( &completion_cache_mutex, &sigset );
+}
+
+/* get the shared queue of a completion port, mapping it on first use */
+static struct completion_cache_entry *get_completion_entry( HANDLE handle )
+{
+    struct completion_cache_entry *entry, **slot = get_completion_cache_slot( handle );
+    unsigned int close_count;
+    obj_handle_t fd_handle;
+    data_size_t size = 0;
+    sigset_t sigset, sigset2;
+    void *ptr;
+    int fd = -1;
+
+    if (!use_completion_shm()) return NULL;
+
+    server_enter_uninterrupted_section( &completion_cache_mutex, &sigset );
+    if ((entry = *slot) && entry->handle == handle) entry->refcount++;
+    else entry = NULL;
+    close_count = __atomic_load_n( &completion_close_count, __ATOMIC_SEQ_CST );
+    server_leave_uninterrupted_section( &completion_cache_mutex, &sigset );
+    if (entry) return entry;
+
+    /* we need to hold the fd cache mutex so that our receive_fd doesn't race with the others */
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    SERVER_START_REQ( get_completion_shm )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        if (!wine_server_call( req ))
+        {
+            fd = receive_fd( &fd_handle );
+            size = reply->size;
+        }
+    }
+    SERVER_END_REQ;
+
+    if (fd != -1)
+    {
+        ptr = size == sizeof(*entry->shm) ? mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 ) : MAP_FAILED;
+        close( fd );
+        if (ptr != MAP_FAILED && !(entry = malloc( sizeof(*entry) ))) munmap( ptr, size );
+        if (entry)
+        {
+            entry->handle   = handle;
+            entry->shm      = ptr;
+            entry->refcount = 2;  /* one for the cache and one for the caller */
+            server_enter_uninterrupted_section( &completion_cache_mutex, &sigset2 );
+            if (*slot) release_completion_entry_locked( *slot );
+            *slot = entry;
+            __atomic_store_n( &completion_cache_used, TRUE, __ATOMIC_SEQ_CST );
+            /* the handle may have been closed and reused while the request was in progress;
+             * the entry is in the cache now, so any later close will find it */
+            if (close_count != __atomic_load_n( &completion_close_count, __ATOMIC_SEQ_CST ))
+            {
+                *slot = NULL;
+                entry->refcount = 1;
+                release_completion_entry_locked( entry );
+                entry = NULL;
+            }
+            server_leave_uninterrupted_section( &completion_cache_mutex, &sigset2 );
+        }
+    }
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    return entry;
+}
+
+/***********************************************************************
+ *           close_completion_handle
+ *
+ * Remove the cached completion port queue of a handle that is being closed.
+ */
+void close_completion_handle( HANDLE handle )
+{
+    struct completion_cache_entry **slot = get_completion_cache_slot( handle );
+    sigset_t sigset;
+
+    /* counted even before the cache is used, an entry may be about to be added */
+    __atomic_add_fetch( &completion_close_count, 1, __ATOMIC_SEQ_CST );
+    if (!__atomic_load_n( &completion_cache_used, __ATOMIC_SEQ_CST )) return;
+
+    server_enter_uninterrupted_section( &completion_cache_mutex, &sigset );
+    if (*slot && (*slot)->handle == handle)
+    {
+        release_completion_entry_locked( *slot );
+        *slot = NULL;
+    }
+    server_leave_uninterrupted_section( &completion_cache_mutex, &sigset );
+}
+
+/* maximum number of attempts on a contended queue; more means that the queue is corrupted
+ * and the packets go through the server instead */
+#define SHM_MAX_ATTEMPTS COMPLETION_SHM_PACKETS
+
+/* lock-free bounded queue; the server uses the same algorithm */
+static BOOL shm_add_packet( completion_shm_t *shm, ULONG_PTR key, ULONG_PTR value,
+                            NTSTATUS status, SIZE_T count )
+{
+    unsigned int attempts, pos = __atomic_load_n( &shm->tail, __ATOMIC_RELAXED );
+    completion_packet_t *packet;
+
+    for (attempts = 0;; attempts++)
+    {
+        int diff;
+
+        if (attempts == SHM_MAX_ATTEMPTS) return FALSE;
+        packet = &shm->packets[pos % COMPLETION_SHM_PACKETS];
+        diff = __atomic_load_n( &packet->seq, __ATOMIC_ACQUIRE ) - pos;
+        if (diff < 0) return FALSE;  /* full */
+        if (!diff && __atomic_compare_exchange_n( &shm->tail, &pos, pos + 1, 0,
+                                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED )) break;
+        if (diff) pos = __atomic_load_n( &shm->tail, __ATOMIC_RELAXED );
+    }
+    packet->ckey        = key;
+    packet->cvalue      = value;
+    packet->status      = status;
+    packet->information = count;
+    __atomic_store_n( &packet->seq, pos + 1, __ATOMIC_RELEASE );
+
+    __atomic_add_fetch( &shm->futex, 1, __ATOMIC_SEQ_CST );
+    if (__atomic_load_n( &shm->waiters, __ATOMIC_SEQ_CST )) wake_completion_shm( shm );
+    return TRUE;
+}
+
+static BOOL shm_remove_packet( completion_shm_t *shm, FILE_IO_COMPLETION_INFORMATION *info )
+{
+    unsigned int attempts, pos = __atomic_load_n( &shm->head, __ATOMIC_RELAXED );
+    completion_packet_t *packet;
+
+    for (attempts = 0;; attempts++)
+    {
+        int diff;
+
+        if (attempts == SHM_MAX_ATTEMPTS) return FALSE;
+        packet = &shm->packets[pos % COMPLETION_SHM_PACKETS];
+        diff = __atomic_load_n( &packet->seq, __ATOMIC_ACQUIRE ) - (pos + 1);
+        if (diff < 0) return FALSE;  /* empty */
+        if (!diff && __atomic_compare_exchange_n( &shm->head, &pos, pos + 1, 0,
+                                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED )) break;
+        if (diff) pos = __atomic_load_n( &shm->head, __ATOMIC_RELAXED );
+    }
+    info->CompletionKey             = packet->ckey;
+    info->CompletionValue           = packet->cvalue;
+    info->IoStatusBlock.Information = packet->information;
+    info->IoStatusBlock.u.Status    = packet->status;
+    __atomic_store_n( &packet->seq, pos + COMPLETION_SHM_PACKETS, __ATOMIC_RELEASE );
+    return TRUE;
+}
+
+/* add a packet to the shared queue, unless the server needs to see it */
+static BOOL set_shm_completion( HANDLE handle, ULONG_PTR key, ULONG_PTR value, NTSTATUS status, SIZE_T count )
+{
+    struct completion_cache_entry *entry;
+    completion_shm_t *shm;
+    BOOL ret = FALSE;
+
+    if (!(entry = get_completion_entry( handle ))) return FALSE;
+    shm = entry->shm;
+
+    /* packets overflowing into the server queue must stay in order, and threads
+     * waiting in the server are woken up by the add_completion request */
+    if (!__atomic_load_n( &shm->server_depth, __ATOMIC_ACQUIRE ) &&
+        !__atomic_load_n( &shm->server_waiters, __ATOMIC_SEQ_CST ) &&
+        (ret = shm_add_packet( shm, key, value, status, count )) &&
+        __atomic_load_n( &shm->server_waiters, __ATOMIC_SEQ_CST ))
+    {
+        /* a server wait started concurrently */
+        SERVER_START_REQ( wake_completion )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            wine_server_call( req );
+        }
+        SERVER_END_REQ;
+    }
+    release_completion_entry( entry );
+    return ret;
+}
+
+/* remove a packet from the shared queue, waiting for one if needed;
+ * returns STATUS_PENDING if the packet needs to be fetched from the server */
+static NTSTATUS remove_shm_completion( completion_shm_t *shm, FILE_IO_COMPLETION_INFORMATION *info,
+                                       const LARGE_INTEGER *timeout )
+{
+    ULONGLONG end;
+    BOOL ret;
+    int val;
+
+    if (timeout)
+    {
+        if (timeout->QuadPart == TIMEOUT_INFINITE) timeout = NULL;
+        else end = get_absolute_timeout( timeout );
+    }
+
+    for (;;)
+    {
+        if (shm_remove_packet( shm, info )) return STATUS_SUCCESS;
+        if (__atomic_load_n( &shm->server_depth, __ATOMIC_ACQUIRE )) return STATUS_PENDING;
+
+        val = __atomic_load_n( &shm->futex, __ATOMIC_SEQ_CST );
+        __atomic_add_fetch( &shm->waiters, 1, __ATOMIC_SEQ_CST );
+        if (shm_remove_packet( shm, info ))
+        {
+            __atomic_sub_fetch( &shm->waiters, 1, __ATOMIC_SEQ_CST );
+            return STATUS_SUCCESS;
+        }
+        if (timeout)
+        {
+            LONGLONG timeleft = update_timeout( end );
+
+            if (!timeleft)
+            {
+                __atomic_sub_fetch( &shm->waiters, 1, __ATOMIC_SEQ_CST );
+                return STATUS_TIMEOUT;
+            }
+            ret = wait_completion_shm( shm, val, &timeleft );
+        }
+        else
+            ret = wait_completion_shm( shm, val, NULL );
+        __atomic_sub_fetch( &shm->waiters, 1, __ATOMIC_SEQ_CST );
+
+        if (!ret) return STATUS_TIMEOUT;
+    }
+}
+
+#else
+
+void close_completion_handle( HANDLE handle )
+{
+}
+
+#endif
+
+
 /***********************************************************************
  *             NtCreateIoCompletion (NTDLL.@)
  */
@@ -1936,6 +2307,10 @@ NTSTATUS WINAPI NtSetIoCompletion( HANDLE handle, ULONG_PTR key, ULONG_PTR value
 
     TRACE( "(%p, %lx, %lx, %x, %lx)\n", handle, key, value, status, count );
 
+#if defined(__linux__) || defined(__APPLE__)
+    if (set_shm_completion( handle, key, value, status, count )) return STATUS_SUCCESS;
+#endif
+
     SERVER_START_REQ( add_completion )
     {
         req->handle      = wine_server_obj_handle( handle );
@@ -1956,10 +2331,30 @@ NTSTATUS WINAPI NtSetIoCompletion( HANDLE handle, ULONG_PTR key, ULONG_PTR value
 NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *value,
                                       IO_STATUS_BLOCK *io, LARGE_INTEGER *timeout )
 {
+#if defined(__linux__) || defined(__APPLE__)
+    struct completion_cache_entry *entry;
+#endif
     NTSTATUS status;
 
     TRACE( "(%p, %p, %p, %p, %p)\n", handle, key, value, io, timeout );
 
+#if defined(__linux__) || defined(__APPLE__)
+    if ((entry = get_completion_entry( handle )))
+    {
+        FILE_IO_COMPLETION_INFORMATION info;
+
+        status = remove_shm_completion( entry->shm, &info, timeout );
+        release_completion_entry( entry );
+        if (!status)
+        {
+            *key  = info.CompletionKey;
+            *value = info.CompletionValue;
+            *io   = info.IoStatusBlock;
+        }
+        if (status != STATUS_PENDING) return status;
+    }
+#endif
+
     for (;;)
     {
         SERVER_START_REQ( remove_completion )
@@ -1987,11 +2382,29 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *
 NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
                                         ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
 {
+#if defined(__linux__) || defined(__APPLE__)
+    struct completion_cache_entry *entry;
+#endif
     NTSTATUS status;
     ULONG i = 0;
 
     TRACE( "%p %p %u %p %p %u\n", handle, info, count, written, timeout, alertable );
 
+#if defined(__linux__) || defined(__APPLE__)
+    /* alertable waits need to go through the server to receive user APCs */
+    if (count && !alertable && (entry = get_completion_entry( handle )))
+    {
+        if (!(status = remove_shm_completion( entry->shm, &info[0], timeout )))
+            for (i = 1; i < count; i++) if (!shm_remove_packet( entry->shm, &info[i] )) break;
+        release_completion_entry( entry );
+        if (status != STATUS_PENDING)
+        {
+            *written = i ? i : 1;
+            return status;
+        }
+    }
+#endif
+
     for (;;)
     {
         while (i < count)
@@ -2529,29 +2942,6 @@ NTSTATUS WINAPI NtAlertThreadByThreadId( HANDLE tid )
 }
 
 
-#if defined(__linux__) || defined(__APPLE__)
-static LONGLONG get_absolute_timeout( const LARGE_INTEGER *timeout )
-{
-    LARGE_INTEGER now;
-
-    if (timeout->QuadPart >= 0) return timeout->QuadPart;
-    NtQuerySystemTime( &now );
-    return now.QuadPart - timeout->QuadPart;
-}
-
-static LONGLONG update_timeout( ULONGLONG end )
-{
-    LARGE_INTEGER now;
-    LONGLONG timeleft;
-
-    NtQuerySystemTime( &now );
-    timeleft = end - now.QuadPart;
-    if (timeleft < 0) timeleft = 0;
-    return timeleft;
-}
-#endif
-
-
 #ifdef __APPLE__
 
 /***********************************************************************
@@ -1050,6 +1050,8 @@ static void pthread_exit_wrapper( int status )
     close( ntdll_get_thread_data()->wait_fd[1] );
     close( ntdll_get_thread_data()->reply_fd );
     close( ntdll_get_thread_data()->request_fd );
+    if (ntdll_get_thread_data()->data_window)
+        munmap( ntdll_get_thread_data()->data_window, ntdll_get_thread_data()->data_window_size );
 
 #if defined(__APPLE__) && defined(__x86_64__)
     /* Remove the PEB from the localtime field in %gs, or MacOS might try
@@ -3008,6 +3008,8 @@ static TEB *init_teb( void *ptr, BOOL is_wow )
     thread_data->reply_fd   = -1;
     thread_data->wait_fd[0] = -1;
     thread_data->wait_fd[1] = -1;
+    thread_data->data_window = NULL;
+    thread_data->data_window_size = 0;
     list_add_head( &teb_list, &thread_data->entry );
     return teb;
 }
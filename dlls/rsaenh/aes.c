@@ -30,6 +30,50 @@
 
 #include "tomcrypt.h"
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <intrin.h>
+#include <immintrin.h>
+#define USE_AES_NI
+
+static int aes_ni_supported(void)
+{
+    static int supported = -1;
+    int regs[4];
+
+    if (supported == -1) {
+        __cpuid(regs, 1);
+        supported = (regs[2] >> 25) & 1;
+    }
+    return supported;
+}
+
+static __attribute__((target("aes"))) void aes_ni_encrypt(const unsigned char *pt, unsigned char *ct,
+                                                          const aes_key *skey)
+{
+    const __m128i *rk = (const __m128i *)skey->eKb;
+    __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)pt), _mm_loadu_si128(rk));
+    int r;
+
+    for (r = 1; r < skey->Nr; r++)
+        s = _mm_aesenc_si128(s, _mm_loadu_si128(rk + r));
+    _mm_storeu_si128((__m128i *)ct, _mm_aesenclast_si128(s, _mm_loadu_si128(rk + r)));
+}
+
+/* dK holds the round keys of the equivalent inverse cipher, which is what
+ * AESDEC expects. */
+static __attribute__((target("aes"))) void aes_ni_decrypt(const unsigned char *ct, unsigned char *pt,
+                                                          const aes_key *skey)
+{
+    const __m128i *rk = (const __m128i *)skey->dKb;
+    __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)ct), _mm_loadu_si128(rk));
+    int r;
+
+    for (r = 1; r < skey->Nr; r++)
+        s = _mm_aesdec_si128(s, _mm_loadu_si128(rk + r));
+    _mm_storeu_si128((__m128i *)pt, _mm_aesdeclast_si128(s, _mm_loadu_si128(rk + r)));
+}
+#endif
+
 static const ulong32 TE0[256] = {
     0xc66363a5UL, 0xf87c7c84UL, 0xee777799UL, 0xf67b7b8dUL,
     0xfff2f20dUL, 0xd66b6bbdUL, 0xde6f6fb1UL, 0x91c5c554UL,
@@ -1058,6 +1102,11 @@ int aes_setup(const unsigned char *key, int keylen, int rounds, aes_key *skey)
     *rk++ = *rrk++;
     *rk   = *rrk;
 
+    for (i = 0; i < 4 * (skey->Nr + 1); i++) {
+        STORE32H(skey->eK[i], skey->eKb + 4 * i);
+        STORE32H(skey->dK[i], skey->dKb + 4 * i);
+    }
+
     return CRYPT_OK;
 }
 
@@ -1066,6 +1115,13 @@ void aes_ecb_encrypt(const unsigned char *pt, unsigned char *ct, aes_key *skey)
     ulong32 s0, s1, s2, s3, t0, t1, t2, t3, *rk;
     int Nr, r;
 
+#ifdef USE_AES_NI
+    if (aes_ni_supported()) {
+        aes_ni_encrypt(pt, ct, skey);
+        return;
+    }
+#endif
+
     Nr = skey->Nr;
     rk = skey->eK;
 
@@ -1167,6 +1223,13 @@ void aes_ecb_decrypt(const unsigned char *ct, unsigned char *pt, aes_key *skey)
     ulong32 s0, s1, s2, s3, t0, t1, t2, t3, *rk;
     int Nr, r;
 
+#ifdef USE_AES_NI
+    if (aes_ni_supported()) {
+        aes_ni_decrypt(ct, pt, skey);
+        return;
+    }
+#endif
+
     Nr = skey->Nr;
     rk = skey->dK;
 
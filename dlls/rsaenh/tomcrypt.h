@@ -131,6 +131,7 @@ typedef struct tag_des3_key {
 
 typedef struct tag_aes_key {
    ulong32 eK[64], dK[64];
+   unsigned char eKb[16 * 15], dKb[16 * 15]; /* round keys in byte order, for AES-NI */
    int Nr;
 } aes_key;
 
@@ -19,6 +19,9 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
 
 #include "ntgdi_private.h"
 #include "dibdrv.h"
@@ -588,17 +591,218 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+/*
+ * Large blends, stretches and gradients are split into horizontal bands of the
+ * destination, which are processed in parallel by a small pool of threads.
+ * Every destination pixel is computed the same way whichever band it falls in,
+ * so the result doesn't depend on the split.
+ *
+ * The pool threads are not Wine threads and can't handle exceptions, so only
+ * memory owned by gdi is processed in bands, never DIB sections or other
+ * application buffers that the application could unmap or protect.
+ */
+
+#define BAND_MIN_PIXELS  (512 * 512)  /* minimum destination area for splitting */
+#define BAND_MIN_ROWS    32
+#define MAX_BAND_THREADS 8
+
+struct band_job
+{
+    void (*func)( void *ctx, int top, int bottom );
+    void *ctx;
+    int   top;
+    int   band_height;
+    int   count;  /* number of bands */
+    int   next;   /* next band to process */
+    int   users;  /* threads currently processing bands */
+};
+
+static pthread_mutex_t band_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t band_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t band_job_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t band_done_cond = PTHREAD_COND_INITIALIZER;
+static struct band_job *band_current;
+static int band_threads = -1;
+
+/* called with band_mutex held */
+static void process_bands( struct band_job *job )
+{
+    job->users++;
+    while (job->next < job->count)
+    {
+        int band = job->next++;
+        int top = job->top + band * job->band_height, bottom = top + job->band_height;
+
+        /* the outer bands are open-ended so that no row can be missed */
+        if (!band) top = INT_MIN;
+        if (band == job->count - 1) bottom = INT_MAX;
+
+        pthread_mutex_unlock( &band_mutex );
+        job->func( job->ctx, top, bottom );
+        pthread_mutex_lock( &band_mutex );
+    }
+    if (!--job->users) pthread_cond_signal( &band_done_cond );
+}
+
+static void *band_thread( void *arg )
+{
+    pthread_mutex_lock( &band_mutex );
+    for (;;)
+    {
+        while (!band_current || band_current->next >= band_current->count)
+            pthread_cond_wait( &band_job_cond, &band_mutex );
+        process_bands( band_current );
+    }
+    return NULL;
+}
+
+static int init_band_threads(void)
+{
+#ifndef __i386_on_x86_64__
+    long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    sigset_t sigset, old_sigset;
+    pthread_attr_t attr;
+    pthread_t thread;
+    int i, count = 0;
+
+    if (cpus <= 1) return 0;
+
+    /* the threads never run Windows code, keep signals going to Wine threads;
+     * faults still have to be delivered to the thread that caused them */
+    sigfillset( &sigset );
+    sigdelset( &sigset, SIGSEGV );
+    sigdelset( &sigset, SIGBUS );
+    sigdelset( &sigset, SIGILL );
+    sigdelset( &sigset, SIGFPE );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_sigset );
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    pthread_attr_setstacksize( &attr, 0x10000 );
+    for (i = 0; i < min( cpus - 1, MAX_BAND_THREADS ); i++)
+        if (!pthread_create( &thread, &attr, band_thread, NULL )) count++;
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+
+    TRACE( "started %d threads\n", count );
+    return count;
+#else
+    return 0;
+#endif
+}
+
+/* Process rows top to bottom with func, in parallel if the area is large
+ * enough. Returns FALSE if nothing was done; the caller then has to do the
+ * work itself. */
+static BOOL process_in_bands( int top, int bottom, int width, void (*func)( void *ctx, int top, int bottom ),
+                              void *ctx )
+{
+    struct band_job job;
+    int height = bottom - top;
+
+    if (height < 2 * BAND_MIN_ROWS || (LONGLONG)height * width < BAND_MIN_PIXELS) return FALSE;
+
+    /* only one operation at a time, others simply run on their own thread */
+    if (pthread_mutex_trylock( &band_pool_lock )) return FALSE;
+    if (band_threads == -1) band_threads = init_band_threads();
+    if (!band_threads)
+    {
+        pthread_mutex_unlock( &band_pool_lock );
+        return FALSE;
+    }
+
+    job.func  = func;
+    job.ctx   = ctx;
+    job.top   = top;
+    /* a few bands per thread so that they even out */
+    job.count = min( height / BAND_MIN_ROWS, (band_threads + 1) * 4 );
+    job.band_height = (height + job.count - 1) / job.count;
+    job.count = (height + job.band_height - 1) / job.band_height;
+    job.next  = 0;
+    job.users = 0;
+
+    pthread_mutex_lock( &band_mutex );
+    band_current = &job;
+    pthread_cond_broadcast( &band_job_cond );
+    process_bands( &job );
+    while (job.users) pthread_cond_wait( &band_done_cond, &band_mutex );
+    band_current = NULL;
+    pthread_mutex_unlock( &band_mutex );
+
+    pthread_mutex_unlock( &band_pool_lock );
+    return TRUE;
+}
+
+/* check whether the bits of a dib can be accessed from the band threads */
+static inline BOOL is_private_dib( const dib_info *dib )
+{
+    return dib->private_bits || dib->bits.is_copy;
+}
+
+/* check whether two dibs could share memory, in which case the order of the rows matters */
+static BOOL dibs_overlap( const dib_info *dib1, const dib_info *dib2 )
+{
+    const char *start1 = (const char *)dib1->bits.ptr, *start2 = (const char *)dib2->bits.ptr;
+    const char *end1, *end2;
+
+    if (dib1->stride < 0) start1 += (dib1->height - 1) * dib1->stride;
+    if (dib2->stride < 0) start2 += (dib2->height - 1) * dib2->stride;
+    end1 = start1 + dib1->height * abs( dib1->stride );
+    end2 = start2 + dib2->height * abs( dib2->stride );
+    return start1 < end2 && start2 < end1;
+}
+
+static void get_rects_bounds( const struct clipped_rects *clipped_rects, RECT *bounds )
+{
+    int i;
+
+    *bounds = clipped_rects->rects[0];
+    for (i = 1; i < clipped_rects->count; i++) union_rect( bounds, bounds, &clipped_rects->rects[i] );
+}
+
+struct blend_band
+{
+    dib_info                   *dst;
+    const dib_info             *src;
+    const struct clipped_rects *rects;
+    POINT                       offset;
+    BLENDFUNCTION               blend;
+};
+
+static void blend_band( void *ctx, int top, int bottom )
+{
+    const struct blend_band *band = ctx;
+    RECT rect, band_rect = { INT_MIN, top, INT_MAX, bottom };
+    int i;
+
+    for (i = 0; i < band->rects->count; i++)
+    {
+        if (!intersect_rect( &rect, &band->rects->rects[i], &band_rect )) continue;
+        band->dst->funcs->blend_rects( band->dst, 1, &rect, band->src, &band->offset, band->blend );
+    }
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
     POINT offset;
     struct clipped_rects clipped_rects;
+    struct blend_band band;
+    RECT bounds;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
 
     offset.x = src_rect->left - dst_rect->left;
     offset.y = src_rect->top  - dst_rect->top;
-    dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
+
+    band.dst = dst;
+    band.src = src;
+    band.rects = &clipped_rects;
+    band.offset = offset;
+    band.blend = blend;
+    get_rects_bounds( &clipped_rects, &bounds );
+    if (!is_private_dib( dst ) || !is_private_dib( src ) || dibs_overlap( dst, src ) ||
+        !process_in_bands( bounds.top, bounds.bottom, bounds.right - bounds.left, blend_band, &band ))
+        dst->funcs->blend_rects( dst, clipped_rects.count, clipped_rects.rects, src, &offset, blend );
 
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -683,16 +887,59 @@ static void get_gradient_triangle_vertices( const GRADIENT_TRIANGLE *tri, const
     bounds->bottom = v[2].y;
 }
 
+struct gradient_band
+{
+    dib_info                   *dib;
+    const struct clipped_rects *rects;
+    const TRIVERTEX            *v;
+    int                         mode;
+    BOOL                        failed;
+};
+
+static void gradient_band( void *ctx, int top, int bottom )
+{
+    struct gradient_band *band = ctx;
+    RECT rect, band_rect = { INT_MIN, top, INT_MAX, bottom };
+    int i;
+
+    for (i = 0; i < band->rects->count; i++)
+    {
+        if (!intersect_rect( &rect, &band->rects->rects[i], &band_rect )) continue;
+        /* failures don't depend on the rectangle, nothing is drawn in that case */
+        if (!band->dib->funcs->gradient_rect( band->dib, &rect, band->v, band->mode ))
+        {
+            band->failed = TRUE;
+            break;
+        }
+    }
+}
+
 static BOOL gradient_rect( dib_info *dib, TRIVERTEX *v, int mode, HRGN clip, const RECT *bounds )
 {
     int i;
     struct clipped_rects clipped_rects;
+    struct gradient_band band;
+    RECT rects_bounds;
     BOOL ret = TRUE;
 
     if (!get_clipped_rects( dib, bounds, clip, &clipped_rects )) return TRUE;
-    for (i = 0; i < clipped_rects.count; i++)
+
+    band.dib = dib;
+    band.rects = &clipped_rects;
+    band.v = v;
+    band.mode = mode;
+    band.failed = FALSE;
+    get_rects_bounds( &clipped_rects, &rects_bounds );
+    if (is_private_dib( dib ) &&
+        process_in_bands( rects_bounds.top, rects_bounds.bottom, rects_bounds.right - rects_bounds.left,
+                          gradient_band, &band ))
+        ret = !band.failed;
+    else
     {
-        if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        for (i = 0; i < clipped_rects.count; i++)
+        {
+            if (!(ret = dib->funcs->gradient_rect( dib, &clipped_rects.rects[i], v, mode ))) break;
+        }
     }
     free_clipped_rects( &clipped_rects );
     return ret;
@@ -1201,27 +1448,115 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
-DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                          const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
-                          INT mode )
+struct stretch_band
+{
+    dib_info             *dst_dib;
+    const dib_info       *src_dib;
+    POINT                 dst_start;
+    POINT                 src_start;
+    struct stretch_params v_params;
+    struct stretch_params h_params;
+    void                (*row_fn)( const dib_info *dst_dib, const POINT *dst_start,
+                                   const dib_info *src_dib, const POINT *src_start,
+                                   const struct stretch_params *params, int mode, BOOL keep_dst );
+    int                   mode;
+    BOOL                  vstretch;
+    int                   width;
+};
+
+/* stretch the source rows that end up in destination rows top to bottom */
+static void stretch_band( void *ctx, int top, int bottom )
+{
+    const struct stretch_band *band = ctx;
+    POINT dst_start = band->dst_start, src_start = band->src_start;
+    int length = band->v_params.length, err = band->v_params.err_start;
+    BOOL in_band;
+
+    if (band->vstretch)
+    {
+        BOOL need_row = TRUE;
+        RECT last_row, this_row;
+        last_row.left = 0;
+        last_row.right = band->width;
+
+        while (length--)
+        {
+            in_band = dst_start.y >= top && dst_start.y < bottom;
+            if (!in_band)
+            {
+                /* the first row of a band can't be copied from the previous one */
+                need_row = TRUE;
+            }
+            else if (need_row)
+            {
+                band->row_fn( band->dst_dib, &dst_start, band->src_dib, &src_start,
+                              &band->h_params, band->mode, FALSE );
+                need_row = FALSE;
+            }
+            else
+            {
+                last_row.top = dst_start.y - band->v_params.dst_inc;
+                last_row.bottom = last_row.top + 1;
+                this_row = last_row;
+                OffsetRect( &this_row, 0, band->v_params.dst_inc );
+                copy_rect( band->dst_dib, &this_row, band->dst_dib, &last_row, NULL, R2_COPYPEN );
+            }
+
+            if (err > 0)
+            {
+                src_start.y += band->v_params.src_inc;
+                need_row = TRUE;
+                err += band->v_params.err_add_1;
+            }
+            else err += band->v_params.err_add_2;
+            dst_start.y += band->v_params.dst_inc;
+        }
+    }
+    else
+    {
+        int merged_rows = 0;
+
+        while (length--)
+        {
+            in_band = dst_start.y >= top && dst_start.y < bottom;
+            if (in_band && (band->mode != STRETCH_DELETESCANS || !merged_rows))
+                band->row_fn( band->dst_dib, &dst_start, band->src_dib, &src_start,
+                              &band->h_params, band->mode, merged_rows != 0 );
+            merged_rows++;
+
+            if (err > 0)
+            {
+                dst_start.y += band->v_params.dst_inc;
+                merged_rows = 0;
+                err += band->v_params.err_add_1;
+            }
+            else err += band->v_params.err_add_2;
+            src_start.y += band->v_params.src_inc;
+        }
+    }
+}
+
+DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, const struct gdi_image_bits *src_bits,
+                          struct bitblt_coords *src, const BITMAPINFO *dst_info, void *dst_bits,
+                          struct bitblt_coords *dst, INT mode )
 {
     dib_info src_dib, dst_dib;
     POINT dst_start, src_start, dst_end, src_end;
     RECT rect;
     BOOL hstretch, vstretch;
     struct stretch_params v_params, h_params;
-    int err;
+    struct stretch_band band;
     DWORD ret;
-    void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
-                    const dib_info *src_dib, const POINT *src_start,
-                    const struct stretch_params *params, int mode, BOOL keep_dst);
 
     TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
           dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
           src->x, src->y, src->width, src->height, wine_dbgstr_rect(&src->visrect));
 
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
+    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits->ptr );
+    src_dib.bits.is_copy = src_bits->is_copy;
+    /* the destination is always a buffer allocated by stretch_bits() */
     init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
+    dst_dib.private_bits = TRUE;
 
     if (mode == HALFTONE)
     {
@@ -1254,64 +1589,20 @@ DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bit
     dst_start.x -= dst->visrect.left;
     dst_start.y -= dst->visrect.top;
 
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
-
-    if (vstretch)
-    {
-        BOOL need_row = TRUE;
-        RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
-        last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
-
-        while (v_params.length--)
-        {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
-            {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                OffsetRect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
-            }
-
-            if (err > 0)
-            {
-                src_start.y += v_params.src_inc;
-                need_row = TRUE;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
-        }
-    }
-    else
-    {
-        int merged_rows = 0;
-
-        while (v_params.length--)
-        {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
-            merged_rows++;
-
-            if (err > 0)
-            {
-                dst_start.y += v_params.dst_inc;
-                merged_rows = 0;
-                err += v_params.err_add_1;
-            }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
-        }
-    }
+    band.dst_dib   = &dst_dib;
+    band.src_dib   = &src_dib;
+    band.dst_start = dst_start;
+    band.src_start = src_start;
+    band.v_params  = v_params;
+    band.h_params  = h_params;
+    band.row_fn    = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
+    band.mode      = (vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    band.vstretch  = vstretch;
+    band.width     = dst->visrect.right - dst->visrect.left;
+
+    if (!is_private_dib( &dst_dib ) || !is_private_dib( &src_dib ) || dibs_overlap( &dst_dib, &src_dib ) ||
+        !process_in_bands( 0, dst->visrect.bottom - dst->visrect.top, band.width, stretch_band, &band ))
+        stretch_band( &band, INT_MIN, INT_MAX );
 
 done:
     /* update coordinates, the destination rectangle is always stored at 0,0 */
@@ -1322,14 +1613,16 @@ done:
     return ERROR_SUCCESS;
 }
 
-DWORD blend_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                        const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
-                        BLENDFUNCTION blend )
+DWORD blend_bitmapinfo( const BITMAPINFO *src_info, const struct gdi_image_bits *src_bits,
+                        struct bitblt_coords *src, const BITMAPINFO *dst_info,
+                        struct gdi_image_bits *dst_bits, struct bitblt_coords *dst, BLENDFUNCTION blend )
 {
     dib_info src_dib, dst_dib;
 
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
-    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
+    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits->ptr );
+    src_dib.bits.is_copy = src_bits->is_copy;
+    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits->ptr );
+    dst_dib.bits.is_copy = dst_bits->is_copy;
 
     return blend_rect( &dst_dib, &dst->visrect, &src_dib, &src->visrect, NULL, blend );
 }
@@ -1346,7 +1639,9 @@ DWORD gradient_bitmapinfo( const BITMAPINFO *info, void *bits, TRIVERTEX *vert_a
     RECT rc;
     DWORD ret = ERROR_SUCCESS;
 
+    /* the bits are always a buffer allocated by nulldrv_GradientFill() */
     init_dib_info_from_bitmapinfo( &dib, info, bits );
+    dib.private_bits = TRUE;
 
     switch (mode)
     {
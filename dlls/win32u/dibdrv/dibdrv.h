@@ -25,6 +25,7 @@ typedef struct
     RECT rect;  /* visible rectangle relative to bitmap origin */
     int stride; /* stride in bytes.  Will be -ve for bottom-up dibs (see bits). */
     struct gdi_image_bits bits; /* bits.ptr points to the top-left corner of the dib. */
+    BOOL private_bits;          /* the bits belong to gdi and the application can't see them */
 
     DWORD red_mask, green_mask, blue_mask;
     int red_shift, green_shift, blue_shift;
@@ -223,6 +224,18 @@ extern const primitive_funcs funcs_4    DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_1    DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_null DECLSPEC_HIDDEN;
 
+/* Vectorized row helpers, see simd.c. They return how many pixels were
+ * processed, leaving the rest of the row to the generic code. */
+struct dib_row_funcs
+{
+    int (*rop_32)( DWORD *dst, int len, DWORD and, DWORD xor );
+    int (*blend_argb)( DWORD *dst, const DWORD *src, int len );
+    int (*blend_constant_alpha)( DWORD *dst, const DWORD *src, int len, DWORD alpha );
+    int (*convert_24_to_8888)( DWORD *dst, const BYTE *src, int len );
+};
+
+extern struct dib_row_funcs dib_row_funcs DECLSPEC_HIDDEN;
+
 struct rop_codes
 {
     DWORD a1, a2, x1, x2;
@@ -43,6 +43,21 @@ enum glyph_type
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
 
+/* Glyph bitmaps are packed into slabs owned by the font instead of being
+ * allocated one by one; they are only released along with the whole font.
+ * Once the slabs reach the maximum size and no unused font is left to evict,
+ * new glyphs are rendered into temporary buffers instead of being cached. */
+#define GLYPH_SLAB_SIZE        0x10000
+#define GLYPH_CACHE_MAX_SIZE   (32 * 1024 * 1024)
+
+struct glyph_slab
+{
+    struct glyph_slab *next;
+    SIZE_T             size;
+    SIZE_T             used;
+    BYTE               data[1];
+};
+
 struct cached_font
 {
     struct list           entry;
@@ -51,10 +66,14 @@ struct cached_font
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    pthread_mutex_t       slab_lock;
+    struct glyph_slab    *slabs;
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
+/* most recently used fonts first */
 static struct list font_cache = LIST_INIT( font_cache );
+static LONG glyph_cache_size;
 
 static pthread_mutex_t font_cache_lock = PTHREAD_MUTEX_INITIALIZER;
 
@@ -547,10 +566,60 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static void free_font_glyphs( struct cached_font *font )
+{
+    struct glyph_slab *slab, *next;
+    UINT i, j;
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++) free( font->glyphs[i][j] );
+    for (slab = font->slabs; slab; slab = next)
+    {
+        next = slab->next;
+        InterlockedExchangeAdd( &glyph_cache_size, -(LONG)slab->size );
+        free( slab );
+    }
+    pthread_mutex_destroy( &font->slab_lock );
+}
+
+/* evict the least recently used fonts until the glyphs fit in the cache size, font_cache_lock must be held */
+static void trim_font_cache(void)
+{
+    struct cached_font *font, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE_REV( font, next, &font_cache, struct cached_font, entry )
+    {
+        if (glyph_cache_size <= GLYPH_CACHE_MAX_SIZE) break;
+        if (font->ref) continue;
+        TRACE( "evicting %p, cache size %d\n", font, glyph_cache_size );
+        list_remove( &font->entry );
+        free_font_glyphs( font );
+        free( font );
+    }
+}
+
+/* account for a new slab, fails if the cache is full of fonts in use */
+static BOOL reserve_slab( SIZE_T size )
+{
+    BOOL ret = TRUE;
+
+    if (InterlockedExchangeAdd( &glyph_cache_size, size ) + size <= GLYPH_CACHE_MAX_SIZE) return TRUE;
+
+    pthread_mutex_lock( &font_cache_lock );
+    trim_font_cache();
+    if (glyph_cache_size > GLYPH_CACHE_MAX_SIZE)
+    {
+        InterlockedExchangeAdd( &glyph_cache_size, -(LONG)size );
+        ret = FALSE;
+    }
+    pthread_mutex_unlock( &font_cache_lock );
+    return ret;
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
     struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    UINT i = 0;
 
     NtGdiExtGetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -584,16 +653,7 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
     {
         ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    free( ptr->glyphs[i][j][k] );
-                free( ptr->glyphs[i][j] );
-            }
-        }
+        free_font_glyphs( ptr );
         list_remove( &ptr->entry );
     }
     else if (!(ptr = malloc( sizeof(*ptr) )))
@@ -604,6 +664,8 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 
     *ptr = font;
     ptr->ref = 1;
+    pthread_mutex_init( &ptr->slab_lock, NULL );
+    ptr->slabs = NULL;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
 done:
     list_add_head( &font_cache, &ptr->entry );
@@ -617,6 +679,82 @@ void release_cached_font( struct cached_font *font )
     if (font) InterlockedDecrement( &font->ref );
 }
 
+static struct cached_glyph *alloc_cached_glyph( struct cached_font *font, SIZE_T size )
+{
+    struct glyph_slab *slab;
+    void *ret = NULL;
+
+    size = (size + 7) & ~7;
+
+    pthread_mutex_lock( &font->slab_lock );
+    if ((slab = font->slabs) && slab->size - slab->used >= size)
+    {
+        ret = slab->data + slab->used;
+        slab->used += size;
+    }
+    else if (size > GLYPH_SLAB_SIZE / 4)
+    {
+        /* large glyphs get a slab of their own, leave the current one for the next glyphs */
+        if (!reserve_slab( size )) slab = NULL;
+        else if (!(slab = malloc( FIELD_OFFSET( struct glyph_slab, data[size] ))))
+            InterlockedExchangeAdd( &glyph_cache_size, -(LONG)size );
+        if (slab)
+        {
+            slab->size = slab->used = size;
+            if (font->slabs)
+            {
+                slab->next = font->slabs->next;
+                font->slabs->next = slab;
+            }
+            else
+            {
+                slab->next = NULL;
+                font->slabs = slab;
+            }
+            ret = slab->data;
+        }
+    }
+    else if (reserve_slab( GLYPH_SLAB_SIZE ))
+    {
+        if ((slab = malloc( FIELD_OFFSET( struct glyph_slab, data[GLYPH_SLAB_SIZE] ))))
+        {
+            slab->size = GLYPH_SLAB_SIZE;
+            slab->used = size;
+            slab->next = font->slabs;
+            font->slabs = slab;
+            ret = slab->data;
+        }
+        else InterlockedExchangeAdd( &glyph_cache_size, -GLYPH_SLAB_SIZE );
+    }
+    pthread_mutex_unlock( &font->slab_lock );
+    return ret;
+}
+
+/* give back the space of a glyph that didn't make it into the cache */
+static void free_cached_glyph( struct cached_font *font, struct cached_glyph *glyph, SIZE_T size )
+{
+    struct glyph_slab *slab, **prev;
+    BYTE *ptr = (BYTE *)glyph;
+
+    size = (size + 7) & ~7;
+
+    pthread_mutex_lock( &font->slab_lock );
+    for (prev = &font->slabs; (slab = *prev); prev = &slab->next)
+    {
+        if (ptr < slab->data || ptr >= slab->data + slab->used) continue;
+        /* only the last glyph of a slab can be reclaimed */
+        if (ptr + size == slab->data + slab->used) slab->used -= size;
+        if (!slab->used && (slab != font->slabs || slab->size != GLYPH_SLAB_SIZE))
+        {
+            *prev = slab->next;
+            InterlockedExchangeAdd( &glyph_cache_size, -(LONG)slab->size );
+            free( slab );
+        }
+        break;
+    }
+    pthread_mutex_unlock( &font->slab_lock );
+}
+
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
                                               struct cached_glyph *glyph )
 {
@@ -630,17 +768,12 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
         struct cached_glyph **ptr;
 
         ptr = calloc( 1, GLYPH_CACHE_PAGE_SIZE * sizeof(*ptr) );
-        if (!ptr)
-        {
-            free( glyph );
-            return NULL;
-        }
+        if (!ptr) return NULL;
         if (InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page], ptr, NULL ))
             free( ptr );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
     if (!ret) ret = glyph;
-    else free( glyph );
     return ret;
 }
 
@@ -737,8 +870,12 @@ static const int padding[4] = {0, 3, 2, 1};
  *
  * For non-antialiased bitmaps convert them to the 17-level format
  * using only values 0 or 16.
+ *
+ * If the cache is full, the glyph is returned in a temporary buffer that
+ * the caller frees once it is drawn, and *cached is set to FALSE.
  */
-static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font, UINT index, UINT flags )
+static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font, UINT index, UINT flags,
+                                                BOOL *cached )
 {
     UINT ggo_flags = font->aa_flags;
     static const MAT2 identity = { {0,1}, {0,0}, {0,0}, {0,1} };
@@ -748,7 +885,8 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
     BYTE *dst, *src;
     int pad = 0, stride, bit_count;
     GLYPHMETRICS metrics;
-    struct cached_glyph *glyph;
+    struct cached_glyph *glyph, *ret_glyph;
+    SIZE_T glyph_size;
 
     if (flags & ETO_GLYPH_INDEX) ggo_flags |= GGO_GLYPH_INDEX;
     indices[0] = index;
@@ -765,8 +903,10 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
     bit_count = get_glyph_depth( font->aa_flags );
     stride = get_dib_stride( metrics.gmBlackBoxX, bit_count );
     size = metrics.gmBlackBoxY * stride;
-    glyph = malloc( FIELD_OFFSET( struct cached_glyph, bits[size] ));
-    if (!glyph) return NULL;
+    glyph_size = FIELD_OFFSET( struct cached_glyph, bits[size] );
+    if ((glyph = alloc_cached_glyph( font, glyph_size ))) *cached = TRUE;
+    else if ((glyph = malloc( glyph_size ))) *cached = FALSE;
+    else return NULL;
     if (!size) goto done;  /* empty glyph */
 
     if (bit_count == 8) pad = padding[ metrics.gmBlackBoxX % 4 ];
@@ -775,7 +915,8 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
                                 &identity, FALSE );
     if (ret == GDI_ERROR)
     {
-        free( glyph );
+        if (*cached) free_cached_glyph( font, glyph, glyph_size );
+        else free( glyph );
         return NULL;
     }
     assert( ret <= size );
@@ -800,15 +941,112 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
-    return add_cached_glyph( font, index, flags, glyph );
+    if (!*cached) return glyph;
+    /* if another thread got there first, use its copy and reclaim ours */
+    if ((ret_glyph = add_cached_glyph( font, index, flags, glyph )) != glyph)
+        free_cached_glyph( font, glyph, glyph_size );
+    return ret_glyph;
+}
+
+/* maximum size of the combined mask of a glyph run */
+#define MAX_RUN_MASK_SIZE  (256 * 1024)
+
+struct run_glyph
+{
+    struct cached_glyph       *glyph;
+    RECT                       rect;
+    BOOL                       cached;
+};
+
+/***********************************************************************
+ *         draw_glyph_run
+ *
+ * Combine the glyphs of a string into a single mask, so that each clipping
+ * rectangle is drawn in one pass. This is only possible when the glyphs don't
+ * cover the same pixels, as blending them one after the other would give a
+ * different result; FALSE is returned in that case and nothing is drawn.
+ */
+static BOOL draw_glyph_run( dib_info *dib, const struct run_glyph *glyphs, UINT count, int bit_count,
+                            DWORD text_color, const struct font_intensities *intensity,
+                            const struct clipped_rects *clipped_rects )
+{
+    int bpp = bit_count / 8, glyph_stride, x, y, i;
+    RECT run = { 0 }, clipped_rect;
+    dib_info mask_dib;
+    POINT src_origin;
+    BYTE *mask, *dst;
+    const BYTE *src;
+    UINT n;
+
+    for (n = 0; n < count; n++) union_rect( &run, &run, &glyphs[n].rect );
+    if (IsRectEmpty( &run )) return TRUE;
+
+    mask_dib.bit_count    = bit_count;
+    mask_dib.width        = run.right - run.left;
+    mask_dib.height       = run.bottom - run.top;
+    mask_dib.rect.left    = 0;
+    mask_dib.rect.top     = 0;
+    mask_dib.rect.right   = mask_dib.width;
+    mask_dib.rect.bottom  = mask_dib.height;
+    mask_dib.stride       = get_dib_stride( mask_dib.width, bit_count );
+    mask_dib.bits.is_copy = FALSE;
+    mask_dib.bits.free    = NULL;
+    mask_dib.private_bits = TRUE;
+
+    if ((LONGLONG)mask_dib.stride * mask_dib.height > MAX_RUN_MASK_SIZE) return FALSE;
+    if (!(mask = calloc( mask_dib.height, mask_dib.stride ))) return FALSE;
+    mask_dib.bits.ptr = mask;
+
+    for (n = 0; n < count; n++)
+    {
+        const RECT *rect = &glyphs[n].rect;
+        int row_size = (rect->right - rect->left) * bpp;
+
+        if (IsRectEmpty( rect )) continue;
+        glyph_stride = get_dib_stride( rect->right - rect->left, bit_count );
+        src = glyphs[n].glyph->bits;
+        dst = mask + (rect->top - run.top) * mask_dib.stride + (rect->left - run.left) * bpp;
+        for (y = rect->top; y < rect->bottom; y++, src += glyph_stride, dst += mask_dib.stride)
+        {
+            for (x = 0; x < row_size; x += bpp)
+            {
+                for (i = 0; i < bpp; i++) if (src[x + i]) break;
+                if (i == bpp) continue;
+                for (i = 0; i < bpp; i++) if (dst[x + i]) break;
+                if (i < bpp)
+                {
+                    free( mask );
+                    return FALSE;
+                }
+                memcpy( dst + x, src + x, bpp );
+            }
+        }
+    }
+
+    for (i = 0; i < clipped_rects->count; i++)
+    {
+        if (!intersect_rect( &clipped_rect, &run, clipped_rects->rects + i )) continue;
+        src_origin.x = clipped_rect.left - run.left;
+        src_origin.y = clipped_rect.top  - run.top;
+        if (bit_count == 32)
+            dib->funcs->draw_subpixel_glyph( dib, &clipped_rect, &mask_dib, &src_origin,
+                                             text_color, intensity->gamma_ramp );
+        else
+            dib->funcs->draw_glyph( dib, &clipped_rect, &mask_dib, &src_origin,
+                                    text_color, intensity->ranges );
+    }
+    free( mask );
+    return TRUE;
 }
 
 static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT x, INT y,
                            UINT flags, const WCHAR *str, UINT count, const INT *dx,
                            const struct clipped_rects *clipped_rects, RECT *bounds )
 {
-    UINT i;
+    UINT i, run_count = 0;
     struct cached_glyph *glyph;
+    struct run_glyph *run = NULL;
+    BOOL cached;
     dib_info glyph_dib;
     DWORD text_color;
     struct font_intensities intensity;
@@ -818,6 +1056,7 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
     glyph_dib.rect.top     = 0;
     glyph_dib.bits.is_copy = FALSE;
     glyph_dib.bits.free    = NULL;
+    glyph_dib.private_bits = TRUE;
 
     text_color = get_pixel_color( dc, dib, dc->attr->text_color, TRUE );
 
@@ -826,19 +1065,37 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
     else
         get_aa_ranges( dib->funcs->pixel_to_colorref( dib, text_color ), intensity.ranges );
 
+    if (count > 1) run = malloc( count * sizeof(*run) );
+
     for (i = 0; i < count; i++)
     {
+        cached = TRUE;
         if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
-            !(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
-
-        glyph_dib.width       = glyph->metrics.gmBlackBoxX;
-        glyph_dib.height      = glyph->metrics.gmBlackBoxY;
-        glyph_dib.rect.right  = glyph->metrics.gmBlackBoxX;
-        glyph_dib.rect.bottom = glyph->metrics.gmBlackBoxY;
-        glyph_dib.stride      = get_dib_stride( glyph->metrics.gmBlackBoxX, glyph_dib.bit_count );
-        glyph_dib.bits.ptr    = glyph->bits;
+            !(glyph = cache_glyph_bitmap( dc, font, str[i], flags, &cached ))) continue;
 
-        draw_glyph( dib, x, y, &glyph->metrics, &glyph_dib, text_color, &intensity, clipped_rects, bounds );
+        if (run)
+        {
+            RECT *rect = &run[run_count].rect;
+
+            rect->left   = x          + glyph->metrics.gmptGlyphOrigin.x;
+            rect->top    = y          - glyph->metrics.gmptGlyphOrigin.y;
+            rect->right  = rect->left + glyph->metrics.gmBlackBoxX;
+            rect->bottom = rect->top  + glyph->metrics.gmBlackBoxY;
+            if (bounds) add_bounds_rect( bounds, rect );
+            run[run_count].cached = cached;
+            run[run_count++].glyph = glyph;
+        }
+        else
+        {
+            glyph_dib.width       = glyph->metrics.gmBlackBoxX;
+            glyph_dib.height      = glyph->metrics.gmBlackBoxY;
+            glyph_dib.rect.right  = glyph->metrics.gmBlackBoxX;
+            glyph_dib.rect.bottom = glyph->metrics.gmBlackBoxY;
+            glyph_dib.stride      = get_dib_stride( glyph->metrics.gmBlackBoxX, glyph_dib.bit_count );
+            glyph_dib.bits.ptr    = glyph->bits;
+
+            draw_glyph( dib, x, y, &glyph->metrics, &glyph_dib, text_color, &intensity, clipped_rects, bounds );
+        }
 
         if (dx)
         {
@@ -855,7 +1112,32 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
             x += glyph->metrics.gmCellIncX;
             y += glyph->metrics.gmCellIncY;
         }
+
+        if (!run && !cached) free( glyph );
+    }
+
+    if (!run) return;
+
+    if (!draw_glyph_run( dib, run, run_count, glyph_dib.bit_count, text_color, &intensity, clipped_rects ))
+    {
+        /* overlapping glyphs, draw them in order */
+        for (i = 0; i < run_count; i++)
+        {
+            glyph = run[i].glyph;
+            glyph_dib.width       = glyph->metrics.gmBlackBoxX;
+            glyph_dib.height      = glyph->metrics.gmBlackBoxY;
+            glyph_dib.rect.right  = glyph->metrics.gmBlackBoxX;
+            glyph_dib.rect.bottom = glyph->metrics.gmBlackBoxY;
+            glyph_dib.stride      = get_dib_stride( glyph->metrics.gmBlackBoxX, glyph_dib.bit_count );
+            glyph_dib.bits.ptr    = glyph->bits;
+
+            draw_glyph( dib, run[i].rect.left - glyph->metrics.gmptGlyphOrigin.x,
+                        run[i].rect.top + glyph->metrics.gmptGlyphOrigin.y,
+                        &glyph->metrics, &glyph_dib, text_color, &intensity, clipped_rects, NULL );
+        }
     }
+    for (i = 0; i < run_count; i++) if (!run[i].cached) free( run[i].glyph );
+    free( run );
 }
 
 BOOL render_aa_text_bitmapinfo( DC *dc, BITMAPINFO *info, struct gdi_image_bits *bits,
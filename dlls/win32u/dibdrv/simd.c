@@ -0,0 +1,357 @@
+/*
+ * DIB driver vectorized row primitives
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Each function processes a prefix of the row and returns the number of pixels
+ * it has handled; the caller finishes the row with the generic code. Results
+ * have to be identical to the generic code bit for bit, including for invalid
+ * premultiplied pixels, so blocks that the vector code cannot reproduce exactly
+ * are left to the caller as well.
+ *
+ * Divisions by 255 with rounding, (v + 127) / 255 for v <= 255 * 255, are
+ * computed exactly as ((v + 128) + ((v + 128) >> 8)) >> 8, or equivalently
+ * ((v + 128) * 257) >> 16.
+ */
+
+#include "ntgdi_private.h"
+#include "dibdrv.h"
+
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dib);
+
+static int rop_32_generic( DWORD *dst, int len, DWORD and, DWORD xor )
+{
+    return 0;
+}
+
+static int blend_argb_generic( DWORD *dst, const DWORD *src, int len )
+{
+    return 0;
+}
+
+static int blend_constant_alpha_generic( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    return 0;
+}
+
+static int convert_24_to_8888_generic( DWORD *dst, const BYTE *src, int len )
+{
+    return 0;
+}
+
+struct dib_row_funcs dib_row_funcs =
+{
+    rop_32_generic,
+    blend_argb_generic,
+    blend_constant_alpha_generic,
+    convert_24_to_8888_generic,
+};
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && !defined(__i386_on_x86_64__)
+
+#include <immintrin.h>
+
+#define SSE2_TARGET  __attribute__((target("sse2")))
+#define SSSE3_TARGET __attribute__((target("ssse3")))
+#define AVX2_TARGET  __attribute__((target("avx2")))
+
+static SSE2_TARGET int rop_32_sse2( DWORD *dst, int len, DWORD and, DWORD xor )
+{
+    const __m128i and_vec = _mm_set1_epi32( and ), xor_vec = _mm_set1_epi32( xor );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_xor_si128( _mm_and_si128( d, and_vec ), xor_vec ));
+    }
+    return x;
+}
+
+/* src + (dst * (255 - src_alpha) + 127) / 255 for four channels of two pixels */
+static SSE2_TARGET inline __m128i blend_argb_epi16_sse2( __m128i s, __m128i d )
+{
+    __m128i inv = _mm_sub_epi16( _mm_set1_epi16( 255 ), _mm_shufflehi_epi16( _mm_shufflelo_epi16( s, 0xff ), 0xff ));
+    __m128i v = _mm_add_epi16( _mm_mullo_epi16( d, inv ), _mm_set1_epi16( 128 ));
+
+    return _mm_add_epi16( s, _mm_mulhi_epu16( v, _mm_set1_epi16( 257 )));
+}
+
+static SSE2_TARGET int blend_argb_sse2( DWORD *dst, const DWORD *src, int len )
+{
+    const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16( 255 );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = blend_argb_epi16_sse2( _mm_unpacklo_epi8( s, zero ), _mm_unpacklo_epi8( d, zero ));
+        __m128i hi = blend_argb_epi16_sse2( _mm_unpackhi_epi8( s, zero ), _mm_unpackhi_epi8( d, zero ));
+
+        /* color channels larger than alpha overflow into the next channel */
+        if (_mm_movemask_epi8( _mm_or_si128( _mm_cmpgt_epi16( lo, max ), _mm_cmpgt_epi16( hi, max ))))
+            break;
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ));
+    }
+    return x;
+}
+
+/* (src * alpha + dst * (255 - alpha) + 127) / 255 for four channels of two pixels */
+static SSE2_TARGET inline __m128i blend_constant_alpha_epi16_sse2( __m128i s, __m128i d, __m128i alpha, __m128i inv )
+{
+    __m128i v = _mm_add_epi16( _mm_add_epi16( _mm_mullo_epi16( s, alpha ), _mm_mullo_epi16( d, inv )),
+                               _mm_set1_epi16( 128 ));
+
+    return _mm_mulhi_epu16( v, _mm_set1_epi16( 257 ));
+}
+
+static SSE2_TARGET int blend_constant_alpha_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha_vec = _mm_set1_epi16( alpha ), inv_vec = _mm_set1_epi16( 255 - alpha );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo = blend_constant_alpha_epi16_sse2( _mm_unpacklo_epi8( s, zero ), _mm_unpacklo_epi8( d, zero ),
+                                                      alpha_vec, inv_vec );
+        __m128i hi = blend_constant_alpha_epi16_sse2( _mm_unpackhi_epi8( s, zero ), _mm_unpackhi_epi8( d, zero ),
+                                                      alpha_vec, inv_vec );
+
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ));
+    }
+    return x;
+}
+
+static SSSE3_TARGET int convert_24_to_8888_ssse3( DWORD *dst, const BYTE *src, int len )
+{
+    const __m128i shuffle = _mm_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+    int x;
+
+    /* each load reads 16 bytes for 12 used ones, make sure it stays inside the row */
+    for (x = 0; x + 6 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x * 3) );
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_shuffle_epi8( s, shuffle ));
+    }
+    return x;
+}
+
+static AVX2_TARGET int rop_32_avx2( DWORD *dst, int len, DWORD and, DWORD xor )
+{
+    const __m256i and_vec = _mm256_set1_epi32( and ), xor_vec = _mm256_set1_epi32( xor );
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m256i d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+        _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_xor_si256( _mm256_and_si256( d, and_vec ), xor_vec ));
+    }
+    return x + rop_32_sse2( dst + x, len - x, and, xor );
+}
+
+static AVX2_TARGET inline __m256i blend_argb_epi16_avx2( __m256i s, __m256i d )
+{
+    __m256i inv = _mm256_sub_epi16( _mm256_set1_epi16( 255 ),
+                                    _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( s, 0xff ), 0xff ));
+    __m256i v = _mm256_add_epi16( _mm256_mullo_epi16( d, inv ), _mm256_set1_epi16( 128 ));
+
+    return _mm256_add_epi16( s, _mm256_mulhi_epu16( v, _mm256_set1_epi16( 257 )));
+}
+
+static AVX2_TARGET int blend_argb_avx2( DWORD *dst, const DWORD *src, int len )
+{
+    const __m256i zero = _mm256_setzero_si256(), max = _mm256_set1_epi16( 255 );
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m256i s = _mm256_loadu_si256( (const __m256i *)(src + x) );
+        __m256i d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+        __m256i lo = blend_argb_epi16_avx2( _mm256_unpacklo_epi8( s, zero ), _mm256_unpacklo_epi8( d, zero ));
+        __m256i hi = blend_argb_epi16_avx2( _mm256_unpackhi_epi8( s, zero ), _mm256_unpackhi_epi8( d, zero ));
+
+        if (_mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpgt_epi16( lo, max ), _mm256_cmpgt_epi16( hi, max ))))
+            return x;
+        _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_packus_epi16( lo, hi ));
+    }
+    return x + blend_argb_sse2( dst + x, src + x, len - x );
+}
+
+static AVX2_TARGET inline __m256i blend_constant_alpha_epi16_avx2( __m256i s, __m256i d, __m256i alpha, __m256i inv )
+{
+    __m256i v = _mm256_add_epi16( _mm256_add_epi16( _mm256_mullo_epi16( s, alpha ), _mm256_mullo_epi16( d, inv )),
+                                  _mm256_set1_epi16( 128 ));
+
+    return _mm256_mulhi_epu16( v, _mm256_set1_epi16( 257 ));
+}
+
+static AVX2_TARGET int blend_constant_alpha_avx2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alpha_vec = _mm256_set1_epi16( alpha ), inv_vec = _mm256_set1_epi16( 255 - alpha );
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m256i s = _mm256_loadu_si256( (const __m256i *)(src + x) );
+        __m256i d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+        __m256i lo = blend_constant_alpha_epi16_avx2( _mm256_unpacklo_epi8( s, zero ), _mm256_unpacklo_epi8( d, zero ),
+                                                      alpha_vec, inv_vec );
+        __m256i hi = blend_constant_alpha_epi16_avx2( _mm256_unpackhi_epi8( s, zero ), _mm256_unpackhi_epi8( d, zero ),
+                                                      alpha_vec, inv_vec );
+
+        _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_packus_epi16( lo, hi ));
+    }
+    return x + blend_constant_alpha_sse2( dst + x, src + x, len - x, alpha );
+}
+
+static void init_cpu_row_funcs(void)
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports( "avx2" ))
+    {
+        TRACE( "using AVX2 row functions\n" );
+        dib_row_funcs.rop_32 = rop_32_avx2;
+        dib_row_funcs.blend_argb = blend_argb_avx2;
+        dib_row_funcs.blend_constant_alpha = blend_constant_alpha_avx2;
+    }
+    else if (__builtin_cpu_supports( "sse2" ))
+    {
+        TRACE( "using SSE2 row functions\n" );
+        dib_row_funcs.rop_32 = rop_32_sse2;
+        dib_row_funcs.blend_argb = blend_argb_sse2;
+        dib_row_funcs.blend_constant_alpha = blend_constant_alpha_sse2;
+    }
+    if (__builtin_cpu_supports( "ssse3" ))
+        dib_row_funcs.convert_24_to_8888 = convert_24_to_8888_ssse3;
+}
+
+#elif defined(__aarch64__)
+
+#include <arm_neon.h>
+
+static int rop_32_neon( DWORD *dst, int len, DWORD and, DWORD xor )
+{
+    const uint32x4_t and_vec = vdupq_n_u32( and ), xor_vec = vdupq_n_u32( xor );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+        vst1q_u32( (uint32_t *)dst + x, veorq_u32( vandq_u32( vld1q_u32( (uint32_t *)dst + x ), and_vec ), xor_vec ));
+    return x;
+}
+
+/* (v + 127) / 255 narrowed to 8 bits */
+static inline uint8x8_t div255_neon( uint16x8_t v )
+{
+    v = vaddq_u16( v, vdupq_n_u16( 128 ));
+    return vaddhn_u16( v, vshrq_n_u16( v, 8 ));
+}
+
+static int blend_argb_neon( DWORD *dst, const DWORD *src, int len )
+{
+    static const uint8_t alpha_index[16] = { 3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15 };
+    const uint8x16_t alpha_tbl = vld1q_u8( alpha_index );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        uint8x16_t s = vld1q_u8( (const uint8_t *)(src + x) );
+        uint8x16_t d = vld1q_u8( (const uint8_t *)(dst + x) );
+        uint8x16_t inv = vmvnq_u8( vqtbl1q_u8( s, alpha_tbl ));
+        uint16x8_t lo = vaddw_u8( vmovl_u8( div255_neon( vmull_u8( vget_low_u8( d ), vget_low_u8( inv ) ))),
+                                  vget_low_u8( s ));
+        uint16x8_t hi = vaddw_u8( vmovl_u8( div255_neon( vmull_high_u8( d, inv ))), vget_high_u8( s ));
+
+        /* color channels larger than alpha overflow into the next channel */
+        if (vmaxvq_u16( vmaxq_u16( lo, hi )) > 255) break;
+        vst1q_u8( (uint8_t *)(dst + x), vcombine_u8( vmovn_u16( lo ), vmovn_u16( hi )));
+    }
+    return x;
+}
+
+static int blend_constant_alpha_neon( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    const uint8x8_t alpha_vec = vdup_n_u8( alpha ), inv_vec = vdup_n_u8( 255 - alpha );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        uint8x16_t s = vld1q_u8( (const uint8_t *)(src + x) );
+        uint8x16_t d = vld1q_u8( (const uint8_t *)(dst + x) );
+        uint8x8_t lo = div255_neon( vmlal_u8( vmull_u8( vget_low_u8( s ), alpha_vec ), vget_low_u8( d ), inv_vec ));
+        uint8x8_t hi = div255_neon( vmlal_u8( vmull_u8( vget_high_u8( s ), alpha_vec ), vget_high_u8( d ), inv_vec ));
+
+        vst1q_u8( (uint8_t *)(dst + x), vcombine_u8( lo, hi ));
+    }
+    return x;
+}
+
+static int convert_24_to_8888_neon( DWORD *dst, const BYTE *src, int len )
+{
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        uint8x8x3_t s = vld3_u8( src + x * 3 );
+        uint8x8x4_t d;
+
+        d.val[0] = s.val[0];
+        d.val[1] = s.val[1];
+        d.val[2] = s.val[2];
+        d.val[3] = vdup_n_u8( 0 );
+        vst4_u8( (uint8_t *)(dst + x), d );
+    }
+    return x;
+}
+
+static void init_cpu_row_funcs(void)
+{
+    TRACE( "using NEON row functions\n" );
+    dib_row_funcs.rop_32 = rop_32_neon;
+    dib_row_funcs.blend_argb = blend_argb_neon;
+    dib_row_funcs.blend_constant_alpha = blend_constant_alpha_neon;
+    dib_row_funcs.convert_24_to_8888 = convert_24_to_8888_neon;
+}
+
+#else
+
+static void init_cpu_row_funcs(void)
+{
+}
+
+#endif
+
+/***********************************************************************
+ *           init_dib_row_funcs
+ *
+ * Select the row functions for the host CPU. Setting WINEDIBSIMD=0 keeps
+ * the generic code, which is useful to compare results.
+ */
+void init_dib_row_funcs(void)
+{
+    const char *env = getenv( "WINEDIBSIMD" );
+
+    if (env && !atoi( env )) return;
+    init_cpu_row_funcs();
+}
@@ -70,6 +70,63 @@ static inline struct font_physdev *get_font_dev( PHYSDEV dev )
     return (struct font_physdev *)dev;
 }
 
+#define FONT_CATALOG_MAGIC    0x544e4657  /* WFNT */
+#define FONT_CATALOG_VERSION  2
+
+struct font_catalog_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD size;        /* total size of the catalog */
+    DWORD lcid;        /* locale used for the face names */
+    DWORD dir_count;
+    DWORD face_count;
+};
+
+struct font_catalog_dir
+{
+    DWORD time_low;    /* last write time of the directory */
+    DWORD time_high;
+    DWORD flags;
+    DWORD name_len;    /* in WCHARs, including the terminating null */
+    WCHAR name[1];
+};
+
+enum font_catalog_name
+{
+    CATALOG_FAMILY_NAME,
+    CATALOG_SECOND_NAME,
+    CATALOG_STYLE_NAME,
+    CATALOG_FULL_NAME,
+    CATALOG_FILE_NAME,
+    CATALOG_NAME_COUNT
+};
+
+struct font_catalog_face
+{
+    DWORD                   index;
+    DWORD                   flags;
+    DWORD                   ntmflags;
+    DWORD                   version;
+    FONTSIGNATURE           fs;
+    struct bitmap_font_size size;
+    DWORD                   scalable;
+    DWORD                   file_time_low;   /* last write time of the font file */
+    DWORD                   file_time_high;
+    DWORD                   file_size_low;   /* size of the font file */
+    DWORD                   file_size_high;
+    DWORD                   null_names;  /* mask of the names that are NULL */
+    DWORD                   names_len;   /* in WCHARs, all the names with their terminating nulls */
+    WCHAR                   names[1];
+};
+
+/* a face from the font catalog that is only created when its family is used */
+struct lazy_face
+{
+    const struct font_catalog_face *face;
+    DWORD                           flags;  /* ADDFONT flags, including ADDFONT_VERTICAL_FONT */
+};
+
 struct gdi_font_family
 {
     struct wine_rb_entry    name_entry;
@@ -79,6 +136,8 @@ struct gdi_font_family
     WCHAR                   second_name[LF_FACESIZE];
     struct list             faces;
     struct gdi_font_family *replacement;
+    struct lazy_face       *lazy_faces;
+    UINT                    lazy_count;
 };
 
 struct gdi_font_face
@@ -206,6 +265,11 @@ static struct font_gamma_ramp font_gamma_ramp;
 
 static void add_face_to_cache( struct gdi_font_face *face );
 static void remove_face_from_cache( struct gdi_font_face *face );
+static void load_lazy_faces( struct gdi_font_family *family );
+static void add_face_to_catalog( const WCHAR *family_name, const WCHAR *second_name,
+                                 const WCHAR *style, const WCHAR *fullname, const WCHAR *file,
+                                 UINT index, FONTSIGNATURE fs, DWORD ntmflags, DWORD version,
+                                 DWORD flags, const struct bitmap_font_size *size );
 
 static CPTABLEINFO utf8_cp;
 static CPTABLEINFO oem_cp;
@@ -877,6 +941,8 @@ static struct gdi_font_family *create_family( const WCHAR *name, const WCHAR *se
     else family->second_name[0] = 0;
     list_init( &family->faces );
     family->replacement = NULL;
+    family->lazy_faces = NULL;
+    family->lazy_count = 0;
     wine_rb_put( &family_name_tree, family->family_name, &family->name_entry );
     if (family->second_name[0]) wine_rb_put( &family_second_name_tree, family->second_name, &family->second_name_entry );
     return family;
@@ -908,23 +974,126 @@ static struct gdi_font_family *find_family_from_any_name( const WCHAR *name )
     return WINE_RB_ENTRY_VALUE( entry, struct gdi_font_family, second_name_entry );
 }
 
+/* full names of the scalable lazy faces, sorted for lookups */
+struct lazy_full_name
+{
+    const WCHAR *full_name;
+    const WCHAR *family_name;
+};
+
+static struct lazy_full_name *lazy_full_names;
+static UINT lazy_full_name_count;
+
+static const struct lazy_full_name *find_lazy_full_name( const WCHAR *full_name )
+{
+    const struct lazy_full_name *ret = NULL;
+    int min = 0, max = lazy_full_name_count - 1, pos, res;
+
+    /* return the first one in catalog order, that's the one that would have been added first */
+    while (min <= max)
+    {
+        pos = (min + max) / 2;
+        res = facename_compare( full_name, lazy_full_names[pos].full_name, LF_FULLFACESIZE - 1 );
+        if (!res) ret = &lazy_full_names[pos];
+        if (res > 0) min = pos + 1;
+        else max = pos - 1;
+    }
+    return ret;
+}
+
+static void load_lazy_faces_from_full_name( const WCHAR *full_name )
+{
+    const struct lazy_full_name *lazy;
+    struct gdi_font_family *family;
+    WCHAR vert_family[LF_FACESIZE];
+
+    if ((lazy = find_lazy_full_name( full_name )) &&
+        (family = find_family_from_name( lazy->family_name )))
+        load_lazy_faces( family );
+
+    if (full_name[0] != '@' || !(lazy = find_lazy_full_name( full_name + 1 ))) return;
+    vert_family[0] = '@';
+    lstrcpynW( vert_family + 1, lazy->family_name, LF_FACESIZE - 1 );
+    if ((family = find_family_from_name( vert_family ))) load_lazy_faces( family );
+}
+
 static struct gdi_font_face *find_face_from_full_name( const WCHAR *full_name )
 {
     struct wine_rb_entry *entry;
+
+    load_lazy_faces_from_full_name( full_name );
     if (!(entry = wine_rb_get( &face_full_name_tree, full_name ))) return NULL;
     return WINE_RB_ENTRY_VALUE( entry, struct gdi_font_face, full_name_entry );
 }
 
-static const struct list *get_family_face_list( const struct gdi_font_family *family )
+/* the family that owns the faces of a family, which differs for replacements */
+static struct gdi_font_family *get_face_list_family( struct gdi_font_family *family )
 {
-    return family->replacement ? &family->replacement->faces : &family->faces;
+    return family->replacement ? family->replacement : family;
+}
+
+static const struct list *get_family_face_list( struct gdi_font_family *family )
+{
+    family = get_face_list_family( family );
+    load_lazy_faces( family );
+    return &family->faces;
+}
+
+static void get_catalog_face_names( const struct font_catalog_face *face, const WCHAR *names[CATALOG_NAME_COUNT] )
+{
+    DWORD i, pos = 0;
+
+    for (i = 0; i < CATALOG_NAME_COUNT; i++)
+    {
+        names[i] = (face->null_names & (1 << i)) ? NULL : face->names + pos;
+        pos += lstrlenW( face->names + pos ) + 1;
+    }
+}
+
+static BOOL lazy_faces_match_file( const struct gdi_font_family *family, const WCHAR *file_name,
+                                   BOOL full_path )
+{
+    const WCHAR *names[CATALOG_NAME_COUNT], *file;
+    UINT i;
+
+    for (i = 0; i < family->lazy_count; i++)
+    {
+        get_catalog_face_names( family->lazy_faces[i].face, names );
+        if (!(file = names[CATALOG_FILE_NAME])) continue;
+        if (!full_path && wcsrchr( file, '\\' )) file = wcsrchr( file, '\\' ) + 1;
+        if (!wcsicmp( file, file_name )) return TRUE;
+    }
+    return FALSE;
+}
+
+static BOOL lazy_faces_match_full_name( const struct gdi_font_family *family, const WCHAR *full_name )
+{
+    const WCHAR *names[CATALOG_NAME_COUNT];
+    UINT i;
+
+    for (i = 0; i < family->lazy_count; i++)
+    {
+        get_catalog_face_names( family->lazy_faces[i].face, names );
+        if (!names[CATALOG_FULL_NAME]) continue;
+        if (family->lazy_faces[i].flags & ADDFONT_VERTICAL_FONT)
+        {
+            if (full_name[0] == '@' &&
+                !facename_compare( full_name + 1, names[CATALOG_FULL_NAME], LF_FACESIZE - 2 ))
+                return TRUE;
+        }
+        else if (!facename_compare( full_name, names[CATALOG_FULL_NAME], LF_FACESIZE - 1 )) return TRUE;
+    }
+    return FALSE;
 }
 
 static struct gdi_font_face *family_find_face_from_filename( struct gdi_font_family *family, const WCHAR *file_name )
 {
     struct gdi_font_face *face;
     const WCHAR *file;
-    LIST_FOR_EACH_ENTRY( face, get_family_face_list(family), struct gdi_font_face, entry )
+
+    family = get_face_list_family( family );
+    if (lazy_faces_match_file( family, file_name, FALSE )) load_lazy_faces( family );
+    LIST_FOR_EACH_ENTRY( face, &family->faces, struct gdi_font_face, entry )
     {
         if (!face->file) continue;
         file = wcsrchr(face->file, '\\');
@@ -974,6 +1143,7 @@ static BOOL add_family_replacement( const WCHAR *new_name, const WCHAR *replace
 
     /* also add replacement for vertical font if necessary */
     if (replace[0] == '@') return TRUE;
+    load_lazy_faces( family );
     if (list_empty( &family->faces )) return TRUE;
     face = LIST_ENTRY( list_head(&family->faces), struct gdi_font_face, entry );
     if (!(face->fs.fsCsb[0] & FS_DBCS_MASK)) return TRUE;
@@ -1128,6 +1298,7 @@ static void dump_gdi_font_list(void)
     WINE_RB_FOR_EACH_ENTRY( family, &family_name_tree, struct gdi_font_family, name_entry )
     {
         TRACE( "Family: %s\n", debugstr_w(family->family_name) );
+        if (family->lazy_count) TRACE( "\t%u faces not loaded yet\n", family->lazy_count );
         LIST_FOR_EACH_ENTRY( face, &family->faces, struct gdi_font_face, entry )
         {
             TRACE( "\t%s\t%s\t%08x", debugstr_w(face->style_name), debugstr_w(face->full_name),
@@ -1206,6 +1377,7 @@ static int remove_font( const WCHAR *file, DWORD flags )
     WINE_RB_FOR_EACH_ENTRY_DESTRUCTOR( family, family_next, &family_name_tree, struct gdi_font_family, name_entry )
     {
         family->refcount++;
+        if (lazy_faces_match_file( family, file, TRUE )) load_lazy_faces( family );
         LIST_FOR_EACH_ENTRY_SAFE( face, face_next, &family->faces, struct gdi_font_face, entry )
         {
             if (!face->file) continue;
@@ -1341,8 +1513,13 @@ int add_gdi_face( const WCHAR *family_name, const WCHAR *second_name,
     struct gdi_font_family *family;
     int ret = 0;
 
+    if (file && !data_ptr)
+        add_face_to_catalog( family_name, second_name, style, fullname, file,
+                             index, fs, ntmflags, version, flags, size );
+
     if ((family = find_family_from_name( family_name ))) family->refcount++;
     else if (!(family = create_family( family_name, second_name ))) return ret;
+    load_lazy_faces( family );  /* keep the faces in the order they were added */
 
     if ((face = create_face( family, style, fullname, file, data_ptr, data_size,
                              index, fs, ntmflags, version, flags, size )))
@@ -1376,6 +1553,7 @@ int add_gdi_face( const WCHAR *family_name, const WCHAR *second_name,
 
         if ((family = find_family_from_name( vert_family ))) family->refcount++;
         else if (!(family = create_family( vert_family, vert_second ))) return ret;
+        load_lazy_faces( family );
 
         if ((face = create_face( family, style, fullname, file, data_ptr, data_size,
                                  index, fs, ntmflags, version, flags | ADDFONT_VERTICAL_FONT, size )))
@@ -1389,6 +1567,67 @@ int add_gdi_face( const WCHAR *family_name, const WCHAR *second_name,
     return ret;
 }
 
+static void create_lazy_face( struct gdi_font_family *family, const struct lazy_face *lazy )
+{
+    const struct font_catalog_face *cached = lazy->face;
+    const WCHAR *names[CATALOG_NAME_COUNT], *full_name;
+    struct bitmap_font_size size = cached->size;
+    WCHAR vert_full[LF_FULLFACESIZE];
+    struct gdi_font_face *face;
+
+    get_catalog_face_names( cached, names );
+    if ((full_name = names[CATALOG_FULL_NAME]) && (lazy->flags & ADDFONT_VERTICAL_FONT))
+    {
+        vert_full[0] = '@';
+        lstrcpynW( vert_full + 1, full_name, LF_FULLFACESIZE - 1 );
+        full_name = vert_full;
+    }
+    if ((face = create_face( family, names[CATALOG_STYLE_NAME], full_name, names[CATALOG_FILE_NAME],
+                             NULL, 0, cached->index, cached->fs, cached->ntmflags, cached->version,
+                             lazy->flags, cached->scalable ? NULL : &size )))
+        release_face( face );
+}
+
+/***********************************************************************
+ *           load_lazy_faces
+ *
+ * Create the faces of a family that were loaded from the font catalog.
+ */
+static void load_lazy_faces( struct gdi_font_family *family )
+{
+    struct lazy_face *faces = family->lazy_faces;
+    UINT i, count = family->lazy_count;
+
+    if (!count) return;
+    TRACE( "creating %u faces for %s\n", count, debugstr_w(family->family_name) );
+    family->lazy_faces = NULL;
+    family->lazy_count = 0;
+    for (i = 0; i < count; i++) create_lazy_face( family, &faces[i] );
+    free( faces );
+    release_family( family );  /* the reference held for the lazy faces */
+}
+
+static void add_lazy_face( const WCHAR *family_name, const WCHAR *second_name,
+                           const struct font_catalog_face *face, DWORD flags )
+{
+    struct gdi_font_family *family;
+    struct lazy_face *faces;
+
+    if ((family = find_family_from_name( family_name ))) family->refcount++;
+    else if (!(family = create_family( family_name, second_name ))) return;
+
+    if (!(faces = realloc( family->lazy_faces, (family->lazy_count + 1) * sizeof(*faces) )))
+    {
+        release_family( family );
+        return;
+    }
+    faces[family->lazy_count].face = face;
+    faces[family->lazy_count].flags = flags;
+    family->lazy_faces = faces;
+    /* the first lazy face keeps its reference until the faces are created */
+    if (family->lazy_count++) release_family( family );
+}
+
 /* font cache */
 
 struct cached_face
@@ -1864,7 +2103,27 @@ static BOOL can_select_face( const struct gdi_font_face *face, FONTSIGNATURE fs,
     return FALSE;
 }
 
-static struct gdi_font_face *find_best_matching_face( const struct gdi_font_family *family,
+/* check the coverage of the lazy faces of a family, to avoid creating them when they can't be used */
+static BOOL can_select_lazy_faces( const struct gdi_font_family *family, FONTSIGNATURE fs, BOOL can_use_bitmap )
+{
+    struct gdi_font_link *font_link;
+    BOOL found = FALSE;
+    UINT i;
+
+    for (i = 0; i < family->lazy_count; i++)
+    {
+        const struct font_catalog_face *face = family->lazy_faces[i].face;
+
+        if (!face->scalable && !can_use_bitmap) continue;
+        if (!fs.fsCsb[0]) return TRUE;
+        if (fs.fsCsb[0] & face->fs.fsCsb[0]) return TRUE;
+        found = TRUE;
+    }
+    if (!found || !(font_link = find_gdi_font_link( family->family_name ))) return FALSE;
+    return !!(fs.fsCsb[0] & font_link->fs.fsCsb[0]);
+}
+
+static struct gdi_font_face *find_best_matching_face( struct gdi_font_family *family,
                                                       const LOGFONTW *lf, FONTSIGNATURE fs,
                                                       BOOL can_use_bitmap )
 {
@@ -1875,7 +2134,9 @@ static struct gdi_font_face *find_best_matching_face( const struct gdi_font_fami
     int bd = lf->lfWeight > 550;
     int height = lf->lfHeight;
 
-    LIST_FOR_EACH_ENTRY( face, get_family_face_list(family), struct gdi_font_face, entry )
+    family = get_face_list_family( family );
+    if (can_select_lazy_faces( family, fs, can_use_bitmap )) load_lazy_faces( family );
+    LIST_FOR_EACH_ENTRY( face, &family->faces, struct gdi_font_face, entry )
     {
         int italic = !!(face->ntmFlags & NTM_ITALIC);
         int bold = !!(face->ntmFlags & NTM_BOLD);
@@ -1926,10 +2187,15 @@ static struct gdi_font_face *find_matching_face_by_name( const WCHAR *name, cons
 
     /* search by full face name */
     WINE_RB_FOR_EACH_ENTRY( family, &family_name_tree, struct gdi_font_family, name_entry )
-        LIST_FOR_EACH_ENTRY( face, get_family_face_list(family), struct gdi_font_face, entry )
+    {
+        struct gdi_font_family *owner = get_face_list_family( family );
+
+        if (lazy_faces_match_full_name( owner, name )) load_lazy_faces( owner );
+        LIST_FOR_EACH_ENTRY( face, &owner->faces, struct gdi_font_face, entry )
             if (!facename_compare( face->full_name, name, LF_FACESIZE - 1 ) &&
                 can_select_face( face, fs, can_use_bitmap ))
                 return face;
+    }
 
     if ((family = find_family_from_font_links( name, subst, fs )))
     {
@@ -3191,7 +3457,9 @@ static BOOL family_matches( struct gdi_font_family *family, const WCHAR *face_na
     struct gdi_font_face *face;
 
     if (!facename_compare( face_name, family->family_name, LF_FACESIZE - 1 )) return TRUE;
-    LIST_FOR_EACH_ENTRY( face, get_family_face_list(family), struct gdi_font_face, entry )
+    family = get_face_list_family( family );
+    if (lazy_faces_match_full_name( family, face_name )) return TRUE;
+    LIST_FOR_EACH_ENTRY( face, &family->faces, struct gdi_font_face, entry )
         if (!facename_compare( face_name, face->full_name, LF_FACESIZE - 1 )) return TRUE;
     return FALSE;
 }
@@ -6210,19 +6478,359 @@ static void load_directory_fonts( WCHAR *path, UINT flags )
     NtClose( handle );
 }
 
-static void load_file_system_fonts(void)
+/* font catalog */
+
+/* The faces found in the font directories are stored in a binary file shared by all the
+ * processes of the prefix, so that the fonts don't need to be parsed again on every startup.
+ * The catalog is valid as long as the directory list, their modification times, the size and
+ * modification time of every font file and the locale used for the face names are unchanged. */
+
+struct font_catalog
+{
+    char *data;
+    DWORD size;
+    DWORD alloc;
+    BOOL  failed;
+};
+
+struct font_dir
+{
+    WCHAR         path[MAX_PATH];
+    UINT          flags;
+    LARGE_INTEGER time;
+};
+
+static struct font_catalog *font_catalog;  /* catalog being built during the directory scan */
+
+static void *append_to_catalog( struct font_catalog *catalog, DWORD size )
+{
+    char *ret;
+
+    if (catalog->failed) return NULL;
+    size = (size + 3) & ~3;
+    if (catalog->size + size > catalog->alloc)
+    {
+        DWORD alloc = max( catalog->alloc * 2, catalog->size + size );
+
+        if (!(ret = realloc( catalog->data, alloc )))
+        {
+            catalog->failed = TRUE;
+            return NULL;
+        }
+        catalog->data = ret;
+        catalog->alloc = alloc;
+    }
+    ret = catalog->data + catalog->size;
+    memset( ret, 0, size );
+    catalog->size += size;
+    return ret;
+}
+
+static void init_nt_name( UNICODE_STRING *nt_name, OBJECT_ATTRIBUTES *attr, WCHAR *path )
+{
+    size_t len = lstrlenW( path );
+
+    while (len && path[len - 1] == '\\') len--;
+    nt_name->Buffer = path;
+    nt_name->MaximumLength = nt_name->Length = len * sizeof(WCHAR);
+    InitializeObjectAttributes( attr, nt_name, OBJ_CASE_INSENSITIVE, 0, NULL );
+}
+
+static void get_font_file_info( const WCHAR *file, LARGE_INTEGER *time, LARGE_INTEGER *size )
+{
+    FILE_NETWORK_OPEN_INFORMATION info;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING nt_name;
+
+    init_nt_name( &nt_name, &attr, (WCHAR *)file );
+    if (NtQueryFullAttributesFile( &attr, &info )) time->QuadPart = size->QuadPart = 0;
+    else
+    {
+        *time = info.LastWriteTime;
+        *size = info.EndOfFile;
+    }
+}
+
+static void add_face_to_catalog( const WCHAR *family_name, const WCHAR *second_name,
+                                 const WCHAR *style, const WCHAR *fullname, const WCHAR *file,
+                                 UINT index, FONTSIGNATURE fs, DWORD ntmflags, DWORD version,
+                                 DWORD flags, const struct bitmap_font_size *size )
+{
+    const WCHAR *names[CATALOG_NAME_COUNT] = { family_name, second_name, style, fullname, file };
+    struct font_catalog_face *face;
+    DWORD i, len = 0, null_names = 0;
+    LARGE_INTEGER time, file_size;
+    WCHAR *ptr;
+
+    if (!font_catalog) return;
+
+    for (i = 0; i < CATALOG_NAME_COUNT; i++)
+    {
+        if (names[i]) len += lstrlenW( names[i] ) + 1;
+        else
+        {
+            null_names |= 1 << i;
+            len++;
+        }
+    }
+    if (!(face = append_to_catalog( font_catalog, offsetof( struct font_catalog_face, names[len] ))))
+        return;
+
+    face->index      = index;
+    /* the antialiasing flags are left to the backend defaults, they may change between sessions */
+    face->flags      = LOWORD( flags );
+    face->ntmflags   = ntmflags;
+    face->version    = version;
+    face->fs         = fs;
+    face->scalable   = !size;
+    if (size) face->size = *size;
+    get_font_file_info( file, &time, &file_size );
+    face->file_time_low  = time.u.LowPart;
+    face->file_time_high = time.u.HighPart;
+    face->file_size_low  = file_size.u.LowPart;
+    face->file_size_high = file_size.u.HighPart;
+    face->null_names = null_names;
+    face->names_len  = len;
+    for (i = 0, ptr = face->names; i < CATALOG_NAME_COUNT; i++)
+    {
+        if (names[i]) lstrcpyW( ptr, names[i] );
+        ptr += lstrlenW( ptr ) + 1;
+    }
+    ((struct font_catalog_header *)font_catalog->data)->face_count++;
+}
+
+static void get_font_catalog_path( WCHAR *path, const char *suffix )
+{
+    char buffer[64];
+
+    sprintf( buffer, "\\??\\C:\\windows\\fntcache%s", suffix );
+    asciiz_to_unicode( path, buffer );
+}
+
+static void get_font_dir_time( struct font_dir *dir )
+{
+    FILE_BASIC_INFORMATION info;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING nt_name;
+
+    init_nt_name( &nt_name, &attr, dir->path );
+    if (NtQueryAttributesFile( &attr, &info )) dir->time.QuadPart = 0;
+    else dir->time = info.LastWriteTime;
+}
+
+static int lazy_full_name_compare( const void *a, const void *b )
+{
+    const struct lazy_full_name *name1 = a, *name2 = b;
+    int ret = facename_compare( name1->full_name, name2->full_name, LF_FULLFACESIZE - 1 );
+
+    /* keep the catalog order for identical names */
+    if (!ret) ret = name1->full_name < name2->full_name ? -1 : name1->full_name > name2->full_name;
+    return ret;
+}
+
+static BOOL check_catalog_name( const WCHAR *names, DWORD len, DWORD *pos )
+{
+    while (*pos < len) if (!names[(*pos)++]) return TRUE;
+    return FALSE;
+}
+
+/* replay the faces of a mapped catalog, returns FALSE if it doesn't match the font directories */
+static BOOL load_font_catalog_data( const char *data, SIZE_T size, const struct font_dir *dirs,
+                                    UINT dir_count, LCID lcid )
+{
+    const struct font_catalog_header *header = (const struct font_catalog_header *)data;
+    const WCHAR *names[CATALOG_NAME_COUNT], *prev_file = NULL;
+    LARGE_INTEGER time, file_size;
+    DWORD i, j, pos, len, offset;
+
+    if (size < sizeof(*header)) return FALSE;
+    if (header->magic != FONT_CATALOG_MAGIC || header->version != FONT_CATALOG_VERSION) return FALSE;
+    if (header->size != size || header->lcid != lcid || header->dir_count != dir_count) return FALSE;
+
+    offset = sizeof(*header);
+    for (i = 0; i < dir_count; i++)
+    {
+        const struct font_catalog_dir *dir = (const struct font_catalog_dir *)(data + offset);
+
+        if (size - offset < offsetof( struct font_catalog_dir, name )) return FALSE;
+        len = lstrlenW( dirs[i].path ) + 1;
+        if (dir->name_len != len || dir->flags != dirs[i].flags) return FALSE;
+        if (dir->time_low != dirs[i].time.u.LowPart || dir->time_high != dirs[i].time.u.HighPart) return FALSE;
+        offset += (offsetof( struct font_catalog_dir, name[len] ) + 3) & ~3;
+        if (offset > size || memcmp( dir->name, dirs[i].path, len * sizeof(WCHAR) )) return FALSE;
+    }
+
+    /* validate the whole face list before adding anything */
+    for (i = 0, pos = offset; i < header->face_count; i++)
+    {
+        const struct font_catalog_face *face = (const struct font_catalog_face *)(data + pos);
+
+        if (size - pos < offsetof( struct font_catalog_face, names )) return FALSE;
+        if (face->names_len > (size - pos - offsetof( struct font_catalog_face, names )) / sizeof(WCHAR))
+            return FALSE;
+        if (face->null_names & ((1 << CATALOG_FAMILY_NAME) | (1 << CATALOG_FILE_NAME))) return FALSE;
+        for (j = len = 0; j < CATALOG_NAME_COUNT; j++)
+            if (!check_catalog_name( face->names, face->names_len, &len )) return FALSE;
+
+        /* files can be replaced without changing their directory, the faces of a
+         * collection are next to each other so each file is only checked once */
+        get_catalog_face_names( face, names );
+        if (!prev_file || wcscmp( prev_file, names[CATALOG_FILE_NAME] ))
+        {
+            get_font_file_info( names[CATALOG_FILE_NAME], &time, &file_size );
+            prev_file = names[CATALOG_FILE_NAME];
+        }
+        if (face->file_time_low != time.u.LowPart || face->file_time_high != time.u.HighPart ||
+            face->file_size_low != file_size.u.LowPart || face->file_size_high != file_size.u.HighPart)
+        {
+            TRACE( "%s has changed\n", debugstr_w(names[CATALOG_FILE_NAME]) );
+            return FALSE;
+        }
+        pos += (offsetof( struct font_catalog_face, names[face->names_len] ) + 3) & ~3;
+    }
+    if (pos != size) return FALSE;
+
+    if (header->face_count &&
+        !(lazy_full_names = malloc( header->face_count * sizeof(*lazy_full_names) )))
+        return FALSE;
+    lazy_full_name_count = 0;
+
+    /* the faces are only created once their family is used */
+    for (i = 0; i < header->face_count; i++)
+    {
+        const struct font_catalog_face *face = (const struct font_catalog_face *)(data + offset);
+
+        get_catalog_face_names( face, names );
+        add_lazy_face( names[CATALOG_FAMILY_NAME], names[CATALOG_SECOND_NAME], face, face->flags );
+        if (face->fs.fsCsb[0] & FS_DBCS_MASK)
+        {
+            WCHAR vert_family[LF_FACESIZE], vert_second[LF_FACESIZE];
+
+            vert_family[0] = '@';
+            lstrcpynW( vert_family + 1, names[CATALOG_FAMILY_NAME], LF_FACESIZE - 1 );
+            vert_second[0] = 0;
+            if (names[CATALOG_SECOND_NAME] && names[CATALOG_SECOND_NAME][0])
+            {
+                vert_second[0] = '@';
+                lstrcpynW( vert_second + 1, names[CATALOG_SECOND_NAME], LF_FACESIZE - 1 );
+            }
+            add_lazy_face( vert_family, vert_second, face, face->flags | ADDFONT_VERTICAL_FONT );
+        }
+        if (face->scalable && names[CATALOG_FULL_NAME])
+        {
+            lazy_full_names[lazy_full_name_count].full_name = names[CATALOG_FULL_NAME];
+            lazy_full_names[lazy_full_name_count].family_name = names[CATALOG_FAMILY_NAME];
+            lazy_full_name_count++;
+        }
+        offset += (offsetof( struct font_catalog_face, names[face->names_len] ) + 3) & ~3;
+    }
+    qsort( lazy_full_names, lazy_full_name_count, sizeof(*lazy_full_names), lazy_full_name_compare );
+    TRACE( "loaded %u faces from the font catalog\n", header->face_count );
+    return TRUE;
+}
+
+static BOOL load_font_catalog( const struct font_dir *dirs, UINT dir_count, LCID lcid )
+{
+    FILE_STANDARD_INFORMATION info;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING nt_name;
+    IO_STATUS_BLOCK io;
+    HANDLE file;
+    WCHAR path[MAX_PATH];
+    char *data = NULL;
+    BOOL ret = FALSE;
+
+    get_font_catalog_path( path, ".dat" );
+    init_nt_name( &nt_name, &attr, path );
+    if (NtOpenFile( &file, GENERIC_READ | SYNCHRONIZE, &attr, &io, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                    FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT ))
+        return FALSE;
+
+    /* read the catalog instead of mapping it, a mapped file couldn't be replaced
+     * when the catalog is saved again */
+    if (!NtQueryInformationFile( file, &io, &info, sizeof(info), FileStandardInformation ) &&
+        info.EndOfFile.QuadPart >= sizeof(struct font_catalog_header) &&
+        info.EndOfFile.QuadPart <= MAXDWORD &&
+        (data = malloc( info.EndOfFile.QuadPart )) &&
+        !NtReadFile( file, 0, NULL, NULL, &io, data, info.EndOfFile.QuadPart, NULL, NULL ) &&
+        io.Information == info.EndOfFile.QuadPart)
+    {
+        /* the data is kept on success, the lazy faces point into it */
+        ret = load_font_catalog_data( data, info.EndOfFile.QuadPart, dirs, dir_count, lcid );
+    }
+    if (!ret) free( data );
+    NtClose( file );
+    return ret;
+}
+
+static void save_font_catalog( struct font_catalog *catalog )
+{
+    FILE_RENAME_INFORMATION *rename_info;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING nt_name;
+    IO_STATUS_BLOCK io;
+    HANDLE file;
+    WCHAR path[MAX_PATH];
+    char suffix[32];
+    NTSTATUS status;
+    DWORD len;
+
+    /* write to a temporary file first, so that other processes never see a partial catalog */
+    sprintf( suffix, ".%04x.tmp", GetCurrentProcessId() );
+    get_font_catalog_path( path, suffix );
+    init_nt_name( &nt_name, &attr, path );
+    if (NtCreateFile( &file, GENERIC_WRITE | DELETE | SYNCHRONIZE, &attr, &io, NULL, FILE_ATTRIBUTE_NORMAL,
+                      0, FILE_OVERWRITE_IF, FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT, NULL, 0 ))
+        return;
+
+    status = NtWriteFile( file, 0, NULL, NULL, &io, catalog->data, catalog->size, NULL, NULL );
+    if (!status && io.Information != catalog->size) status = STATUS_DISK_FULL;
+    if (!status)
+    {
+        get_font_catalog_path( path, ".dat" );
+        len = lstrlenW( path ) * sizeof(WCHAR);
+        if (!(rename_info = malloc( offsetof( FILE_RENAME_INFORMATION, FileName[len / sizeof(WCHAR)] ))))
+            status = STATUS_NO_MEMORY;
+        else
+        {
+            rename_info->ReplaceIfExists = TRUE;
+            rename_info->RootDirectory = 0;
+            rename_info->FileNameLength = len;
+            memcpy( rename_info->FileName, path, len );
+            status = NtSetInformationFile( file, &io, rename_info,
+                                           offsetof( FILE_RENAME_INFORMATION, FileName[len / sizeof(WCHAR)] ),
+                                           FileRenameInformation );
+            free( rename_info );
+        }
+    }
+    if (status)
+    {
+        FILE_DISPOSITION_INFORMATION disposition = { TRUE };
+
+        WARN( "failed to save the font catalog, status %#x\n", status );
+        NtSetInformationFile( file, &io, &disposition, sizeof(disposition), FileDispositionInformation );
+    }
+    NtClose( file );
+}
+
+static struct font_dir *get_font_dirs( UINT *count )
 {
     char value_buffer[FIELD_OFFSET(KEY_VALUE_PARTIAL_INFORMATION, Data[1024 * sizeof(WCHAR)])];
     KEY_VALUE_PARTIAL_INFORMATION *info = (void *)value_buffer;
-    WCHAR *ptr, *next, path[MAX_PATH];
+    struct font_dir *dirs, *new_dirs;
+    WCHAR *ptr, *next;
+    UINT i;
+
+    if (!(dirs = calloc( 2, sizeof(*dirs) ))) return NULL;
 
     /* Windows directory */
-    get_fonts_win_dir_path( NULL, path );
-    load_directory_fonts( path, 0 );
+    get_fonts_win_dir_path( NULL, dirs[0].path );
+    dirs[0].flags = 0;
 
     /* Wine data directory */
-    get_fonts_data_dir_path( NULL, path );
-    load_directory_fonts( path, ADDFONT_EXTERNAL_FONT );
+    get_fonts_data_dir_path( NULL, dirs[1].path );
+    dirs[1].flags = ADDFONT_EXTERNAL_FONT;
+    *count = 2;
 
     /* custom paths */
     /* @@ Wine registry key: HKCU\Software\Wine\Fonts */
@@ -6233,15 +6841,72 @@ static void load_file_system_fonts(void)
         {
             if ((next = wcschr( ptr, ';' ))) *next++ = 0;
             if (next && next - ptr < 2) continue;
-            lstrcpynW( path, ptr, MAX_PATH );
-            if (path[1] == ':')
+            if (!(new_dirs = realloc( dirs, (*count + 1) * sizeof(*dirs) ))) break;
+            dirs = new_dirs;
+            lstrcpynW( dirs[*count].path, ptr, MAX_PATH );
+            if (dirs[*count].path[1] == ':')
             {
-                memmove( path + ARRAYSIZE(nt_prefixW), path, (lstrlenW( path ) + 1) * sizeof(WCHAR) );
-                memcpy( path, nt_prefixW, sizeof(nt_prefixW) );
+                memmove( dirs[*count].path + ARRAYSIZE(nt_prefixW), dirs[*count].path,
+                         (lstrlenW( dirs[*count].path ) + 1) * sizeof(WCHAR) );
+                memcpy( dirs[*count].path, nt_prefixW, sizeof(nt_prefixW) );
             }
-            load_directory_fonts( path, ADDFONT_EXTERNAL_FONT );
+            dirs[*count].flags = ADDFONT_EXTERNAL_FONT;
+            (*count)++;
         }
     }
+
+    for (i = 0; i < *count; i++) get_font_dir_time( &dirs[i] );
+    return dirs;
+}
+
+static void load_file_system_fonts(void)
+{
+    struct font_catalog catalog = { 0 };
+    struct font_catalog_header *header;
+    struct font_catalog_dir *dir;
+    struct font_dir *dirs;
+    UINT i, count;
+    DWORD len;
+    LCID lcid;
+
+    if (!(dirs = get_font_dirs( &count ))) return;
+    NtQueryDefaultLocale( FALSE, &lcid );
+
+    if (load_font_catalog( dirs, count, lcid ))
+    {
+        free( dirs );
+        return;
+    }
+
+    if ((header = append_to_catalog( &catalog, sizeof(*header) )))
+    {
+        header->magic     = FONT_CATALOG_MAGIC;
+        header->version   = FONT_CATALOG_VERSION;
+        header->lcid      = lcid;
+        header->dir_count = count;
+    }
+    for (i = 0; i < count; i++)
+    {
+        len = lstrlenW( dirs[i].path ) + 1;
+        if (!(dir = append_to_catalog( &catalog, offsetof( struct font_catalog_dir, name[len] )))) break;
+        dir->time_low  = dirs[i].time.u.LowPart;
+        dir->time_high = dirs[i].time.u.HighPart;
+        dir->flags     = dirs[i].flags;
+        dir->name_len  = len;
+        memcpy( dir->name, dirs[i].path, len * sizeof(WCHAR) );
+    }
+
+    font_catalog = &catalog;
+    for (i = 0; i < count; i++) load_directory_fonts( dirs[i].path, dirs[i].flags );
+    font_catalog = NULL;
+
+    if (!catalog.failed)
+    {
+        ((struct font_catalog_header *)catalog.data)->size = catalog.size;
+        save_font_catalog( &catalog );
+    }
+    free( catalog.data );
+    free( dirs );
 }
 
 struct external_key
@@ -6300,6 +6965,7 @@ static void update_external_font_keys(void)
 
     WINE_RB_FOR_EACH_ENTRY( family, &family_name_tree, struct gdi_font_family, name_entry )
     {
+        load_lazy_faces( family );
         LIST_FOR_EACH_ENTRY( face, &family->faces, struct gdi_font_face, entry )
         {
             if (!(face->flags & ADDFONT_EXTERNAL_FONT)) continue;
@@ -1245,6 +1245,7 @@ NTSTATUS gdi_init(void)
     init_gdi_shared();
     if (!gdi_shared) return STATUS_NO_MEMORY;
 
+    init_dib_row_funcs();
     dpi = font_init();
     init_stock_objects( dpi );
     return 0;
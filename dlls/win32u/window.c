@@ -34,6 +34,8 @@ WINE_DEFAULT_DEBUG_CHANNEL(win);
 #define USER_HANDLE_TO_INDEX(hwnd) ((LOWORD(hwnd) - FIRST_USER_HANDLE) >> 1)
 
 static void *user_handles[NB_USER_HANDLES];
+static const volatile window_shm_t *window_shm;
+static BOOL window_shm_failed;
 
 #define SWP_AGG_NOGEOMETRYCHANGE \
     (SWP_NOSIZE | SWP_NOCLIENTSIZE | SWP_NOZORDER)
@@ -168,6 +170,82 @@ HWND get_hwnd_message_parent(void)
     return thread_info->msg_window;
 }
 
+/***********************************************************************
+ *           get_window_shm
+ *
+ * Map the snapshot of the window tree shared by the server.
+ */
+static const volatile window_shm_t *get_window_shm(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s','\\',
+                                  '_','_','w','i','n','e','_','w','i','n','d','o','w','_','s','h','m'};
+    UNICODE_STRING name = { sizeof(nameW), sizeof(nameW), (WCHAR *)nameW };
+    OBJECT_ATTRIBUTES attr;
+    SIZE_T size = 0;
+    HANDLE handle;
+    void *ptr = NULL;
+
+    if (window_shm || window_shm_failed) return window_shm;
+
+    InitializeObjectAttributes( &attr, &name, 0, NULL, NULL );
+    if (!NtOpenSection( &handle, SECTION_MAP_READ, &attr ))
+    {
+        NtMapViewOfSection( handle, GetCurrentProcess(), &ptr, 0, 0, NULL, &size, ViewShare, 0, PAGE_READONLY );
+        NtClose( handle );
+    }
+    if (!ptr || size < NB_USER_HANDLES * sizeof(window_shm_t))
+    {
+        WARN( "shared window snapshot not available\n" );
+        if (ptr) NtUnmapViewOfSection( GetCurrentProcess(), ptr );
+        window_shm_failed = TRUE;
+        return NULL;
+    }
+    if (InterlockedCompareExchangePointer( (void **)&window_shm, ptr, NULL ))
+        NtUnmapViewOfSection( GetCurrentProcess(), ptr );  /* somebody beat us to it */
+    return window_shm;
+}
+
+/***********************************************************************
+ *           get_shared_window_info
+ *
+ * Read the information of a window owned by another process without a server round-trip.
+ */
+static BOOL get_shared_window_info( HWND hwnd, window_shm_t *info )
+{
+    const volatile window_shm_t *entry;
+    unsigned int seq;
+
+    if (LOWORD(hwnd) < FIRST_USER_HANDLE || USER_HANDLE_TO_INDEX(hwnd) >= NB_USER_HANDLES) return FALSE;
+    if (!get_window_shm()) return FALSE;
+    entry = &window_shm[USER_HANDLE_TO_INDEX(hwnd)];
+
+    for (;;)
+    {
+        /* the server makes the sequence number odd while it updates the entry */
+        if ((seq = entry->seq) & 1)
+        {
+            YieldProcessor();
+            continue;
+        }
+        MemoryBarrier();
+        memcpy( info, (const void *)entry, sizeof(*info) );
+        MemoryBarrier();
+        if (entry->seq == seq) break;
+    }
+
+    if (!info->handle) return FALSE;
+    /* truncated handles match any generation, like on the server side */
+    if (HIWORD(hwnd) && HIWORD(hwnd) != 0xffff && wine_server_user_handle( hwnd ) != info->handle)
+        return FALSE;
+    return TRUE;
+}
+
+static inline RECT rect_from_shm( const rectangle_t *rect )
+{
+    RECT ret = { rect->left, rect->top, rect->right, rect->bottom };
+    return ret;
+}
+
 /***********************************************************************
  *           get_full_window_handle
  *
@@ -175,6 +253,7 @@ HWND get_hwnd_message_parent(void)
  */
 HWND get_full_window_handle( HWND hwnd )
 {
+    window_shm_t info;
     WND *win;
 
     if (!hwnd || (ULONG_PTR)hwnd >> 16) return hwnd;
@@ -195,6 +274,10 @@ HWND get_full_window_handle( HWND hwnd )
         hwnd = win->obj.handle;
         release_win_ptr( win );
     }
+    else if (get_shared_window_info( hwnd, &info ))
+    {
+        hwnd = wine_server_ptr_handle( info.handle );
+    }
     else  /* may belong to another process */
     {
         SERVER_START_REQ( get_window_info )
@@ -282,6 +365,7 @@ HWND is_current_process_window( HWND hwnd )
 /* see IsWindow */
 BOOL is_window( HWND hwnd )
 {
+    window_shm_t info;
     WND *win;
     BOOL ret;
 
@@ -293,6 +377,7 @@ BOOL is_window( HWND hwnd )
         release_win_ptr( win );
         return TRUE;
     }
+    if (get_shared_window_info( hwnd, &info )) return TRUE;
 
     /* check other processes */
     SERVER_START_REQ( get_window_info )
@@ -307,6 +392,7 @@ BOOL is_window( HWND hwnd )
 /* see GetWindowThreadProcessId */
 DWORD get_window_thread( HWND hwnd, DWORD *process )
 {
+    window_shm_t info;
     WND *ptr;
     DWORD tid = 0;
 
@@ -325,6 +411,12 @@ DWORD get_window_thread( HWND hwnd, DWORD *process )
         return tid;
     }
 
+    if (get_shared_window_info( hwnd, &info ))
+    {
+        if (process) *process = info.pid;
+        return info.tid;
+    }
+
     /* check other processes */
     SERVER_START_REQ( get_window_info )
     {
@@ -342,6 +434,7 @@ DWORD get_window_thread( HWND hwnd, DWORD *process )
 /* see GetParent */
 HWND get_parent( HWND hwnd )
 {
+    window_shm_t info;
     HWND retval = 0;
     WND *win;
 
@@ -351,7 +444,12 @@ HWND get_parent( HWND hwnd )
         return 0;
     }
     if (win == WND_DESKTOP) return 0;
-    if (win == WND_OTHER_PROCESS)
+    if (win == WND_OTHER_PROCESS && get_shared_window_info( hwnd, &info ))
+    {
+        if (info.style & WS_POPUP) retval = wine_server_ptr_handle( info.owner );
+        else if (info.style & WS_CHILD) retval = wine_server_ptr_handle( info.parent );
+    }
+    else if (win == WND_OTHER_PROCESS)
     {
         LONG style = get_window_long( hwnd, GWL_STYLE );
         if (style & (WS_POPUP | WS_CHILD))
@@ -482,6 +580,8 @@ HWND get_window_relative( HWND hwnd, UINT rel )
     if (rel == GW_OWNER)  /* this one may be available locally */
     {
         WND *win = get_win_ptr( hwnd );
+        window_shm_t info;
+
         if (!win)
         {
             SetLastError( ERROR_INVALID_HANDLE );
@@ -494,6 +594,7 @@ HWND get_window_relative( HWND hwnd, UINT rel )
             release_win_ptr( win );
             return retval;
         }
+        if (get_shared_window_info( hwnd, &info )) return wine_server_ptr_handle( info.owner );
         /* else fall through to server call */
     }
 
@@ -651,6 +752,7 @@ HWND *list_window_children( HDESK desktop, HWND hwnd, UNICODE_STRING *class, DWO
 HWND WINAPI NtUserGetAncestor( HWND hwnd, UINT type )
 {
     HWND *list, ret = 0;
+    window_shm_t info;
     WND *win;
 
     switch(type)
@@ -667,6 +769,10 @@ HWND WINAPI NtUserGetAncestor( HWND hwnd, UINT type )
             ret = win->parent;
             release_win_ptr( win );
         }
+        else if (get_shared_window_info( hwnd, &info ))
+        {
+            ret = wine_server_ptr_handle( info.parent );
+        }
         else /* need to query the server */
         {
             SERVER_START_REQ( get_window_tree )
@@ -1005,11 +1111,16 @@ static LONG_PTR get_window_long_size( HWND hwnd, INT offset, UINT size, BOOL ans
 
     if (win == WND_OTHER_PROCESS)
     {
+        window_shm_t info;
+
         if (offset == GWLP_WNDPROC)
         {
             SetLastError( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if ((offset == GWL_STYLE || offset == GWL_EXSTYLE) && get_shared_window_info( hwnd, &info ))
+            return offset == GWL_STYLE ? info.style : info.ex_style;
+
         SERVER_START_REQ( set_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
@@ -1557,6 +1668,71 @@ static void mirror_rect( const RECT *window_rect, RECT *rect )
     rect->right = width - tmp;
 }
 
+/***********************************************************************
+ *           get_shared_window_rects
+ *
+ * Get the rectangles of a window owned by another process from the shared snapshot.
+ */
+static BOOL get_shared_window_rects( HWND hwnd, enum coords_relative relative, RECT *window_rect,
+                                     RECT *client_rect, UINT dpi )
+{
+    window_shm_t info, parent;
+    RECT window, client;
+    user_handle_t handle;
+
+    if (!get_shared_window_info( hwnd, &info )) return FALSE;
+    if (info.dpi != dpi) return FALSE;  /* let the server do the DPI mapping */
+
+    window = rect_from_shm( &info.window_rect );
+    client = rect_from_shm( &info.client_rect );
+
+    switch (relative)
+    {
+    case COORDS_CLIENT:
+        OffsetRect( &window, -info.client_rect.left, -info.client_rect.top );
+        OffsetRect( &client, -info.client_rect.left, -info.client_rect.top );
+        if (info.ex_style & WS_EX_LAYOUTRTL)
+        {
+            RECT rect = rect_from_shm( &info.client_rect );
+            mirror_rect( &rect, &window );
+        }
+        break;
+    case COORDS_WINDOW:
+        OffsetRect( &window, -info.window_rect.left, -info.window_rect.top );
+        OffsetRect( &client, -info.window_rect.left, -info.window_rect.top );
+        if (info.ex_style & WS_EX_LAYOUTRTL)
+        {
+            RECT rect = rect_from_shm( &info.window_rect );
+            mirror_rect( &rect, &client );
+        }
+        break;
+    case COORDS_PARENT:
+        if (!info.parent) break;
+        if (!get_shared_window_info( wine_server_ptr_handle( info.parent ), &parent )) return FALSE;
+        if (parent.ex_style & WS_EX_LAYOUTRTL)
+        {
+            RECT rect = rect_from_shm( &parent.client_rect );
+            mirror_rect( &rect, &window );
+            mirror_rect( &rect, &client );
+        }
+        break;
+    case COORDS_SCREEN:
+        for (handle = info.parent; handle; handle = parent.parent)
+        {
+            if (!get_shared_window_info( wine_server_ptr_handle( handle ), &parent )) return FALSE;
+            if (!parent.parent) break;  /* desktop window */
+            OffsetRect( &window, parent.client_rect.left, parent.client_rect.top );
+            OffsetRect( &client, parent.client_rect.left, parent.client_rect.top );
+        }
+        break;
+    default:
+        return FALSE;
+    }
+    if (window_rect) *window_rect = window;
+    if (client_rect) *client_rect = client;
+    return TRUE;
+}
+
 /***********************************************************************
  *           get_window_rects
  *
@@ -1667,6 +1843,8 @@ BOOL get_window_rects( HWND hwnd, enum coords_relative relative, RECT *window_re
     }
 
 other_process:
+    if (get_shared_window_rects( hwnd, relative, window_rect, client_rect, dpi )) return TRUE;
+
     SERVER_START_REQ( get_window_rectangles )
     {
         req->handle = wine_server_user_handle( hwnd );
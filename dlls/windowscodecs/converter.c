@@ -132,6 +132,141 @@ static void to_sRGB(BYTE *bgr)
 }
 #endif
 
+/* smallest linear value that rounds up to each sRGB byte value, so that
+ * converting a float only takes a binary search instead of a powf() */
+static float sRGB_thresholds[256];
+
+static BOOL WINAPI init_sRGB_thresholds(INIT_ONCE *once, void *param, void **context)
+{
+    UINT v;
+
+    for (v = 1; v < 256; v++)
+    {
+        union { float f; UINT i; } lo, hi, mid;
+
+        lo.f = 0.0f;
+        hi.f = 1.0f;
+        /* positive floats sort like their bit patterns */
+        while (lo.i < hi.i)
+        {
+            mid.i = lo.i + (hi.i - lo.i) / 2;
+            if (floorf(to_sRGB_component(mid.f) * 255.0f + 0.51f) >= v)
+                hi.i = mid.i;
+            else
+                lo.i = mid.i + 1;
+        }
+        sRGB_thresholds[v] = lo.f;
+    }
+    return TRUE;
+}
+
+/* same result as floorf(to_sRGB_component(f) * 255.0f + 0.51f), clamped to [0,255] */
+static inline BYTE float_to_sRGB_byte(float f)
+{
+    UINT i = 0;
+
+    if (f >= sRGB_thresholds[i + 128]) i += 128;
+    if (f >= sRGB_thresholds[i + 64]) i += 64;
+    if (f >= sRGB_thresholds[i + 32]) i += 32;
+    if (f >= sRGB_thresholds[i + 16]) i += 16;
+    if (f >= sRGB_thresholds[i + 8]) i += 8;
+    if (f >= sRGB_thresholds[i + 4]) i += 4;
+    if (f >= sRGB_thresholds[i + 2]) i += 2;
+    if (f >= sRGB_thresholds[i + 1]) i += 1;
+    return i;
+}
+
+static void init_sRGB_table(void)
+{
+    static INIT_ONCE init_once = INIT_ONCE_STATIC_INIT;
+    InitOnceExecuteOnce(&init_once, init_sRGB_thresholds, NULL, NULL);
+}
+
+static void set_alpha_opaque(BYTE *bits, UINT width, UINT height, UINT stride)
+{
+    UINT x, y;
+
+    for (y = 0; y < height; y++)
+    {
+        DWORD *pixel = (DWORD *)(bits + stride * y);
+        for (x = 0; x < width; x++)
+            pixel[x] |= 0xff000000;
+    }
+}
+
+/* (c * a + 127) / 255 without the division */
+void premultiply_alpha(BYTE *bits, UINT width, UINT height, UINT stride)
+{
+    UINT x, y, t;
+
+    for (y = 0; y < height; y++)
+    {
+        BYTE *pixel = bits + stride * y;
+        for (x = 0; x < width; x++, pixel += 4)
+        {
+            BYTE alpha = pixel[3];
+            t = pixel[0] * alpha + 127; pixel[0] = (t + (t >> 8) + 1) >> 8;
+            t = pixel[1] * alpha + 127; pixel[1] = (t + (t >> 8) + 1) >> 8;
+            t = pixel[2] * alpha + 127; pixel[2] = (t + (t >> 8) + 1) >> 8;
+        }
+    }
+}
+
+/* c * 255 / a using a fixed point reciprocal, exact for all 8-bit c and a */
+void unpremultiply_alpha(BYTE *bits, UINT width, UINT height, UINT stride)
+{
+    UINT recip[256];
+    UINT x, y;
+
+    recip[0] = 1 << 16;
+    for (x = 1; x < 256; x++)
+        recip[x] = (255 << 16) / x + 1;
+
+    for (y = 0; y < height; y++)
+    {
+        BYTE *pixel = bits + stride * y;
+        for (x = 0; x < width; x++, pixel += 4)
+        {
+            UINT r = recip[pixel[3]];
+            pixel[0] = (pixel[0] * r) >> 16;
+            pixel[1] = (pixel[1] * r) >> 16;
+            pixel[2] = (pixel[2] * r) >> 16;
+        }
+    }
+}
+
+/* keep the high byte of each 16-bit channel, one whole pixel at a time */
+static void convert_rgb48_to_bgra8(const BYTE *src, UINT srcstride, BYTE *dst, UINT dststride,
+                                   UINT width, UINT height)
+{
+    UINT x, y;
+
+    for (y = 0; y < height; y++)
+    {
+        const WORD *srcpixel = (const WORD *)(src + srcstride * y);
+        DWORD *dstpixel = (DWORD *)(dst + dststride * y);
+
+        for (x = 0; x < width; x++, srcpixel += 3)
+            dstpixel[x] = 0xff000000 | (srcpixel[0] >> 8) << 16 | (srcpixel[1] & 0xff00) | srcpixel[2] >> 8;
+    }
+}
+
+static void convert_rgba64_to_bgra8(const BYTE *src, UINT srcstride, BYTE *dst, UINT dststride,
+                                    UINT width, UINT height)
+{
+    UINT x, y;
+
+    for (y = 0; y < height; y++)
+    {
+        const WORD *srcpixel = (const WORD *)(src + srcstride * y);
+        DWORD *dstpixel = (DWORD *)(dst + dststride * y);
+
+        for (x = 0; x < width; x++, srcpixel += 4)
+            dstpixel[x] = (DWORD)(srcpixel[3] >> 8) << 24 | (srcpixel[0] >> 8) << 16 |
+                          (srcpixel[1] & 0xff00) | srcpixel[2] >> 8;
+    }
+}
+
 static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter *iface)
 {
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
@@ -710,15 +845,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
-            /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+            set_alpha_opaque(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
     case format_32bppRGBA:
@@ -738,35 +869,19 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+            unpremultiply_alpha(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
     case format_48bppRGB:
         if (prc)
         {
             HRESULT res;
-            INT x, y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
 
             srcstride = 6 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -777,23 +892,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        BYTE red, green, blue;
-                        srcpixel++; red = *srcpixel++;
-                        srcpixel++; green = *srcpixel++;
-                        srcpixel++; blue = *srcpixel++;
-                        *dstpixel++=0xff000000|red<<16|green<<8|blue;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                convert_rgb48_to_bgra8(srcdata, srcstride, pbBuffer, cbStride, prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
@@ -804,13 +903,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
 
             srcstride = 8 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -821,24 +915,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
 
             if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        BYTE red, green, blue, alpha;
-                        srcpixel++; red = *srcpixel++;
-                        srcpixel++; green = *srcpixel++;
-                        srcpixel++; blue = *srcpixel++;
-                        srcpixel++; alpha = *srcpixel++;
-                        *dstpixel++=alpha<<24|red<<16|green<<8|blue;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+                convert_rgba64_to_bgra8(srcdata, srcstride, pbBuffer, cbStride, prc->Width, prc->Height);
 
             HeapFree(GetProcessHeap(), 0, srcdata);
 
@@ -882,15 +959,10 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppRGB:
         if (prc)
         {
-            INT x, y;
-
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
-            /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+            set_alpha_opaque(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
 
@@ -902,22 +974,10 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppPRGBA:
         if (prc)
         {
-            INT x, y;
-
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+            unpremultiply_alpha(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
 
@@ -975,21 +1035,7 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
     default:
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = (pbBuffer[cbStride*y+4*x] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+1] = (pbBuffer[cbStride*y+4*x+1] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+2] = (pbBuffer[cbStride*y+4*x+2] * alpha + 127) / 255;
-                    }
-                }
-        }
+            premultiply_alpha(pbBuffer, prc->Width, prc->Height, cbStride);
         return hr;
     }
 }
@@ -1008,21 +1054,7 @@ static HRESULT copypixels_to_32bppPRGBA(struct FormatConverter *This, const WICR
     default:
         hr = copypixels_to_32bppRGBA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = (pbBuffer[cbStride*y+4*x] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+1] = (pbBuffer[cbStride*y+4*x+1] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+2] = (pbBuffer[cbStride*y+4*x+2] * alpha + 127) / 255;
-                    }
-                }
-        }
+            premultiply_alpha(pbBuffer, prc->Width, prc->Height, cbStride);
         return hr;
     }
 }
@@ -1131,6 +1163,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                init_sRGB_table();
                 for (y = 0; y < prc->Height; y++)
                 {
                     float *gray_float = (float *)src;
@@ -1138,7 +1171,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
 
                     for (x = 0; x < prc->Width; x++)
                     {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
+                        BYTE gray = float_to_sRGB_byte(gray_float[x]);
                         *bgr++ = gray;
                         *bgr++ = gray;
                         *bgr++ = gray;
@@ -1351,13 +1384,14 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
                 INT x, y;
                 BYTE *src = srcdata, *dst = pbBuffer;
 
+                init_sRGB_table();
                 for (y=0; y < prc->Height; y++)
                 {
                     float *srcpixel = (float*)src;
                     BYTE *dstpixel = dst;
 
                     for (x=0; x < prc->Width; x++)
-                        *dstpixel++ = (BYTE)floorf(to_sRGB_component(*srcpixel++) * 255.0f + 0.51f);
+                        *dstpixel++ = float_to_sRGB_byte(*srcpixel++);
 
                     src += srcstride;
                     dst += cbStride;
@@ -1385,6 +1419,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
         INT x, y;
         BYTE *src = srcdata, *dst = pbBuffer;
 
+        init_sRGB_table();
         for (y = 0; y < prc->Height; y++)
         {
             BYTE *bgr = src;
@@ -1393,8 +1428,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
             {
                 float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
 
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
+                dst[x] = float_to_sRGB_byte(gray);
                 bgr += 3;
             }
             src += srcstride;
@@ -80,6 +80,8 @@ struct jpeg_decoder {
     BYTE source_buffer[1024];
     UINT stride;
     BYTE *image_data;
+    ULONGLONG stream_pos;   /* where decoding resumes in the stream */
+    HRESULT decode_hr;      /* sticky error of the scanline decoding */
 };
 
 static inline struct jpeg_decoder *impl_from_decoder(struct decoder* iface)
@@ -150,7 +152,8 @@ static HRESULT CDECL jpeg_decoder_initialize(struct decoder* iface, IStream *str
     struct jpeg_decoder *This = impl_from_decoder(iface);
     int ret;
     jmp_buf jmpbuf;
-    UINT data_size, i;
+    UINT data_size;
+    HRESULT hr;
 
     if (This->cinfo_initialized)
         return WINCODEC_ERR_WRONGSTATE;
@@ -252,7 +255,50 @@ static HRESULT CDECL jpeg_decoder_initialize(struct decoder* iface, IStream *str
     if (!This->image_data)
         return E_OUTOFMEMORY;
 
-    while (This->cinfo.output_scanline < This->cinfo.output_height)
+    /* The scanlines are decoded on demand by copy_pixels(), so that callers
+     * reading the image from the top get the first rows without waiting for
+     * the whole frame. Remember where libjpeg stopped reading, since the
+     * stream is shared with the metadata readers. */
+    hr = stream_seek(This->stream, 0, STREAM_SEEK_CUR, &This->stream_pos);
+    if (FAILED(hr))
+        return hr;
+    This->decode_hr = S_OK;
+
+    st->frame_count = 1;
+    st->flags = WICBitmapDecoderCapabilityCanDecodeAllImages |
+                WICBitmapDecoderCapabilityCanDecodeSomeImages |
+                WICBitmapDecoderCapabilityCanEnumerateMetadata |
+                DECODER_FLAGS_UNSUPPORTED_COLOR_CONTEXT;
+    return S_OK;
+}
+
+static HRESULT CDECL jpeg_decoder_get_frame_info(struct decoder* iface, UINT frame, struct decoder_frame *info)
+{
+    struct jpeg_decoder *This = impl_from_decoder(iface);
+    *info = This->frame;
+    return S_OK;
+}
+
+static HRESULT jpeg_decoder_read_scanlines(struct jpeg_decoder *This, UINT lines)
+{
+    jmp_buf jmpbuf;
+    UINT first_line = This->cinfo.output_scanline, i;
+    HRESULT hr;
+
+    if (FAILED(This->decode_hr) || first_line >= lines)
+        return This->decode_hr;
+
+    This->cinfo.client_data = jmpbuf;
+
+    if (setjmp(jmpbuf))
+        return This->decode_hr = E_FAIL;
+
+    /* nothing has been decoded yet, so a later call can try again */
+    hr = stream_seek(This->stream, This->stream_pos, STREAM_SEEK_SET, NULL);
+    if (FAILED(hr))
+        return hr;
+
+    while (This->cinfo.output_scanline < lines)
     {
         UINT first_scanline = This->cinfo.output_scanline;
         UINT max_rows;
@@ -267,37 +313,33 @@ static HRESULT CDECL jpeg_decoder_initialize(struct decoder* iface, IStream *str
         if (ret == 0)
         {
             ERR("read_scanlines failed\n");
-            return E_FAIL;
+            return This->decode_hr = E_FAIL;
         }
     }
 
+    /* the rows are fine, but later calls can't resume decoding */
+    hr = stream_seek(This->stream, 0, STREAM_SEEK_CUR, &This->stream_pos);
+    if (FAILED(hr))
+        This->decode_hr = hr;
+
+    lines = This->cinfo.output_scanline - first_line;
+
     if (This->frame.bpp == 24)
     {
         /* libjpeg gives us RGB data and we want BGR, so byteswap the data */
-        reverse_bgr8(3, This->image_data,
-            This->cinfo.output_width, This->cinfo.output_height,
-            This->stride);
+        reverse_bgr8(3, This->image_data + This->stride * first_line,
+            This->cinfo.output_width, lines, This->stride);
     }
 
     if (This->cinfo.out_color_space == JCS_CMYK && This->cinfo.saw_Adobe_marker)
     {
+        BYTE *data = This->image_data + This->stride * first_line;
+
         /* Adobe JPEG's have inverted CMYK data. */
-        for (i=0; i<data_size; i++)
-            This->image_data[i] ^= 0xff;
+        for (i=0; i<This->stride * lines; i++)
+            data[i] ^= 0xff;
     }
 
-    st->frame_count = 1;
-    st->flags = WICBitmapDecoderCapabilityCanDecodeAllImages |
-                WICBitmapDecoderCapabilityCanDecodeSomeImages |
-                WICBitmapDecoderCapabilityCanEnumerateMetadata |
-                DECODER_FLAGS_UNSUPPORTED_COLOR_CONTEXT;
-    return S_OK;
-}
-
-static HRESULT CDECL jpeg_decoder_get_frame_info(struct decoder* iface, UINT frame, struct decoder_frame *info)
-{
-    struct jpeg_decoder *This = impl_from_decoder(iface);
-    *info = This->frame;
     return S_OK;
 }
 
@@ -305,6 +347,15 @@ static HRESULT CDECL jpeg_decoder_copy_pixels(struct decoder* iface, UINT frame,
     const WICRect *prc, UINT stride, UINT buffersize, BYTE *buffer)
 {
     struct jpeg_decoder *This = impl_from_decoder(iface);
+    UINT lines = This->frame.height;
+    HRESULT hr;
+
+    if (prc && prc->Y >= 0 && prc->Height >= 0 && prc->Y + prc->Height < lines)
+        lines = prc->Y + prc->Height;
+
+    hr = jpeg_decoder_read_scanlines(This, lines);
+    if (FAILED(hr)) return hr;
+
     return copy_pixels(This->frame.bpp, This->image_data,
         This->frame.width, This->frame.height, This->stride,
         prc, stride, buffersize, buffer);
@@ -44,6 +44,10 @@ struct png_decoder
     BYTE *image_bits;
     BYTE *color_profile;
     DWORD color_profile_len;
+    png_structp png_ptr;    /* kept until all rows have been decoded */
+    png_infop info_ptr;
+    UINT decoded_rows;
+    ULONGLONG stream_pos;   /* where decoding resumes in the stream */
 };
 
 static inline struct png_decoder *impl_from_decoder(struct decoder* iface)
@@ -305,20 +309,39 @@ static HRESULT CDECL png_decoder_initialize(struct decoder *iface, IStream *stre
         goto end;
     }
 
-    row_pointers = malloc(sizeof(png_bytep)*This->decoder_frame.height);
-    if (!row_pointers)
+    if (png_get_interlace_type(png_ptr, info_ptr) == PNG_INTERLACE_NONE)
     {
-        hr = E_OUTOFMEMORY;
-        goto end;
+        /* Rows of non-interlaced images are decoded on demand by copy_pixels(),
+         * so that callers reading the image from the top get the first rows
+         * without waiting for the whole frame. */
+        png_start_read_image(png_ptr);
+        hr = stream_seek(stream, 0, STREAM_SEEK_CUR, &This->stream_pos);
+        if (FAILED(hr))
+            goto end;
+        This->png_ptr = png_ptr;
+        This->info_ptr = info_ptr;
+        This->decoded_rows = 0;
+        png_ptr = NULL;
+        info_ptr = NULL;
     }
+    else
+    {
+        row_pointers = malloc(sizeof(png_bytep)*This->decoder_frame.height);
+        if (!row_pointers)
+        {
+            hr = E_OUTOFMEMORY;
+            goto end;
+        }
 
-    for (i=0; i<This->decoder_frame.height; i++)
-        row_pointers[i] = This->image_bits + i * This->stride;
+        for (i=0; i<This->decoder_frame.height; i++)
+            row_pointers[i] = This->image_bits + i * This->stride;
 
-    png_read_image(png_ptr, row_pointers);
+        png_read_image(png_ptr, row_pointers);
 
-    free(row_pointers);
-    row_pointers = NULL;
+        free(row_pointers);
+        row_pointers = NULL;
+        This->decoded_rows = This->decoder_frame.height;
+    }
 
     /* png_read_end intentionally not called to not seek to the end of the file */
 
@@ -351,10 +374,61 @@ static HRESULT CDECL png_decoder_get_frame_info(struct decoder *iface, UINT fram
     return S_OK;
 }
 
+static void png_decoder_end_read(struct png_decoder *This)
+{
+    png_destroy_read_struct(&This->png_ptr, &This->info_ptr, NULL);
+    This->png_ptr = NULL;
+    This->info_ptr = NULL;
+}
+
+static HRESULT png_decoder_read_rows(struct png_decoder *This, UINT rows)
+{
+    HRESULT hr;
+
+    if (This->decoded_rows >= rows)
+        return S_OK;
+
+    /* an earlier error ended the read */
+    if (!This->png_ptr)
+        return E_FAIL;
+
+    if (setjmp(png_jmpbuf(This->png_ptr)))
+    {
+        png_decoder_end_read(This);
+        return E_FAIL;
+    }
+
+    /* nothing has been decoded yet, so a later call can try again */
+    hr = stream_seek(This->stream, This->stream_pos, STREAM_SEEK_SET, NULL);
+    if (FAILED(hr))
+        return hr;
+
+    while (This->decoded_rows < rows)
+    {
+        png_read_row(This->png_ptr, This->image_bits + This->decoded_rows * This->stride, NULL);
+        This->decoded_rows++;
+    }
+
+    /* without the position the read can't be resumed */
+    hr = stream_seek(This->stream, 0, STREAM_SEEK_CUR, &This->stream_pos);
+    if (FAILED(hr) || This->decoded_rows == This->decoder_frame.height)
+        png_decoder_end_read(This);
+
+    return S_OK;
+}
+
 static HRESULT CDECL png_decoder_copy_pixels(struct decoder *iface, UINT frame,
     const WICRect *prc, UINT stride, UINT buffersize, BYTE *buffer)
 {
     struct png_decoder *This = impl_from_decoder(iface);
+    UINT rows = This->decoder_frame.height;
+    HRESULT hr;
+
+    if (prc && prc->Y >= 0 && prc->Height >= 0 && prc->Y + prc->Height < rows)
+        rows = prc->Y + prc->Height;
+
+    hr = png_decoder_read_rows(This, rows);
+    if (FAILED(hr)) return hr;
 
     return copy_pixels(This->decoder_frame.bpp, This->image_bits,
         This->decoder_frame.width, This->decoder_frame.height, This->stride,
@@ -454,6 +528,7 @@ static void CDECL png_decoder_destroy(struct decoder* iface)
 {
     struct png_decoder *This = impl_from_decoder(iface);
 
+    png_decoder_end_read(This);
     free(This->image_bits);
     free(This->color_profile);
     RtlFreeHeap(GetProcessHeap(), 0, This);
@@ -482,6 +557,8 @@ HRESULT CDECL png_decoder_create(struct decoder_info *info, struct decoder **res
     This->decoder.vtable = &png_decoder_vtable;
     This->image_bits = NULL;
     This->color_profile = NULL;
+    This->png_ptr = NULL;
+    This->info_ptr = NULL;
     *result = &This->decoder;
 
     info->container_format = GUID_ContainerFormatPng;
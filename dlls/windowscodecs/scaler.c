@@ -18,6 +18,7 @@
  */
 
 #include <stdarg.h>
+#include <math.h>
 
 #define COBJMACROS
 
@@ -31,6 +32,15 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(wincodecs);
 
+/* filter weights are 2.14 fixed point and sum up to 1 << FILTER_BITS */
+#define FILTER_BITS 14
+
+struct scaler_filter {
+    UINT taps;          /* number of source pixels per destination pixel */
+    UINT *start;        /* first source pixel of each destination pixel */
+    short *weights;     /* taps weights for each destination pixel */
+};
+
 typedef struct BitmapScaler {
     IWICBitmapScaler IWICBitmapScaler_iface;
     LONG ref;
@@ -42,6 +52,9 @@ typedef struct BitmapScaler {
     UINT bpp;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    struct scaler_filter filter_x, filter_y;
+    int *line_buffer;
+    BOOL premultiply;   /* straight alpha is filtered premultiplied */
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
@@ -55,6 +68,14 @@ static inline BitmapScaler *impl_from_IMILBitmapScaler(IMILBitmapScaler *iface)
     return CONTAINING_RECORD(iface, BitmapScaler, IMILBitmapScaler_iface);
 }
 
+static void free_filter(struct scaler_filter *filter)
+{
+    HeapFree(GetProcessHeap(), 0, filter->start);
+    HeapFree(GetProcessHeap(), 0, filter->weights);
+    filter->start = NULL;
+    filter->weights = NULL;
+}
+
 static HRESULT WINAPI BitmapScaler_QueryInterface(IWICBitmapScaler *iface, REFIID iid,
     void **ppv)
 {
@@ -106,6 +127,9 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        free_filter(&This->filter_x);
+        free_filter(&This->filter_y);
+        HeapFree(GetProcessHeap(), 0, This->line_buffer);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -192,17 +216,252 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
 {
     UINT i;
     UINT bytesperpixel = This->bpp/8;
-    UINT src_x, src_y;
+    UINT src_x, src_y, pos, frac;
+    const BYTE *src_row;
 
     src_y = dst_y * This->src_height / This->height - src_data_y;
+    src_row = src_data[src_y];
 
+    /* step through (dst_x + i) * src_width / width without dividing */
+    pos = dst_x * This->src_width / This->width;
+    frac = dst_x * This->src_width % This->width;
     for (i=0; i<dst_width; i++)
     {
-        src_x = (dst_x + i) * This->src_width / This->width - src_data_x;
-        memcpy(pbBuffer + bytesperpixel * i, src_data[src_y] + bytesperpixel * src_x, bytesperpixel);
+        src_x = pos - src_data_x;
+        switch (bytesperpixel)
+        {
+        case 4:
+            ((DWORD *)pbBuffer)[i] = *(const DWORD *)(src_row + 4 * src_x);
+            break;
+        case 1:
+            pbBuffer[i] = src_row[src_x];
+            break;
+        default:
+            memcpy(pbBuffer + bytesperpixel * i, src_row + bytesperpixel * src_x, bytesperpixel);
+            break;
+        }
+        frac += This->src_width;
+        while (frac >= This->width)
+        {
+            frac -= This->width;
+            pos++;
+        }
+    }
+}
+
+static double filter_triangle(double x)
+{
+    x = fabs(x);
+    return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+/* Catmull-Rom spline, the a = -0.5 member of the Keys cubic family */
+static double filter_cubic(double x)
+{
+    x = fabs(x);
+    if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+/* Precompute which source pixels contribute to each destination pixel, and
+ * how much. Linear and Cubic sample the kernel at the source resolution, so
+ * they only look at the neighbouring pixels even when shrinking; Fant
+ * averages the area covered by the destination pixel and HighQualityCubic
+ * widens the cubic kernel to the scale factor. */
+static HRESULT init_filter(struct scaler_filter *filter, UINT dst_size, UINT src_size,
+    WICBitmapInterpolationMode mode)
+{
+    double scale = (double)src_size / dst_size, support, radius;
+    double *weights, sum;
+    UINT i, taps, max_tap;
+    int j, first, last, k;
+
+    switch (mode)
+    {
+    case WICBitmapInterpolationModeLinear:
+        support = 1.0;
+        radius = 1.0;
+        break;
+    case WICBitmapInterpolationModeCubic:
+        support = 1.0;
+        radius = 2.0;
+        break;
+    case WICBitmapInterpolationModeHighQualityCubic:
+        support = max(scale, 1.0);
+        radius = 2.0 * support;
+        break;
+    case WICBitmapInterpolationModeFant:
+    default:
+        support = scale;
+        radius = scale / 2.0 + 1.0;
+        break;
+    }
+
+    taps = (UINT)ceil(2.0 * radius) + 1;
+    if (taps > src_size) taps = src_size;
+
+    filter->taps = taps;
+    filter->start = HeapAlloc(GetProcessHeap(), 0, dst_size * sizeof(*filter->start));
+    filter->weights = HeapAlloc(GetProcessHeap(), 0, dst_size * taps * sizeof(*filter->weights));
+    weights = HeapAlloc(GetProcessHeap(), 0, taps * sizeof(*weights));
+    if (!filter->start || !filter->weights || !weights)
+    {
+        HeapFree(GetProcessHeap(), 0, weights);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < dst_size; i++)
+    {
+        double center = (i + 0.5) * scale;
+        short *fixed = filter->weights + i * taps;
+        int total = 0;
+
+        first = (int)floor(center - radius);
+        last = (int)ceil(center + radius);
+        k = min(max(first, 0), (int)(src_size - taps));
+        filter->start[i] = k;
+
+        memset(weights, 0, taps * sizeof(weights[0]));
+        for (j = first; j <= last; j++)
+        {
+            double w;
+
+            if (mode == WICBitmapInterpolationModeFant)
+            {
+                /* overlap of source pixel j with the destination pixel */
+                w = min(j + 1.0, center + support / 2.0) - max((double)j, center - support / 2.0);
+                if (w <= 0.0) continue;
+            }
+            else
+            {
+                w = (mode == WICBitmapInterpolationModeLinear) ? filter_triangle((j + 0.5 - center) / support)
+                                                               : filter_cubic((j + 0.5 - center) / support);
+                if (w == 0.0) continue;
+            }
+
+            /* pixels outside of the image repeat the edge */
+            weights[min(max(j, 0), (int)src_size - 1) - k] += w;
+        }
+
+        sum = 0.0;
+        for (j = 0; j < taps; j++) sum += weights[j];
+
+        max_tap = 0;
+        for (j = 0; j < taps; j++)
+        {
+            fixed[j] = (short)floor(weights[j] / sum * (1 << FILTER_BITS) + 0.5);
+            total += fixed[j];
+            if (fixed[j] > fixed[max_tap]) max_tap = j;
+        }
+        /* make sure that flat areas stay flat */
+        fixed[max_tap] += (1 << FILTER_BITS) - total;
+    }
+
+    HeapFree(GetProcessHeap(), 0, weights);
+    return S_OK;
+}
+
+
+static void Filter_GetRequiredSourceRect(BitmapScaler *This,
+    UINT x, UINT y, WICRect *src_rect)
+{
+    src_rect->X = This->filter_x.start[x];
+    src_rect->Y = This->filter_y.start[y];
+    src_rect->Width = This->filter_x.taps;
+    src_rect->Height = This->filter_y.taps;
+}
+
+static inline BYTE clamp_filtered(int value)
+{
+    value = (value + (1 << (2 * FILTER_BITS - 9))) >> (2 * FILTER_BITS - 8);
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+/* Vertical pass over all the needed source columns into line_buffer, then a
+ * horizontal pass into the destination. The loops work on whole rows of
+ * bytes with no per-pixel branches, so the compiler can vectorize them. */
+static void Filter_CopyScanline(BitmapScaler *This,
+    UINT dst_x, UINT dst_y, UINT dst_width,
+    BYTE **src_data, UINT src_data_x, UINT src_data_y, BYTE *pbBuffer)
+{
+    UINT bytesperpixel = This->bpp/8;
+    const struct scaler_filter *fx = &This->filter_x, *fy = &This->filter_y;
+    const short *weights = fy->weights + dst_y * fy->taps;
+    UINT first_x = fx->start[dst_x];
+    UINT count = (fx->start[dst_x + dst_width - 1] + fx->taps - first_x) * bytesperpixel;
+    int *line = This->line_buffer;
+    UINT i, t, c;
+
+    memset(line, 0, count * sizeof(*line));
+    for (t = 0; t < fy->taps; t++)
+    {
+        const BYTE *src = src_data[fy->start[dst_y] + t - src_data_y] + (first_x - src_data_x) * bytesperpixel;
+        int w = weights[t];
+
+        if (!w) continue;
+        for (i = 0; i < count; i++)
+            line[i] += w * src[i];
+    }
+    /* drop some precision so that the second pass can't overflow */
+    for (i = 0; i < count; i++)
+        line[i] = (line[i] + (1 << 7)) >> 8;
+
+    for (i = 0; i < dst_width; i++)
+    {
+        const int *src = line + (fx->start[dst_x + i] - first_x) * bytesperpixel;
+
+        weights = fx->weights + (dst_x + i) * fx->taps;
+        for (c = 0; c < bytesperpixel; c++)
+        {
+            int sum = 0;
+
+            for (t = 0; t < fx->taps; t++)
+                sum += weights[t] * src[t * bytesperpixel + c];
+            *pbBuffer++ = clamp_filtered(sum);
+        }
+    }
+}
+
+/* the filters with negative lobes can give colors brighter than their alpha */
+static void clamp_premultiplied(BYTE *bits, UINT width, UINT height, UINT stride)
+{
+    UINT x, y;
+
+    for (y = 0; y < height; y++)
+    {
+        BYTE *pixel = bits + stride * y;
+        for (x = 0; x < width; x++, pixel += 4)
+        {
+            pixel[0] = min(pixel[0], pixel[3]);
+            pixel[1] = min(pixel[1], pixel[3]);
+            pixel[2] = min(pixel[2], pixel[3]);
+        }
     }
 }
 
+/* formats with one byte per channel, which can be filtered bytewise */
+static BOOL is_filterable_format(const WICPixelFormatGUID *format)
+{
+    static const WICPixelFormatGUID *formats[] =
+    {
+        &GUID_WICPixelFormat8bppGray,
+        &GUID_WICPixelFormat24bppBGR,
+        &GUID_WICPixelFormat24bppRGB,
+        &GUID_WICPixelFormat32bppBGR,
+        &GUID_WICPixelFormat32bppBGRA,
+        &GUID_WICPixelFormat32bppPBGRA,
+        &GUID_WICPixelFormat32bppRGB,
+        &GUID_WICPixelFormat32bppRGBA,
+        &GUID_WICPixelFormat32bppPRGBA,
+    };
+    UINT i;
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+        if (IsEqualGUID(format, formats[i])) return TRUE;
+    return FALSE;
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -296,11 +555,20 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
 
     if (SUCCEEDED(hr))
     {
+        if (This->premultiply)
+            premultiply_alpha(src_bits, src_rect.Width, src_rect.Height, src_bytesperrow);
+
         for (y=0; y < dest_rect.Height; y++)
         {
             This->fn_copy_scanline(This, dest_rect.X, dest_rect.Y+y, dest_rect.Width,
                 src_rows, src_rect.X, src_rect.Y, pbBuffer + cbStride * y);
         }
+
+        if (This->premultiply)
+        {
+            clamp_premultiplied(pbBuffer, dest_rect.Width, dest_rect.Height, cbStride);
+            unpremultiply_alpha(pbBuffer, dest_rect.Width, dest_rect.Height, cbStride);
+        }
     }
 
     HeapFree(GetProcessHeap(), 0, src_rows);
@@ -351,8 +619,52 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeFant:
+        case WICBitmapInterpolationModeHighQualityCubic:
+            if (is_filterable_format(&src_pixelformat) || (This->bpp % 8) != 0)
+            {
+                if ((This->bpp % 8) == 0)
+                {
+                    IWICBitmapSource_AddRef(pISource);
+                    This->source = pISource;
+                    This->premultiply = IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppBGRA) ||
+                                        IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppRGBA);
+                }
+                else
+                {
+                    hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
+                        pISource, &This->source);
+                    This->bpp = 32;
+                    This->premultiply = TRUE;
+                }
+                if (SUCCEEDED(hr))
+                    hr = init_filter(&This->filter_x, This->width, This->src_width, mode);
+                if (SUCCEEDED(hr))
+                    hr = init_filter(&This->filter_y, This->height, This->src_height, mode);
+                if (SUCCEEDED(hr) && !(This->line_buffer = HeapAlloc(GetProcessHeap(), 0,
+                        This->src_width * (This->bpp / 8) * sizeof(*This->line_buffer))))
+                    hr = E_OUTOFMEMORY;
+                if (FAILED(hr))
+                {
+                    free_filter(&This->filter_x);
+                    free_filter(&This->filter_y);
+                    if (This->source) IWICBitmapSource_Release(This->source);
+                    This->source = NULL;
+                    This->premultiply = FALSE;
+                    break;
+                }
+                This->fn_get_required_source_rect = Filter_GetRequiredSourceRect;
+                This->fn_copy_scanline = Filter_CopyScanline;
+                break;
+            }
+            FIXME("mode %i not supported for format %s, using nearest neighbor\n",
+                  mode, debugstr_guid(&src_pixelformat));
+            /* fall-through */
         default:
-            FIXME("unsupported mode %i\n", mode);
+            if (mode > WICBitmapInterpolationModeHighQualityCubic)
+                FIXME("unsupported mode %i\n", mode);
             /* fall-through */
         case WICBitmapInterpolationModeNearestNeighbor:
             if ((This->bpp % 8) == 0)
@@ -527,6 +839,10 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    memset(&This->filter_x, 0, sizeof(This->filter_x));
+    memset(&This->filter_y, 0, sizeof(This->filter_y));
+    This->line_buffer = NULL;
+    This->premultiply = FALSE;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -19,6 +19,7 @@
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <assert.h>
 #include <math.h>
 
@@ -1312,6 +1313,114 @@ static void test_bitmap_scaler(void)
     IWICBitmap_Release(bitmap);
 }
 
+static void test_bitmap_scaler_modes(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeNearestNeighbor,
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant,
+        WICBitmapInterpolationModeHighQualityCubic,
+    };
+    static const struct { UINT width, height; } sizes[] = { {8, 6}, {2, 1}, {5, 3} };
+    DWORD src[4 * 3], dst[8 * 6];
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    UINT i, j, k;
+    HRESULT hr;
+
+    /* a flat image has to stay flat whatever the filter */
+    for (i = 0; i < ARRAY_SIZE(src); i++) src[i] = 0xff402010;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 3, &GUID_WICPixelFormat32bppBGRA,
+                                                   16, sizeof(src), (BYTE *)src, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#lx.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(sizes); j++)
+        {
+            hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+            ok(hr == S_OK, "Failed to create bitmap scaler, hr %#lx.\n", hr);
+
+            hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap,
+                    sizes[j].width, sizes[j].height, modes[i]);
+            ok(hr == S_OK, "mode %u: failed to initialize bitmap scaler, hr %#lx.\n", modes[i], hr);
+
+            memset(dst, 0, sizeof(dst));
+            hr = IWICBitmapScaler_CopyPixels(scaler, NULL, sizes[j].width * 4, sizeof(dst), (BYTE *)dst);
+            ok(hr == S_OK, "mode %u: failed to copy pixels, hr %#lx.\n", modes[i], hr);
+            for (k = 0; k < sizes[j].width * sizes[j].height; k++)
+                ok(dst[k] == 0xff402010, "mode %u, %ux%u: got %08lx at %u.\n", modes[i],
+                   sizes[j].width, sizes[j].height, dst[k], k);
+
+            IWICBitmapScaler_Release(scaler);
+        }
+    }
+
+    IWICBitmap_Release(bitmap);
+}
+
+static BOOL compare_pixel(DWORD c1, DWORD c2)
+{
+    unsigned int i;
+
+    for (i = 0; i < 32; i += 8)
+        if (abs((int)((c1 >> i) & 0xff) - (int)((c2 >> i) & 0xff)) > 1) return FALSE;
+    return TRUE;
+}
+
+static void test_bitmap_scaler_filtering(void)
+{
+    static const BYTE gray_src[4] = { 0x00, 0x40, 0x80, 0xc0 };
+    static const BYTE gray_expect[2] = { 0x20, 0xa0 };
+    /* transparent pixels don't bleed their color into the opaque ones */
+    static const DWORD bgra_src[4] = { 0xffff0000, 0x0000ff00, 0x00000000, 0xff0000ff };
+    static const DWORD bgra_expect[2] = { 0x80ff0000, 0x800000ff };
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    BYTE gray_dst[2];
+    DWORD bgra_dst[2];
+    unsigned int i;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 1, &GUID_WICPixelFormat8bppGray,
+                                                   4, sizeof(gray_src), (BYTE *)gray_src, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#lx.\n", hr);
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "Failed to create bitmap scaler, hr %#lx.\n", hr);
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 2, 1, WICBitmapInterpolationModeFant);
+    ok(hr == S_OK, "Failed to initialize bitmap scaler, hr %#lx.\n", hr);
+
+    memset(gray_dst, 0xcc, sizeof(gray_dst));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 2, sizeof(gray_dst), gray_dst);
+    ok(hr == S_OK, "Failed to copy pixels, hr %#lx.\n", hr);
+    for (i = 0; i < ARRAY_SIZE(gray_dst); i++)
+        ok(gray_dst[i] == gray_expect[i], "%u: got %02x, expected %02x.\n", i, gray_dst[i], gray_expect[i]);
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 4, 1, &GUID_WICPixelFormat32bppBGRA,
+                                                   16, sizeof(bgra_src), (BYTE *)bgra_src, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#lx.\n", hr);
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "Failed to create bitmap scaler, hr %#lx.\n", hr);
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, 2, 1, WICBitmapInterpolationModeFant);
+    ok(hr == S_OK, "Failed to initialize bitmap scaler, hr %#lx.\n", hr);
+
+    memset(bgra_dst, 0xcc, sizeof(bgra_dst));
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, 8, sizeof(bgra_dst), (BYTE *)bgra_dst);
+    ok(hr == S_OK, "Failed to copy pixels, hr %#lx.\n", hr);
+    for (i = 0; i < ARRAY_SIZE(bgra_dst); i++)
+        ok(compare_pixel(bgra_dst[i], bgra_expect[i]), "%u: got %08lx, expected %08lx.\n",
+           i, bgra_dst[i], bgra_expect[i]);
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+}
+
 static LONG obj_refcount(void *obj)
 {
     IUnknown_AddRef((IUnknown *)obj);
@@ -1482,6 +1591,8 @@ START_TEST(bitmap)
     test_CreateBitmapFromHBITMAP();
     test_clipper();
     test_bitmap_scaler();
+    test_bitmap_scaler_modes();
+    test_bitmap_scaler_filtering();
 
     IWICImagingFactory_Release(factory);
 
@@ -19,6 +19,7 @@
 #include "objbase.h"
 #include "wincodec.h"
 #include "wine/test.h"
+#include "shlwapi.h"
 
 static const char jpeg_adobe_cmyk_1x5[] =
     "\xff\xd8\xff\xe0\x00\x10\x4a\x46\x49\x46\x00\x01\x01\x01\x01\x2c"
@@ -155,11 +156,120 @@ static void test_decode_adobe_cmyk(void)
 }
 
 
+/* 8x32 grayscale JPEG image, a gradient from top to bottom */
+static const char jpeg_gray_8x32[] =
+    "\xff\xd8\xff\xe0\x00\x10\x4a\x46\x49\x46\x00\x01\x01\x00\x00\x01"
+    "\x00\x01\x00\x00\xff\xdb\x00\x43\x00\x03\x02\x02\x03\x02\x02\x03"
+    "\x03\x03\x03\x04\x03\x03\x04\x05\x08\x05\x05\x04\x04\x05\x0a\x07"
+    "\x07\x06\x08\x0c\x0a\x0c\x0c\x0b\x0a\x0b\x0b\x0d\x0e\x12\x10\x0d"
+    "\x0e\x11\x0e\x0b\x0b\x10\x16\x10\x11\x13\x14\x15\x15\x15\x0c\x0f"
+    "\x17\x18\x16\x14\x18\x12\x14\x15\x14\xff\xc0\x00\x0b\x08\x00\x20"
+    "\x00\x08\x01\x01\x11\x00\xff\xc4\x00\x15\x00\x01\x01\x00\x00\x00"
+    "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x08\x09\xff\xc4\x00"
+    "\x19\x10\x00\x01\x05\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00"
+    "\x00\x00\x00\x04\x07\x23\x31\xa1\xff\xda\x00\x08\x01\x01\x00\x00"
+    "\x3f\x00\x9f\xc9\x9b\x6a\x8b\x05\x52\x66\xda\xa2\xc1\x56\x99\xb6"
+    "\xa8\xb0\x55\xa6\x6d\xaa\x2c\x3f\xff\xd9";
+
+static HRESULT create_frame(const char *data, UINT size, IWICBitmapDecoder **decoder,
+                            IWICBitmapFrameDecode **frame)
+{
+    IStream *stream;
+    HRESULT hr;
+
+    hr = CoCreateInstance(&CLSID_WICJpegDecoder, NULL, CLSCTX_INPROC_SERVER,
+        &IID_IWICBitmapDecoder, (void **)decoder);
+    if (FAILED(hr)) return hr;
+
+    stream = SHCreateMemStream((const BYTE *)data, size);
+    hr = IWICBitmapDecoder_Initialize(*decoder, stream, WICDecodeMetadataCacheOnLoad);
+    if (SUCCEEDED(hr))
+        hr = IWICBitmapDecoder_GetFrame(*decoder, 0, frame);
+    IStream_Release(stream);
+
+    if (FAILED(hr)) IWICBitmapDecoder_Release(*decoder);
+    return hr;
+}
+
+static void test_decode_bands(void)
+{
+    static const UINT order[] = { 24, 8, 0, 16 };
+    IWICBitmapFrameDecode *frame;
+    IWICBitmapDecoder *decoder;
+    BYTE full[8 * 32], data[8 * 32];
+    HRESULT hr, hr2;
+    WICRect rect;
+    UINT i;
+
+    hr = create_frame(jpeg_gray_8x32, sizeof(jpeg_gray_8x32) - 1, &decoder, &frame);
+    ok(hr == S_OK, "Failed to load JPEG image data, hr=%lx\n", hr);
+    if (hr != S_OK) return;
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, 8, sizeof(full), full);
+    ok(hr == S_OK, "CopyPixels failed, hr=%lx\n", hr);
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+
+    /* bands read from the top */
+    hr = create_frame(jpeg_gray_8x32, sizeof(jpeg_gray_8x32) - 1, &decoder, &frame);
+    ok(hr == S_OK, "Failed to load JPEG image data, hr=%lx\n", hr);
+    if (hr != S_OK) return;
+
+    memset(data, 0xcc, sizeof(data));
+    for (i = 0; i < 32; i += 4)
+    {
+        rect.X = 0;
+        rect.Y = i;
+        rect.Width = 8;
+        rect.Height = 4;
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rect, 8, 8 * 4, data + i * 8);
+        ok(hr == S_OK, "%u: CopyPixels failed, hr=%lx\n", i, hr);
+    }
+    ok(!memcmp(data, full, sizeof(data)), "unexpected image data\n");
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+
+    /* bands read out of order, the later ones are already decoded */
+    hr = create_frame(jpeg_gray_8x32, sizeof(jpeg_gray_8x32) - 1, &decoder, &frame);
+    ok(hr == S_OK, "Failed to load JPEG image data, hr=%lx\n", hr);
+    if (hr != S_OK) return;
+
+    memset(data, 0xcc, sizeof(data));
+    for (i = 0; i < ARRAY_SIZE(order); i++)
+    {
+        rect.X = 0;
+        rect.Y = order[i];
+        rect.Width = 8;
+        rect.Height = 8;
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rect, 8, 8 * 8, data + order[i] * 8);
+        ok(hr == S_OK, "%u: CopyPixels failed, hr=%lx\n", order[i], hr);
+    }
+    ok(!memcmp(data, full, sizeof(data)), "unexpected image data\n");
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+
+    /* image data truncated in the middle of the scan, which may already fail
+     * when the image is loaded, or be returned partially decoded */
+    hr = create_frame(jpeg_gray_8x32, sizeof(jpeg_gray_8x32) - 17, &decoder, &frame);
+    ok(hr == S_OK || broken(FAILED(hr)), "Failed to load JPEG image data, hr=%lx\n", hr);
+    if (hr != S_OK) return;
+
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, 8, sizeof(data), data);
+    ok(FAILED(hr) || broken(hr == S_OK), "CopyPixels returned %lx\n", hr);
+    hr2 = IWICBitmapFrameDecode_CopyPixels(frame, NULL, 8, sizeof(data), data);
+    ok(hr2 == hr, "expected hr=%lx, got %lx\n", hr, hr2);
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+}
+
 START_TEST(jpegformat)
 {
     CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
 
     test_decode_adobe_cmyk();
+    test_decode_bands();
 
     CoUninitialize();
 }
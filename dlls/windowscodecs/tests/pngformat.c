@@ -950,6 +950,97 @@ static void test_chunk_size(void)
     IWICBitmapDecoder_Release(decoder);
 }
 
+/* 8x32 grayscale PNG image, each pixel is y * 8 + x */
+static const char png_gray_8x32[] = {
+  0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+  0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x20,
+  0x08, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x9b, 0x66, 0x0c, 0x00, 0x00, 0x00,
+  0x17, 0x49, 0x44, 0x41, 0x54, 0x18, 0xd3, 0x63, 0x64, 0x60, 0x84, 0x02,
+  0x0e, 0x28, 0xcd, 0x32, 0xca, 0x60, 0x64, 0x64, 0xfc, 0x01, 0xa5, 0x01,
+  0x54, 0x47, 0x03, 0x40, 0xf3, 0x92, 0x0b, 0xeb, 0x00, 0x00, 0x00, 0x00,
+  0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+};
+
+static void test_decode_bands(void)
+{
+    static const UINT order[] = { 24, 8, 0, 16 };
+    IWICBitmapFrameDecode *frame;
+    IWICBitmapDecoder *decoder;
+    BYTE data[8 * 32];
+    HRESULT hr, hr2;
+    WICRect rect;
+    UINT i;
+
+    /* bands read from the top */
+    hr = create_decoder(png_gray_8x32, sizeof(png_gray_8x32), &decoder);
+    ok(hr == S_OK, "Failed to load PNG image data %#lx\n", hr);
+    if (hr != S_OK) return;
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#lx\n", hr);
+
+    memset(data, 0xcc, sizeof(data));
+    for (i = 0; i < 32; i += 4)
+    {
+        rect.X = 0;
+        rect.Y = i;
+        rect.Width = 8;
+        rect.Height = 4;
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rect, 8, 8 * 4, data + i * 8);
+        ok(hr == S_OK, "%u: CopyPixels error %#lx\n", i, hr);
+    }
+    for (i = 0; i < sizeof(data); i++)
+        if (data[i] != i) break;
+    ok(i == sizeof(data), "wrong pixel at %u\n", i);
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+
+    /* bands read out of order, the later ones are already decoded */
+    hr = create_decoder(png_gray_8x32, sizeof(png_gray_8x32), &decoder);
+    ok(hr == S_OK, "Failed to load PNG image data %#lx\n", hr);
+    if (hr != S_OK) return;
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK, "GetFrame error %#lx\n", hr);
+
+    memset(data, 0xcc, sizeof(data));
+    for (i = 0; i < ARRAY_SIZE(order); i++)
+    {
+        rect.X = 0;
+        rect.Y = order[i];
+        rect.Width = 8;
+        rect.Height = 8;
+        hr = IWICBitmapFrameDecode_CopyPixels(frame, &rect, 8, 8 * 8, data + order[i] * 8);
+        ok(hr == S_OK, "%u: CopyPixels error %#lx\n", order[i], hr);
+    }
+    for (i = 0; i < sizeof(data); i++)
+        if (data[i] != i) break;
+    ok(i == sizeof(data), "wrong pixel at %u\n", i);
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+
+    /* image data truncated in the middle of IDAT, which may already fail
+     * when the image is loaded, or be returned partially decoded */
+    hr = create_decoder(png_gray_8x32, 56, &decoder);
+    ok(hr == S_OK || broken(FAILED(hr)), "Failed to load PNG image data %#lx\n", hr);
+    if (hr != S_OK) return;
+    hr = IWICBitmapDecoder_GetFrame(decoder, 0, &frame);
+    ok(hr == S_OK || broken(FAILED(hr)), "GetFrame error %#lx\n", hr);
+    if (hr != S_OK)
+    {
+        IWICBitmapDecoder_Release(decoder);
+        return;
+    }
+
+    hr = IWICBitmapFrameDecode_CopyPixels(frame, NULL, 8, sizeof(data), data);
+    ok(FAILED(hr) || broken(hr == S_OK), "CopyPixels returned %#lx\n", hr);
+    hr2 = IWICBitmapFrameDecode_CopyPixels(frame, NULL, 8, sizeof(data), data);
+    ok(hr2 == hr, "expected %#lx, got %#lx\n", hr, hr2);
+
+    IWICBitmapFrameDecode_Release(frame);
+    IWICBitmapDecoder_Release(decoder);
+}
+
 START_TEST(pngformat)
 {
     HRESULT hr;
@@ -964,6 +1055,7 @@ START_TEST(pngformat)
     test_png_palette();
     test_color_formats();
     test_chunk_size();
+    test_decode_bands();
 
     IWICImagingFactory_Release(factory);
     CoUninitialize();
@@ -199,6 +199,19 @@ void reverse_bgr8(UINT bytesperpixel, LPBYTE bits, UINT width, UINT height, INT
     UINT x, y;
     BYTE *pixel, temp;
 
+    if (bytesperpixel == 4)
+    {
+        /* swap whole pixels at once, the compiler can vectorize this */
+        for (y=0; y<height; y++)
+        {
+            DWORD *dword = (DWORD *)(bits + stride * y);
+
+            for (x=0; x<width; x++)
+                dword[x] = (dword[x] & 0xff00ff00) | ((dword[x] >> 16) & 0xff) | ((dword[x] & 0xff) << 16);
+        }
+        return;
+    }
+
     for (y=0; y<height; y++)
     {
         pixel = bits + stride * y;
@@ -177,6 +177,8 @@ extern HRESULT write_source(IWICBitmapFrameEncode *iface,
     INT width, INT height) DECLSPEC_HIDDEN;
 
 extern void reverse_bgr8(UINT bytesperpixel, LPBYTE bits, UINT width, UINT height, INT stride) DECLSPEC_HIDDEN;
+extern void premultiply_alpha(BYTE *bits, UINT width, UINT height, UINT stride) DECLSPEC_HIDDEN;
+extern void unpremultiply_alpha(BYTE *bits, UINT width, UINT height, UINT stride) DECLSPEC_HIDDEN;
 
 extern HRESULT get_pixelformat_bpp(const GUID *pixelformat, UINT *bpp) DECLSPEC_HIDDEN;
 
@@ -152,6 +152,9 @@ struct wm_stream
      * compressed samples. Rather, the behaviour of the reader objects differs
      * in nontrivial ways depending on this field. */
     bool read_compressed;
+
+    /* buffers of the released samples, reused for the next ones */
+    struct buffer_pool *buffer_pool;
 };
 
 struct wm_reader
@@ -30,6 +30,7 @@ WINE_DEFAULT_DEBUG_CHANNEL(mfplat);
 struct media_stream
 {
     IMFMediaStream IMFMediaStream_iface;
+    IMFAsyncCallback sample_released_callback;
     LONG ref;
     struct media_source *parent_source;
     IMFMediaEventQueue *event_queue;
@@ -49,6 +50,11 @@ struct media_stream
     } state;
     DWORD stream_id;
     BOOL eos;
+
+    /* buffers of the released samples, reused while the stream is running */
+    CRITICAL_SECTION pool_cs;
+    IMFMediaBuffer *buffer_pool[4];
+    unsigned int buffer_pool_count;
 };
 
 enum source_async_op
@@ -115,6 +121,11 @@ static inline struct media_stream *impl_from_IMFMediaStream(IMFMediaStream *ifac
     return CONTAINING_RECORD(iface, struct media_stream, IMFMediaStream_iface);
 }
 
+static inline struct media_stream *impl_from_sample_released_callback(IMFAsyncCallback *iface)
+{
+    return CONTAINING_RECORD(iface, struct media_stream, sample_released_callback);
+}
+
 static inline struct media_source *impl_from_IMFMediaSource(IMFMediaSource *iface)
 {
     return CONTAINING_RECORD(iface, struct media_source, IMFMediaSource_iface);
@@ -315,6 +326,49 @@ static void flush_token_queue(struct media_stream *stream, BOOL send)
     stream->token_queue_cap = 0;
 }
 
+static HRESULT get_pool_buffer(struct media_stream *stream, DWORD size, IMFMediaBuffer **out)
+{
+    IMFMediaBuffer *buffer;
+    DWORD max_length;
+
+    EnterCriticalSection(&stream->pool_cs);
+    while (stream->buffer_pool_count)
+    {
+        buffer = stream->buffer_pool[--stream->buffer_pool_count];
+        if (SUCCEEDED(IMFMediaBuffer_GetMaxLength(buffer, &max_length)) && max_length >= size)
+        {
+            LeaveCriticalSection(&stream->pool_cs);
+            *out = buffer;
+            return S_OK;
+        }
+        /* The format changed, drop the buffer. */
+        IMFMediaBuffer_Release(buffer);
+    }
+    LeaveCriticalSection(&stream->pool_cs);
+
+    return MFCreateMemoryBuffer(size, out);
+}
+
+static void put_pool_buffer(struct media_stream *stream, IMFMediaBuffer *buffer)
+{
+    EnterCriticalSection(&stream->pool_cs);
+    if (stream->state == STREAM_RUNNING && !stream->eos
+            && stream->buffer_pool_count < ARRAY_SIZE(stream->buffer_pool))
+    {
+        IMFMediaBuffer_AddRef(buffer);
+        stream->buffer_pool[stream->buffer_pool_count++] = buffer;
+    }
+    LeaveCriticalSection(&stream->pool_cs);
+}
+
+static void flush_buffer_pool(struct media_stream *stream)
+{
+    EnterCriticalSection(&stream->pool_cs);
+    while (stream->buffer_pool_count)
+        IMFMediaBuffer_Release(stream->buffer_pool[--stream->buffer_pool_count]);
+    LeaveCriticalSection(&stream->pool_cs);
+}
+
 static void start_pipeline(struct media_source *source, struct source_async_command *command)
 {
     PROPVARIANT *position = &command->u.start.position;
@@ -348,6 +402,8 @@ static void start_pipeline(struct media_source *source, struct source_async_comm
         was_active = stream->state != STREAM_INACTIVE;
 
         stream->state = selected ? STREAM_RUNNING : STREAM_INACTIVE;
+        if (!selected)
+            flush_buffer_pool(stream);
 
         if (selected)
         {
@@ -403,6 +459,7 @@ static void pause_pipeline(struct media_source *source)
         {
             IMFMediaEventQueue_QueueEventParamVar(stream->event_queue, MEStreamPaused, &GUID_NULL, S_OK, NULL);
         }
+        flush_buffer_pool(stream);
     }
 
     IMFMediaEventQueue_QueueEventParamVar(source->event_queue, MESourcePaused, &GUID_NULL, S_OK, NULL);
@@ -422,6 +479,7 @@ static void stop_pipeline(struct media_source *source)
             IMFMediaEventQueue_QueueEventParamVar(stream->event_queue, MEStreamStopped, &GUID_NULL, S_OK, NULL);
             wg_parser_stream_disable(stream->wg_stream);
         }
+        flush_buffer_pool(stream);
     }
 
     IMFMediaEventQueue_QueueEventParamVar(source->event_queue, MESourceStopped, &GUID_NULL, S_OK, NULL);
@@ -451,18 +509,28 @@ static void dispatch_end_of_presentation(struct media_source *source)
 
 static void send_buffer(struct media_stream *stream, const struct wg_parser_buffer *wg_buffer, IUnknown *token)
 {
+    IMFTrackedSample *tracked_sample;
     IMFMediaBuffer *buffer;
     IMFSample *sample;
     HRESULT hr;
     BYTE *data;
 
-    if (FAILED(hr = MFCreateSample(&sample)))
+    if (FAILED(hr = MFCreateTrackedSample(&tracked_sample)))
     {
         ERR("Failed to create sample, hr %#x.\n", hr);
         return;
     }
 
-    if (FAILED(hr = MFCreateMemoryBuffer(wg_buffer->size, &buffer)))
+    /* The buffer goes back to the pool when the sample is released, so that
+     * the next frame is written into memory which is already committed,
+     * instead of into a new zero-filled allocation. */
+    hr = IMFTrackedSample_SetAllocator(tracked_sample, &stream->sample_released_callback, NULL);
+    IMFTrackedSample_QueryInterface(tracked_sample, &IID_IMFSample, (void **)&sample);
+    IMFTrackedSample_Release(tracked_sample);
+    if (FAILED(hr))
+        WARN("Failed to set sample allocator, hr %#x.\n", hr);
+
+    if (FAILED(hr = get_pool_buffer(stream, wg_buffer->size, &buffer)))
     {
         ERR("Failed to create buffer, hr %#x.\n", hr);
         IMFSample_Release(sample);
@@ -538,6 +606,7 @@ static void wait_on_sample(struct media_stream *stream, IUnknown *token)
     else
     {
         stream->eos = TRUE;
+        flush_buffer_pool(stream);
         IMFMediaEventQueue_QueueEventParamVar(stream->event_queue, MEEndOfStream, &GUID_NULL, S_OK, &empty_var);
         dispatch_end_of_presentation(stream->parent_source);
     }
@@ -590,6 +659,53 @@ static const IMFAsyncCallbackVtbl source_async_commands_callback_vtbl =
     source_async_commands_Invoke,
 };
 
+static ULONG WINAPI stream_sample_released_callback_AddRef(IMFAsyncCallback *iface)
+{
+    struct media_stream *stream = impl_from_sample_released_callback(iface);
+    return IMFMediaStream_AddRef(&stream->IMFMediaStream_iface);
+}
+
+static ULONG WINAPI stream_sample_released_callback_Release(IMFAsyncCallback *iface)
+{
+    struct media_stream *stream = impl_from_sample_released_callback(iface);
+    return IMFMediaStream_Release(&stream->IMFMediaStream_iface);
+}
+
+static HRESULT WINAPI stream_sample_released_Invoke(IMFAsyncCallback *iface, IMFAsyncResult *result)
+{
+    struct media_stream *stream = impl_from_sample_released_callback(iface);
+    IMFMediaBuffer *buffer;
+    IMFSample *sample;
+    IUnknown *object;
+    HRESULT hr;
+
+    if (FAILED(hr = IMFAsyncResult_GetObject(result, &object)))
+        return hr;
+
+    hr = IUnknown_QueryInterface(object, &IID_IMFSample, (void **)&sample);
+    IUnknown_Release(object);
+    if (FAILED(hr))
+        return hr;
+
+    if (SUCCEEDED(IMFSample_GetBufferByIndex(sample, 0, &buffer)))
+    {
+        put_pool_buffer(stream, buffer);
+        IMFMediaBuffer_Release(buffer);
+    }
+    IMFSample_Release(sample);
+
+    return S_OK;
+}
+
+static const IMFAsyncCallbackVtbl stream_sample_released_callback_vtbl =
+{
+    callback_QueryInterface,
+    stream_sample_released_callback_AddRef,
+    stream_sample_released_callback_Release,
+    callback_GetParameters,
+    stream_sample_released_Invoke,
+};
+
 static DWORD CALLBACK read_thread(void *arg)
 {
     struct media_source *source = arg;
@@ -695,6 +811,9 @@ static ULONG WINAPI media_stream_Release(IMFMediaStream *iface)
         if (stream->event_queue)
             IMFMediaEventQueue_Release(stream->event_queue);
         flush_token_queue(stream, FALSE);
+        flush_buffer_pool(stream);
+        stream->pool_cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection(&stream->pool_cs);
         free(stream);
     }
 
@@ -827,6 +946,7 @@ static HRESULT new_media_stream(struct media_source *source,
     TRACE("source %p, wg_stream %p, stream_id %u.\n", source, wg_stream, stream_id);
 
     object->IMFMediaStream_iface.lpVtbl = &media_stream_vtbl;
+    object->sample_released_callback.lpVtbl = &stream_sample_released_callback_vtbl;
     object->ref = 1;
 
     if (FAILED(hr = MFCreateEventQueue(&object->event_queue)))
@@ -843,6 +963,9 @@ static HRESULT new_media_stream(struct media_source *source,
     object->eos = FALSE;
     object->wg_stream = wg_stream;
 
+    InitializeCriticalSection(&object->pool_cs);
+    object->pool_cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": media_stream.pool_cs");
+
     TRACE("Created stream object %p.\n", object);
 
     *out_stream = object;
@@ -1336,6 +1459,7 @@ static HRESULT WINAPI media_source_Shutdown(IMFMediaSource *iface)
         struct media_stream *stream = source->streams[i];
 
         stream->state = STREAM_SHUTDOWN;
+        flush_buffer_pool(stream);
 
         IMFMediaEventQueue_Shutdown(stream->event_queue);
         IMFStreamDescriptor_Release(stream->descriptor);
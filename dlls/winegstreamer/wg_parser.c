@@ -57,6 +57,24 @@ GST_DEBUG_CATEGORY(wine);
 
 typedef BOOL (*init_gst_cb)(struct wg_parser *parser);
 
+/* Blocks of the input file read ahead of the pull requests. */
+struct read_block
+{
+    uint64_t offset;
+    uint32_t size;
+    enum
+    {
+        READ_BLOCK_EMPTY,
+        READ_BLOCK_QUEUED,   /* waiting for the read thread */
+        READ_BLOCK_READING,  /* handed to the read thread */
+        READ_BLOCK_READY,
+    } state;
+    GstFlowReturn ret;
+    unsigned int pins;       /* pull requests waiting on the block */
+    uint64_t last_use;
+    uint8_t *data;
+};
+
 struct wg_parser
 {
     init_gst_cb init_gst;
@@ -88,6 +106,11 @@ struct wg_parser
         GstFlowReturn ret;
     } read_request;
 
+    uint32_t read_block_size;
+    unsigned int read_ahead, read_block_count;
+    struct read_block *read_blocks, *reading_block;
+    uint64_t read_block_use;
+
     bool sink_connected, draining;
 
     bool unlimited_buffering;
@@ -525,14 +548,33 @@ static NTSTATUS wg_parser_get_stream(void *args)
     return S_OK;
 }
 
+/* Return the next block to read: blocks waited for by a pull request come
+ * first, then the read ahead blocks in file order. */
+static struct read_block *get_queued_read_block(struct wg_parser *parser)
+{
+    struct read_block *block, *ret = NULL;
+    unsigned int i;
+
+    for (i = 0; i < parser->read_block_count; ++i)
+    {
+        block = &parser->read_blocks[i];
+        if (block->state == READ_BLOCK_QUEUED && (!ret || block->pins > ret->pins
+                || (block->pins == ret->pins && block->offset < ret->offset)))
+            ret = block;
+    }
+    return ret;
+}
+
 static NTSTATUS wg_parser_get_next_read_offset(void *args)
 {
     struct wg_parser_get_next_read_offset_params *params = args;
     struct wg_parser *parser = params->parser;
+    struct read_block *block = NULL;
 
     pthread_mutex_lock(&parser->mutex);
 
-    while (parser->sink_connected && (!parser->read_request.size || parser->read_request.done))
+    while (parser->sink_connected && (!parser->read_request.size || parser->read_request.done)
+            && !(block = get_queued_read_block(parser)))
         pthread_cond_wait(&parser->read_cond, &parser->mutex);
 
     if (!parser->sink_connected)
@@ -541,8 +583,19 @@ static NTSTATUS wg_parser_get_next_read_offset(void *args)
         return VFW_E_WRONG_STATE;
     }
 
-    params->offset = parser->read_request.offset;
-    params->size = parser->read_request.size;
+    /* Pull requests which don't go through the read blocks come first. */
+    if (parser->read_request.size && !parser->read_request.done)
+    {
+        params->offset = parser->read_request.offset;
+        params->size = parser->read_request.size;
+    }
+    else
+    {
+        block->state = READ_BLOCK_READING;
+        parser->reading_block = block;
+        params->offset = block->offset;
+        params->size = block->size;
+    }
 
     pthread_mutex_unlock(&parser->mutex);
     return S_OK;
@@ -570,6 +623,31 @@ static NTSTATUS wg_parser_push_data(void *args)
 
     pthread_mutex_lock(&parser->mutex);
 
+    if (parser->reading_block)
+    {
+        struct read_block *block = parser->reading_block;
+
+        parser->reading_block = NULL;
+        if (result == WG_READ_SUCCESS && data && size)
+        {
+            memcpy(block->data, data, min(size, block->size));
+            block->size = min(size, block->size);
+            block->state = READ_BLOCK_READY;
+        }
+        else
+        {
+            if (result != WG_READ_SUCCESS)
+                block->ret = wg_read_result_to_gst(result);
+            else
+                block->ret = data ? GST_FLOW_EOS : GST_FLOW_ERROR;
+            block->state = READ_BLOCK_EMPTY;
+        }
+
+        pthread_mutex_unlock(&parser->mutex);
+        pthread_cond_broadcast(&parser->read_done_cond);
+        return S_OK;
+    }
+
     if (result != WG_READ_SUCCESS)
     {
             parser->read_request.ret = wg_read_result_to_gst(result);
@@ -603,7 +681,7 @@ static NTSTATUS wg_parser_push_data(void *args)
     parser->read_request.size = 0;
 
     pthread_mutex_unlock(&parser->mutex);
-    pthread_cond_signal(&parser->read_done_cond);
+    pthread_cond_broadcast(&parser->read_done_cond);
 
     return S_OK;
 }
@@ -842,7 +920,7 @@ static NTSTATUS wg_parser_stream_drain(void *args)
     }
 
     parser->draining = true;
-    pthread_cond_signal(&parser->read_done_cond);
+    pthread_cond_broadcast(&parser->read_done_cond);
 
     /* We must wait for either an event to occur or the drain to complete.
        Since drains are blocking, we assign this responsibility to the thread
@@ -1474,12 +1552,172 @@ static void pad_removed_cb(GstElement *element, GstPad *pad, gpointer user)
     g_free(name);
 }
 
+static void handle_drain_request(struct wg_parser *parser)
+{
+    unsigned int i;
+
+    if (parser->draining)
+    {
+        gst_pad_peer_query(parser->my_src, gst_query_new_drain());
+        parser->draining = false;
+        for (i = 0; i < parser->stream_count; i++)
+            pthread_cond_signal(&parser->streams[i]->event_cond);
+    }
+}
+
+static struct read_block *find_read_block(struct wg_parser *parser, uint64_t offset)
+{
+    unsigned int i;
+
+    for (i = 0; i < parser->read_block_count; ++i)
+    {
+        if (parser->read_blocks[i].state != READ_BLOCK_EMPTY && parser->read_blocks[i].offset == offset)
+            return &parser->read_blocks[i];
+    }
+    return NULL;
+}
+
+/* Queue a read of the block at the given offset, reusing the least recently
+ * used block which isn't being read or waited for. */
+static struct read_block *queue_read_block(struct wg_parser *parser, uint64_t offset)
+{
+    struct read_block *block = NULL;
+    unsigned int i;
+
+    for (i = 0; i < parser->read_block_count; ++i)
+    {
+        struct read_block *candidate = &parser->read_blocks[i];
+
+        if (candidate->pins || candidate->state == READ_BLOCK_QUEUED || candidate->state == READ_BLOCK_READING)
+            continue;
+        if (!block || candidate->state == READ_BLOCK_EMPTY
+                || (block->state != READ_BLOCK_EMPTY && candidate->last_use < block->last_use))
+            block = candidate;
+    }
+    if (!block)
+        return NULL;
+
+    if (!block->data && !(block->data = malloc(parser->read_block_size)))
+        return NULL;
+
+    block->offset = offset;
+    block->size = min(parser->read_block_size, parser->file_size - offset);
+    block->state = READ_BLOCK_QUEUED;
+    block->ret = GST_FLOW_OK;
+    block->last_use = ++parser->read_block_use;
+    pthread_cond_signal(&parser->read_cond);
+    return block;
+}
+
+/* Serve a pull request from the read blocks, reading ahead of it.
+ * Returns false if the request can't go through the blocks. */
+static bool read_from_blocks(struct wg_parser *parser, guint64 offset, guint size,
+        GstBuffer **buffer, GstFlowReturn *ret)
+{
+    uint64_t block_offset, first = offset - offset % parser->read_block_size;
+    struct read_block *blocks[2] = {NULL, NULL};
+    uint32_t copied = 0, block_count, i;
+    GstMapInfo map_info;
+
+    if (offset >= parser->file_size)
+    {
+        *ret = GST_FLOW_EOS;
+        return true;
+    }
+
+    block_count = (offset + size - 1) / parser->read_block_size - first / parser->read_block_size + 1;
+    if (block_count > ARRAY_SIZE(blocks))
+        return false;
+
+    for (i = 0; i < block_count; ++i)
+    {
+        block_offset = first + i * parser->read_block_size;
+        if (block_offset >= parser->file_size)
+            break;
+        if (!(blocks[i] = find_read_block(parser, block_offset))
+                && !(blocks[i] = queue_read_block(parser, block_offset)))
+        {
+            while (i--)
+                blocks[i]->pins--;
+            return false;
+        }
+        blocks[i]->pins++;
+        blocks[i]->last_use = ++parser->read_block_use;
+    }
+    block_count = i;
+
+    /* Read ahead of the request, stopping at blocks which are still in use. */
+    block_offset = first + block_count * parser->read_block_size;
+    for (i = 0; i < parser->read_ahead && block_offset < parser->file_size; ++i)
+    {
+        if (!find_read_block(parser, block_offset) && !queue_read_block(parser, block_offset))
+            break;
+        block_offset += parser->read_block_size;
+    }
+
+    *ret = GST_FLOW_OK;
+    for (i = 0; i < block_count; ++i)
+    {
+        while (blocks[i]->state == READ_BLOCK_QUEUED || blocks[i]->state == READ_BLOCK_READING)
+        {
+            pthread_cond_wait(&parser->read_done_cond, &parser->mutex);
+            handle_drain_request(parser);
+        }
+        if (blocks[i]->state != READ_BLOCK_READY && *ret == GST_FLOW_OK)
+            *ret = blocks[i]->ret;
+    }
+
+    if (*ret == GST_FLOW_OK)
+    {
+        /* Note that we don't allocate the buffer until we know the size,
+         * as in wg_parser_push_data(). */
+        for (i = 0; i < block_count; ++i)
+        {
+            uint64_t start = max(offset, blocks[i]->offset);
+            uint64_t end = min(offset + size, blocks[i]->offset + blocks[i]->size);
+
+            if (end > start)
+                copied += end - start;
+            if (blocks[i]->size < parser->read_block_size)
+                break;
+        }
+        if (!copied)
+            *ret = GST_FLOW_EOS;
+    }
+
+    if (*ret == GST_FLOW_OK)
+    {
+        if (!*buffer)
+            *buffer = gst_buffer_new_and_alloc(copied);
+        gst_buffer_map(*buffer, &map_info, GST_MAP_WRITE);
+        for (i = 0, copied = 0; i < block_count; ++i)
+        {
+            uint64_t start = max(offset, blocks[i]->offset);
+            uint64_t end = min(offset + size, blocks[i]->offset + blocks[i]->size);
+
+            if (end > start)
+            {
+                memcpy(map_info.data + copied, blocks[i]->data + (start - blocks[i]->offset), end - start);
+                copied += end - start;
+            }
+            if (blocks[i]->size < parser->read_block_size)
+                break;
+        }
+        gst_buffer_unmap(*buffer, &map_info);
+        if (copied < size)
+            gst_buffer_set_size(*buffer, copied);
+    }
+
+    for (i = 0; i < block_count; ++i)
+        blocks[i]->pins--;
+    return true;
+}
+
 static GstFlowReturn src_getrange_cb(GstPad *pad, GstObject *parent,
         guint64 offset, guint size, GstBuffer **buffer)
 {
     struct wg_parser *parser = gst_pad_get_element_private(pad);
     GstFlowReturn ret;
-    unsigned int i;
 
     GST_LOG("pad %p, offset %" G_GINT64_MODIFIER "u, size %u, buffer %p.", pad, offset, size, *buffer);
 
@@ -1501,12 +1739,14 @@ static GstFlowReturn src_getrange_cb(GstPad *pad, GstObject *parent,
 
     pthread_mutex_lock(&parser->mutex);
 
-    if (parser->draining)
+    handle_drain_request(parser);
+
+    if (parser->read_blocks && parser->seekable && size
+            && read_from_blocks(parser, offset, size, buffer, &ret))
     {
-        gst_pad_peer_query(parser->my_src, gst_query_new_drain());
-        parser->draining = false;
-        for (i = 0; i < parser->stream_count; i++)
-            pthread_cond_signal(&parser->streams[i]->event_cond);
+        pthread_mutex_unlock(&parser->mutex);
+        GST_LOG("Request returned %s.", gst_flow_get_name(ret));
+        return ret;
     }
 
     assert(!parser->read_request.size);
@@ -1523,13 +1763,7 @@ static GstFlowReturn src_getrange_cb(GstPad *pad, GstObject *parent,
     while (!parser->read_request.done)
     {
         pthread_cond_wait(&parser->read_done_cond, &parser->mutex);
-        if (parser->draining)
-        {
-            gst_pad_peer_query(parser->my_src, gst_query_new_drain());
-            parser->draining = false;
-            for (i = 0; i < parser->stream_count; i++)
-                pthread_cond_signal(&parser->streams[i]->event_cond);
-        }
+        handle_drain_request(parser);
     }
 
     *buffer = parser->read_request.buffer;
@@ -1957,6 +2191,14 @@ static NTSTATUS wg_parser_connect(void *args)
     parser->seekable = true;
     parser->file_size = params->file_size;
 
+    /* The parser may be connected to a different file. */
+    for (i = 0; i < parser->read_block_count; ++i)
+    {
+        parser->read_blocks[i].state = READ_BLOCK_EMPTY;
+        parser->read_blocks[i].pins = 0;
+    }
+    parser->reading_block = NULL;
+
     if ((hr = wg_parser_connect_inner(parser)))
         return hr;
 
@@ -2507,6 +2749,7 @@ static NTSTATUS wg_parser_create(void *args)
 
     struct wg_parser_create_params *params = args;
     struct wg_parser *parser;
+    const char *e;
 
     if (!init_gstreamer())
         return E_FAIL;
@@ -2514,6 +2757,24 @@ static NTSTATUS wg_parser_create(void *args)
     if (!(parser = calloc(1, sizeof(*parser))))
         return E_OUTOFMEMORY;
 
+    /* Read blocks are only used when the parser is connected to a file.
+     * WINE_GST_READ_AHEAD=0 disables them. */
+    parser->read_block_size = 256 * 1024;
+    parser->read_ahead = 4;
+    if ((e = getenv("WINE_GST_READ_BLOCK_SIZE")) && atoi(e) >= 4096)
+        parser->read_block_size = atoi(e);
+    if ((e = getenv("WINE_GST_READ_AHEAD")))
+        parser->read_ahead = max(0, min(atoi(e), 64));
+    if (parser->read_ahead > 0)
+    {
+        /* room for the blocks read ahead, the blocks of the current request
+         * and the blocks recently read, which are often requested again
+         * when the demuxer looks back */
+        parser->read_block_count = 2 * parser->read_ahead + 2;
+        if (!(parser->read_blocks = calloc(parser->read_block_count, sizeof(*parser->read_blocks))))
+            parser->read_block_count = 0;
+    }
+
     pthread_mutex_init(&parser->mutex, NULL);
     pthread_cond_init(&parser->init_cond, NULL);
     pthread_cond_init(&parser->read_cond, NULL);
@@ -2529,6 +2790,7 @@ static NTSTATUS wg_parser_create(void *args)
 static NTSTATUS wg_parser_destroy(void *args)
 {
     struct wg_parser *parser = args;
+    unsigned int i;
 
     if (parser->bus)
     {
@@ -2541,6 +2803,9 @@ static NTSTATUS wg_parser_destroy(void *args)
     pthread_cond_destroy(&parser->read_cond);
     pthread_cond_destroy(&parser->read_done_cond);
 
+    for (i = 0; i < parser->read_block_count; ++i)
+        free(parser->read_blocks[i].data);
+    free(parser->read_blocks);
     free(parser);
     return S_OK;
 }
@@ -175,11 +175,73 @@ struct buffer
 {
     INSSBuffer INSSBuffer_iface;
     LONG refcount;
+    struct buffer_pool *pool;
 
     DWORD size, capacity;
     BYTE data[1];
 };
 
+/* The pool is referenced by its stream and by every buffer handed out, so
+ * that samples may be released after the reader is closed. */
+struct buffer_pool
+{
+    LONG refcount;
+    CRITICAL_SECTION cs;
+    bool active;
+    struct buffer *buffers[4];
+    unsigned int count;
+};
+
+static void flush_buffer_pool(struct buffer_pool *pool)
+{
+    EnterCriticalSection(&pool->cs);
+    while (pool->count)
+        free(pool->buffers[--pool->count]);
+    LeaveCriticalSection(&pool->cs);
+}
+
+static void buffer_pool_release(struct buffer_pool *pool)
+{
+    if (!InterlockedDecrement(&pool->refcount))
+    {
+        flush_buffer_pool(pool);
+        pool->cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection(&pool->cs);
+        free(pool);
+    }
+}
+
+static struct buffer_pool *create_buffer_pool(void)
+{
+    struct buffer_pool *pool;
+
+    if (!(pool = calloc(1, sizeof(*pool))))
+        return NULL;
+
+    pool->refcount = 1;
+    pool->active = true;
+    InitializeCriticalSection(&pool->cs);
+    pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": buffer_pool.cs");
+    return pool;
+}
+
+static void put_pool_buffer(struct buffer *buffer)
+{
+    struct buffer_pool *pool = buffer->pool;
+
+    EnterCriticalSection(&pool->cs);
+    if (pool->active && pool->count < ARRAY_SIZE(pool->buffers))
+    {
+        TRACE("Returning buffer %p to pool %p.\n", buffer, pool);
+        pool->buffers[pool->count++] = buffer;
+        buffer = NULL;
+    }
+    LeaveCriticalSection(&pool->cs);
+
+    free(buffer);
+    buffer_pool_release(pool);
+}
+
 static struct buffer *impl_from_INSSBuffer(INSSBuffer *iface)
 {
     return CONTAINING_RECORD(iface, struct buffer, INSSBuffer_iface);
@@ -222,7 +284,12 @@ static ULONG WINAPI buffer_Release(INSSBuffer *iface)
     TRACE("%p decreasing refcount to %u.\n", buffer, refcount);
 
     if (!refcount)
-        free(buffer);
+    {
+        if (buffer->pool)
+            put_pool_buffer(buffer);
+        else
+            free(buffer);
+    }
 
     return refcount;
 }
@@ -289,6 +356,63 @@ static const INSSBufferVtbl buffer_vtbl =
     buffer_GetBufferAndLength,
 };
 
+static HRESULT get_pool_buffer(struct wm_stream *stream, DWORD size, INSSBuffer **ret)
+{
+    struct buffer_pool *pool = stream->buffer_pool;
+    struct buffer *object = NULL;
+
+    if (pool)
+    {
+        EnterCriticalSection(&pool->cs);
+        while (pool->count && !object)
+        {
+            object = pool->buffers[--pool->count];
+            if (object->capacity < size)
+            {
+                /* The format changed, drop the buffer. */
+                free(object);
+                object = NULL;
+            }
+        }
+        LeaveCriticalSection(&pool->cs);
+    }
+
+    if (object)
+        TRACE("Reusing buffer %p.\n", object);
+    else
+    {
+        /* The whole buffer is written by the sample data, don't clear it. */
+        if (!(object = malloc(offsetof(struct buffer, data[size]))))
+            return E_OUTOFMEMORY;
+
+        object->INSSBuffer_iface.lpVtbl = &buffer_vtbl;
+        object->pool = pool;
+        object->capacity = size;
+        TRACE("Created buffer %p.\n", object);
+    }
+
+    if (pool)
+        InterlockedIncrement(&pool->refcount);
+    object->refcount = 1;
+    object->size = 0;
+    *ret = &object->INSSBuffer_iface;
+    return S_OK;
+}
+
+static void release_buffer_pool(struct wm_stream *stream)
+{
+    struct buffer_pool *pool;
+
+    if (!(pool = stream->buffer_pool))
+        return;
+
+    EnterCriticalSection(&pool->cs);
+    pool->active = false;
+    LeaveCriticalSection(&pool->cs);
+    buffer_pool_release(pool);
+    stream->buffer_pool = NULL;
+}
+
 struct stream_config
 {
     IWMStreamConfig IWMStreamConfig_iface;
@@ -1486,6 +1610,7 @@ static HRESULT init_stream(struct wm_reader *reader, QWORD file_size)
 
         stream->wg_stream = wg_parser_get_stream(reader->wg_parser, reader->stream_count - i - 1);
         stream->reader = reader;
+        stream->buffer_pool = create_buffer_pool();
         stream->index = i;
         stream->selection = WMT_ON;
         wg_parser_stream_get_preferred_format(stream->wg_stream, &stream->format);
@@ -1603,6 +1728,8 @@ HRESULT wm_reader_open_file(struct wm_reader *reader, const WCHAR *filename)
 
 HRESULT wm_reader_close(struct wm_reader *reader)
 {
+    WORD i;
+
     EnterCriticalSection(&reader->cs);
 
     if (!reader->wg_parser)
@@ -1622,6 +1749,9 @@ HRESULT wm_reader_close(struct wm_reader *reader)
         IWMReaderCallbackAdvanced_Release(reader->callback_advanced);
     reader->callback_advanced = NULL;
 
+    for (i = 0; i < reader->stream_count; ++i)
+        release_buffer_pool(&reader->streams[i]);
+
     wg_parser_destroy(reader->wg_parser);
     reader->wg_parser = NULL;
 
@@ -1912,6 +2042,8 @@ HRESULT wm_reader_get_stream_sample(struct wm_reader *reader, WORD stream_number
             if (!wg_parser_stream_get_buffer(wg_stream, &wg_buffer))
             {
                 stream->eos = true;
+                if (stream->buffer_pool)
+                    flush_buffer_pool(stream->buffer_pool);
                 TRACE("End of stream.\n");
                 return NS_E_NO_MORE_SAMPLES;
             }
@@ -1939,23 +2071,10 @@ HRESULT wm_reader_get_stream_sample(struct wm_reader *reader, WORD stream_number
                 return hr;
             }
         }
-        else
+        else if (FAILED(hr = get_pool_buffer(stream, wg_buffer.size, &sample)))
         {
-            struct buffer *object;
-
-            /* FIXME: Should these be pooled? */
-            if (!(object = calloc(1, offsetof(struct buffer, data[wg_buffer.size]))))
-            {
-                wg_parser_stream_release_buffer(wg_stream);
-                return E_OUTOFMEMORY;
-            }
-
-            object->INSSBuffer_iface.lpVtbl = &buffer_vtbl;
-            object->refcount = 1;
-            object->capacity = wg_buffer.size;
-
-            TRACE("Created buffer %p.\n", object);
-            sample = &object->INSSBuffer_iface;
+            wg_parser_stream_release_buffer(wg_stream);
+            return hr;
         }
 
         if (FAILED(hr = INSSBuffer_GetBufferAndLength(sample, &data, &size)))
@@ -2008,7 +2127,11 @@ void wm_reader_seek(struct wm_reader *reader, QWORD start, LONGLONG duration)
             AM_SEEKING_AbsolutePositioning, duration ? AM_SEEKING_AbsolutePositioning : AM_SEEKING_NoPositioning);
 
     for (i = 0; i < reader->stream_count; ++i)
+    {
         reader->streams[i].eos = false;
+        if (reader->streams[i].buffer_pool)
+            flush_buffer_pool(reader->streams[i].buffer_pool);
+    }
 
     LeaveCriticalSection(&reader->cs);
 }
@@ -245,6 +245,24 @@ typedef struct
 } rectangle_t;
 
 
+typedef struct
+{
+    unsigned int   seq;
+    user_handle_t  handle;
+    user_handle_t  parent;
+    user_handle_t  owner;
+    unsigned int   style;
+    unsigned int   ex_style;
+    thread_id_t    tid;
+    process_id_t   pid;
+    unsigned int   dpi;
+    rectangle_t    window_rect;
+    rectangle_t    client_rect;
+} window_shm_t;
+
+#define WINDOW_SHM_ENTRIES ((LAST_USER_HANDLE - FIRST_USER_HANDLE + 1) >> 1)
+
+
 typedef struct
 {
     obj_handle_t    handle;
@@ -404,6 +422,38 @@ typedef struct
 
 #define MAX_ACL_LEN 65535
 
+
+#define REGISTRY_CACHE_SLOTS 16384
+
+
+#define DATA_WINDOW_THRESHOLD 0x10000
+#define DATA_WINDOW_MAX_SIZE  0x1000000
+
+
+typedef struct
+{
+    unsigned int   seq;
+    unsigned int   status;
+    apc_param_t    ckey;
+    apc_param_t    cvalue;
+    apc_param_t    information;
+} completion_packet_t;
+
+#define COMPLETION_SHM_PACKETS 1024
+
+
+typedef struct
+{
+    unsigned int   head;
+    unsigned int   tail;
+    unsigned int   futex;
+    unsigned int   waiters;
+    unsigned int   server_depth;
+    unsigned int   server_waiters;
+    unsigned int   __pad[2];
+    completion_packet_t packets[COMPLETION_SHM_PACKETS];
+} completion_shm_t;
+
 struct security_descriptor
 {
     unsigned int control;
@@ -977,6 +1027,18 @@ struct init_thread_reply
 
 
 
+struct set_data_window_request
+{
+    struct request_header __header;
+    data_size_t  size;
+};
+struct set_data_window_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct terminate_process_request
 {
     struct request_header __header;
@@ -1768,7 +1830,7 @@ struct recv_socket_request
     int          oob;
     async_data_t async;
     int          force_async;
-    char __pad_60[4];
+    int          direct;
 };
 struct recv_socket_reply
 {
@@ -1776,7 +1838,7 @@ struct recv_socket_reply
     obj_handle_t wait;
     unsigned int options;
     int          nonblocking;
-    char __pad_20[4];
+    int          direct;
 };
 
 
@@ -2291,11 +2353,27 @@ struct get_key_value_reply
     struct reply_header __header;
     int          type;
     data_size_t  total;
+    unsigned int cache_slot;
+    unsigned int cache_gen;
     /* VARARG(data,bytes); */
 };
 
 
 
+struct get_registry_cache_fd_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_registry_cache_fd_reply
+{
+    struct reply_header __header;
+    data_size_t  size;
+    char __pad_12[4];
+};
+
+
+
 struct enum_key_value_request
 {
     struct request_header __header;
@@ -5082,6 +5160,32 @@ struct remove_completion_reply
 
 
 
+struct get_completion_shm_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+};
+struct get_completion_shm_reply
+{
+    struct reply_header __header;
+    data_size_t   size;
+    char __pad_12[4];
+};
+
+
+
+struct wake_completion_request
+{
+    struct request_header __header;
+    obj_handle_t  handle;
+};
+struct wake_completion_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct query_completion_request
 {
     struct request_header __header;
@@ -5680,6 +5784,7 @@ enum request
     REQ_init_process_done,
     REQ_init_first_thread,
     REQ_init_thread,
+    REQ_set_data_window,
     REQ_terminate_process,
     REQ_terminate_thread,
     REQ_get_process_info,
@@ -5758,6 +5863,7 @@ enum request
     REQ_enum_key,
     REQ_set_key_value,
     REQ_get_key_value,
+    REQ_get_registry_cache_fd,
     REQ_enum_key_value,
     REQ_delete_key_value,
     REQ_load_registry,
@@ -5924,6 +6030,8 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_get_completion_shm,
+    REQ_wake_completion,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
@@ -5976,6 +6084,7 @@ union generic_request
     struct init_process_done_request init_process_done_request;
     struct init_first_thread_request init_first_thread_request;
     struct init_thread_request init_thread_request;
+    struct set_data_window_request set_data_window_request;
     struct terminate_process_request terminate_process_request;
     struct terminate_thread_request terminate_thread_request;
     struct get_process_info_request get_process_info_request;
@@ -6054,6 +6163,7 @@ union generic_request
     struct enum_key_request enum_key_request;
     struct set_key_value_request set_key_value_request;
     struct get_key_value_request get_key_value_request;
+    struct get_registry_cache_fd_request get_registry_cache_fd_request;
     struct enum_key_value_request enum_key_value_request;
     struct delete_key_value_request delete_key_value_request;
     struct load_registry_request load_registry_request;
@@ -6220,6 +6330,8 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct get_completion_shm_request get_completion_shm_request;
+    struct wake_completion_request wake_completion_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
@@ -6270,6 +6382,7 @@ union generic_reply
     struct init_process_done_reply init_process_done_reply;
     struct init_first_thread_reply init_first_thread_reply;
     struct init_thread_reply init_thread_reply;
+    struct set_data_window_reply set_data_window_reply;
     struct terminate_process_reply terminate_process_reply;
     struct terminate_thread_reply terminate_thread_reply;
     struct get_process_info_reply get_process_info_reply;
@@ -6348,6 +6461,7 @@ union generic_reply
     struct enum_key_reply enum_key_reply;
     struct set_key_value_reply set_key_value_reply;
     struct get_key_value_reply get_key_value_reply;
+    struct get_registry_cache_fd_reply get_registry_cache_fd_reply;
     struct enum_key_value_reply enum_key_value_reply;
     struct delete_key_value_reply delete_key_value_reply;
     struct load_registry_reply load_registry_reply;
@@ -6514,6 +6628,8 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct get_completion_shm_reply get_completion_shm_reply;
+    struct wake_completion_reply wake_completion_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
@@ -6556,7 +6672,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 762
+#define SERVER_PROTOCOL_VERSION 766
 
 /* ### protocol_version end ### */
 
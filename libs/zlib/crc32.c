@@ -44,6 +44,25 @@
 #  define TBLS 1
 #endif /* BYFOUR */
 
+/* Definitions for computing the crc with the instructions of the CPU. On x86
+   the carry-less multiplication is detected at run time, on ARM the crc32
+   instructions are used when the compiler targets them. */
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && \
+    !defined(NOHWCRC)
+#  include <cpuid.h>
+#  include <emmintrin.h>
+#  include <wmmintrin.h>
+#  define PCLMULCRC
+   local int pclmul_available OF((void));
+   local unsigned long crc32_pclmul OF((unsigned long,
+                        const unsigned char FAR *, z_size_t));
+#elif defined(__ARM_FEATURE_CRC32) && !defined(NOHWCRC)
+#  include <arm_acle.h>
+#  define ARMCRC
+   local unsigned long crc32_armv8 OF((unsigned long,
+                        const unsigned char FAR *, z_size_t));
+#endif
+
 /* Local functions for crc concatenation */
 local unsigned long gf2_matrix_times OF((unsigned long *mat,
                                          unsigned long vec));
@@ -211,6 +230,22 @@ unsigned long ZEXPORT crc32_z(crc, buf, len)
         make_crc_table();
 #endif /* DYNAMIC_CRC_TABLE */
 
+#ifdef ARMCRC
+    return crc32_armv8(crc, buf, len);
+#endif /* ARMCRC */
+
+#ifdef PCLMULCRC
+    /* fold all whole 16-byte blocks, leave the rest to the tables */
+    if (len >= 64 && pclmul_available()) {
+        z_size_t blocks = len & ~(z_size_t)15;
+
+        crc = crc32_pclmul(crc, buf, blocks);
+        buf += blocks;
+        len -= blocks;
+        if (len == 0) return crc;
+    }
+#endif /* PCLMULCRC */
+
 #ifdef BYFOUR
     if (sizeof(void *) == sizeof(ptrdiff_t)) {
         z_crc_t endian;
@@ -338,6 +373,142 @@ local unsigned long crc32_big(crc, buf, len)
 
 #endif /* BYFOUR */
 
+#ifdef PCLMULCRC
+
+/*
+   This folds the data into four 128-bit accumulators using carry-less
+   multiplication and reduces them to the crc with a Barrett reduction, as
+   described in "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+   Instruction" by Gopal et al. The constants are the bit-reflected values
+   x^(4*128+32) mod p, x^(4*128-32) mod p, x^(128+32) mod p, x^(128-32) mod p,
+   x^64 mod p, and the Barrett constants floor(x^64 / p) and p. len must be a
+   multiple of 16 and at least 64.
+ */
+
+/* ========================================================================= */
+local int pclmul_available()
+{
+    static volatile int available = -1;
+    unsigned int eax, ebx, ecx, edx;
+
+    if (available == -1)
+        /* PCLMULQDQ is bit 1 of ecx, SSE2 bit 26 of edx */
+        available = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+                    (ecx & (1U << 1)) && (edx & (1U << 26));
+    return available;
+}
+
+/* ========================================================================= */
+local unsigned long __attribute__((target("pclmul,sse2")))
+crc32_pclmul(crc, buf, len)
+    unsigned long crc;
+    const unsigned char FAR *buf;
+    z_size_t len;
+{
+    __m128i k, x0, x1, x2, x3, y0, y1, y2, y3, mask;
+
+    x0 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128((int)(crc ^ 0xffffffffUL)));
+    buf += 64;
+    len -= 64;
+
+    /* fold 64 bytes at a time into the four accumulators */
+    k = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    while (len >= 64) {
+        y0 = _mm_clmulepi64_si128(x0, k, 0x00);
+        y1 = _mm_clmulepi64_si128(x1, k, 0x00);
+        y2 = _mm_clmulepi64_si128(x2, k, 0x00);
+        y3 = _mm_clmulepi64_si128(x3, k, 0x00);
+        x0 = _mm_clmulepi64_si128(x0, k, 0x11);
+        x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k, 0x11);
+        x0 = _mm_xor_si128(_mm_xor_si128(x0, y0),
+                 _mm_loadu_si128((const __m128i *)(buf + 0x00)));
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, y1),
+                 _mm_loadu_si128((const __m128i *)(buf + 0x10)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, y2),
+                 _mm_loadu_si128((const __m128i *)(buf + 0x20)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, y3),
+                 _mm_loadu_si128((const __m128i *)(buf + 0x30)));
+        buf += 64;
+        len -= 64;
+    }
+
+    /* fold the accumulators into one, then 16 bytes at a time */
+    k = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    y0 = _mm_clmulepi64_si128(x0, k, 0x00);
+    x0 = _mm_clmulepi64_si128(x0, k, 0x11);
+    x0 = _mm_xor_si128(_mm_xor_si128(x0, y0), x1);
+    y0 = _mm_clmulepi64_si128(x0, k, 0x00);
+    x0 = _mm_clmulepi64_si128(x0, k, 0x11);
+    x0 = _mm_xor_si128(_mm_xor_si128(x0, y0), x2);
+    y0 = _mm_clmulepi64_si128(x0, k, 0x00);
+    x0 = _mm_clmulepi64_si128(x0, k, 0x11);
+    x0 = _mm_xor_si128(_mm_xor_si128(x0, y0), x3);
+    while (len >= 16) {
+        y0 = _mm_clmulepi64_si128(x0, k, 0x00);
+        x0 = _mm_clmulepi64_si128(x0, k, 0x11);
+        x0 = _mm_xor_si128(_mm_xor_si128(x0, y0),
+                 _mm_loadu_si128((const __m128i *)buf));
+        buf += 16;
+        len -= 16;
+    }
+
+    /* reduce 128 bits to 64 bits */
+    mask = _mm_set_epi32(0, ~0, 0, ~0);
+    x1 = _mm_clmulepi64_si128(x0, k, 0x10);
+    x0 = _mm_xor_si128(_mm_srli_si128(x0, 8), x1);
+    k = _mm_set_epi64x(0, 0x0163cd6124LL);
+    x1 = _mm_srli_si128(x0, 4);
+    x0 = _mm_clmulepi64_si128(_mm_and_si128(x0, mask), k, 0x00);
+    x0 = _mm_xor_si128(x0, x1);
+
+    /* Barrett reduction to 32 bits */
+    k = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x0, mask), k, 0x10);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x00);
+    x0 = _mm_xor_si128(x0, x1);
+
+    return (unsigned long)(unsigned)_mm_cvtsi128_si32(_mm_srli_si128(x0, 4)) ^
+           0xffffffffUL;
+}
+
+#endif /* PCLMULCRC */
+
+#ifdef ARMCRC
+
+/* ========================================================================= */
+local unsigned long crc32_armv8(crc, buf, len)
+    unsigned long crc;
+    const unsigned char FAR *buf;
+    z_size_t len;
+{
+    register unsigned c;
+    unsigned long long word;
+
+    c = (unsigned)crc ^ 0xffffffffU;
+    while (len && ((ptrdiff_t)buf & 7)) {
+        c = __crc32b(c, *buf++);
+        len--;
+    }
+    while (len >= 8) {
+        zmemcpy(&word, buf, sizeof(word));
+        c = __crc32d(c, word);
+        buf += 8;
+        len -= 8;
+    }
+    if (len) do {
+        c = __crc32b(c, *buf++);
+    } while (--len);
+    return (unsigned long)(c ^ 0xffffffffU);
+}
+
+#endif /* ARMCRC */
+
 #define GF2_DIM 32      /* dimension of GF(2) vectors (length of CRC) */
 
 /* ========================================================================= */
@@ -100,6 +100,17 @@ local  void check_match OF((deflate_state *s, IPos start, IPos match,
                             int length));
 #endif
 
+/* longest_match() compares the strings with wide loads where possible */
+#if !defined(UNALIGNED_OK) && defined(__GNUC__)
+#  if defined(__SSE2__)
+#    include <emmintrin.h>
+#    define MATCH_SSE2
+#  elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ \
+        && __SIZEOF_POINTER__ == 8
+#    define MATCH_WORDS
+#  endif
+#endif
+
 /* ===========================================================================
  * Local data
  */
@@ -1341,6 +1352,36 @@ local uInt longest_match(s, cur_match)
         scan += 2, match++;
         Assert(*scan == *match, "match[2]?");
 
+#if defined(MATCH_SSE2)
+        /* Compare 16 bytes at a time at strstart+3, +19, ... up to
+         * strstart+243, which reads the same bytes as the loop below.
+         */
+        do {
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+                           _mm_loadu_si128((const __m128i *)(scan + 1)),
+                           _mm_loadu_si128((const __m128i *)(match + 1))));
+            if (mask != 0xffff) {
+                scan += 1 + __builtin_ctz(~mask);
+                break;
+            }
+            scan += 16, match += 16;
+        } while (scan < strend);
+#elif defined(MATCH_WORDS)
+        /* Compare 8 bytes at a time at strstart+3, +11, ... up to
+         * strstart+251, which reads the same bytes as the loop below.
+         */
+        do {
+            unsigned long long a, b;
+
+            zmemcpy(&a, scan + 1, sizeof(a));
+            zmemcpy(&b, match + 1, sizeof(b));
+            if (a != b) {
+                scan += 1 + (__builtin_ctzll(a ^ b) >> 3);
+                break;
+            }
+            scan += 8, match += 8;
+        } while (scan < strend);
+#else
         /* We check for insufficient lookahead only every 8th comparison;
          * the 256th check will be made at strstart+258.
          */
@@ -1350,6 +1391,7 @@ local uInt longest_match(s, cur_match)
                  *++scan == *++match && *++scan == *++match &&
                  *++scan == *++match && *++scan == *++match &&
                  scan < strend);
+#endif
 
         Assert(scan <= s->window+(unsigned)(s->window_size-1), "wild scan");
 
@@ -12,6 +12,52 @@
 #  pragma message("Assembler code may have bugs -- use at your own risk")
 #else
 
+/* Size of the chunks copied at once when a match does not overlap them */
+#define CHUNK 8
+
+/*
+   Copy len bytes of a match dist bytes back. When the distance is at least
+   CHUNK, no chunk read can see bytes written by the same chunk, so the match
+   is copied a chunk at a time with a fixed size memcpy() that compilers turn
+   into a single load and store. A distance of one is a run of a single byte,
+   which compilers turn into a memset(). The copy never writes past out + len.
+ */
+local unsigned char FAR *copy_match(out, from, len, dist)
+    unsigned char FAR *out;
+    const unsigned char FAR *from;
+    unsigned len;
+    unsigned dist;
+{
+    if (dist >= CHUNK) {
+        while (len >= CHUNK) {
+            zmemcpy(out, from, CHUNK);
+            out += CHUNK;
+            from += CHUNK;
+            len -= CHUNK;
+        }
+    }
+    else if (dist == 1) {
+        unsigned char c = *from;
+
+        do {
+            *out++ = c;
+        } while (--len);
+        return out;
+    }
+    while (len > 2) {
+        *out++ = *from++;
+        *out++ = *from++;
+        *out++ = *from++;
+        len -= 3;
+    }
+    if (len) {
+        *out++ = *from++;
+        if (len > 1)
+            *out++ = *from++;
+    }
+    return out;
+}
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -201,9 +247,8 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                         from += wsize - op;
                         if (op < len) {         /* some from window */
                             len -= op;
-                            do {
-                                *out++ = *from++;
-                            } while (--op);
+                            zmemcpy(out, from, op);
+                            out += op;
                             from = out - dist;  /* rest from output */
                         }
                     }
@@ -212,16 +257,14 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                         op -= wnext;
                         if (op < len) {         /* some from end of window */
                             len -= op;
-                            do {
-                                *out++ = *from++;
-                            } while (--op);
+                            zmemcpy(out, from, op);
+                            out += op;
                             from = window;
                             if (wnext < len) {  /* some from start of window */
                                 op = wnext;
                                 len -= op;
-                                do {
-                                    *out++ = *from++;
-                                } while (--op);
+                                zmemcpy(out, from, op);
+                                out += op;
                                 from = out - dist;      /* rest from output */
                             }
                         }
@@ -230,37 +273,17 @@ unsigned start;         /* inflate()'s starting value for strm->avail_out */
                         from += wnext - op;
                         if (op < len) {         /* some from window */
                             len -= op;
-                            do {
-                                *out++ = *from++;
-                            } while (--op);
+                            zmemcpy(out, from, op);
+                            out += op;
                             from = out - dist;  /* rest from output */
                         }
                     }
-                    while (len > 2) {
-                        *out++ = *from++;
-                        *out++ = *from++;
-                        *out++ = *from++;
-                        len -= 3;
-                    }
-                    if (len) {
-                        *out++ = *from++;
-                        if (len > 1)
-                            *out++ = *from++;
-                    }
+                    if (len)
+                        out = copy_match(out, from, len, dist);
                 }
                 else {
                     from = out - dist;          /* copy direct from output */
-                    do {                        /* minimum length is three */
-                        *out++ = *from++;
-                        *out++ = *from++;
-                        *out++ = *from++;
-                        len -= 3;
-                    } while (len > 2);
-                    if (len) {
-                        *out++ = *from++;
-                        if (len > 1)
-                            *out++ = *from++;
-                    }
+                    out = copy_match(out, from, len, dist);
                 }
             }
             else if ((op & 64) == 0) {          /* 2nd level distance code */
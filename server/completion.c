@@ -28,8 +28,14 @@
 
 #include "config.h"
 
+#include <limits.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -58,12 +64,17 @@ struct type_descr completion_type =
 
 struct completion
 {
-    struct object  obj;
-    struct list    queue;
-    unsigned int   depth;
+    struct object     obj;
+    struct list       queue;
+    unsigned int      depth;
+    completion_shm_t *shm;      /* queue shared with the clients */
+    int               shm_fd;   /* unix fd of the shared queue */
+    int               shm_broken; /* shared queue left inconsistent by a client, no longer used */
 };
 
 static void completion_dump( struct object*, int );
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void completion_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void completion_destroy( struct object * );
 
@@ -72,8 +83,8 @@ static const struct object_ops completion_ops =
     sizeof(struct completion), /* size */
     &completion_type,          /* type */
     completion_dump,           /* dump */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    completion_add_queue,      /* add_queue */
+    completion_remove_queue,   /* remove_queue */
     completion_signaled,       /* signaled */
     NULL,                      /* get_esync_fd */
     NULL,                      /* get_msync_idx */
@@ -111,6 +122,144 @@ static void completion_destroy( struct object *obj)
     {
         free( tmp );
     }
+    if (completion->shm)
+    {
+        munmap( completion->shm, sizeof(*completion->shm) );
+        close( completion->shm_fd );
+    }
+}
+
+#ifdef __APPLE__
+#define UL_COMPARE_AND_WAIT_SHARED  0x3
+#define ULF_WAKE_ALL                0x00000100
+#define ULF_NO_ERRNO                0x01000000
+extern int __ulock_wake( uint32_t operation, void *addr, uint64_t wake_value );
+#endif
+
+/* wake up one or all of the clients waiting on the shared queue */
+static void wake_shm_waiters( completion_shm_t *shm, int all )
+{
+#ifdef __linux__
+    syscall( __NR_futex, &shm->futex, 1 /* FUTEX_WAKE */, all ? INT_MAX : 1, NULL, 0, 0 );
+#elif defined(__APPLE__)
+    __ulock_wake( UL_COMPARE_AND_WAIT_SHARED | ULF_NO_ERRNO | (all ? ULF_WAKE_ALL : 0), (void *)&shm->futex, 0 );
+#endif
+}
+
+/* Clients can write anything to the shared queue, so the server never trusts it to be
+ * consistent. Each attempt that fails because of another thread means that thread made
+ * progress, so a bounded number of attempts is plenty; running out of them means that
+ * the queue is corrupted. */
+#define SHM_MAX_ATTEMPTS COMPLETION_SHM_PACKETS
+
+/* add a packet to the shared queue; same algorithm as in ntdll
+ * returns 1 on success, 0 if the queue is full and -1 if it is corrupted */
+static int shm_add_packet( completion_shm_t *shm, apc_param_t ckey, apc_param_t cvalue,
+                           unsigned int status, apc_param_t information )
+{
+    unsigned int attempts, pos = __atomic_load_n( &shm->tail, __ATOMIC_RELAXED );
+    completion_packet_t *packet;
+
+    for (attempts = 0;; attempts++)
+    {
+        int diff;
+
+        if (attempts == SHM_MAX_ATTEMPTS) return -1;
+        packet = &shm->packets[pos % COMPLETION_SHM_PACKETS];
+        diff = __atomic_load_n( &packet->seq, __ATOMIC_ACQUIRE ) - pos;
+        if (diff < 0) return 0;  /* full */
+        if (!diff && __atomic_compare_exchange_n( &shm->tail, &pos, pos + 1, 0,
+                                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED )) break;
+        if (diff) pos = __atomic_load_n( &shm->tail, __ATOMIC_RELAXED );
+    }
+    packet->ckey        = ckey;
+    packet->cvalue      = cvalue;
+    packet->status      = status;
+    packet->information = information;
+    __atomic_store_n( &packet->seq, pos + 1, __ATOMIC_RELEASE );
+
+    __atomic_add_fetch( &shm->futex, 1, __ATOMIC_SEQ_CST );
+    if (__atomic_load_n( &shm->waiters, __ATOMIC_SEQ_CST )) wake_shm_waiters( shm, 0 );
+    return 1;
+}
+
+/* remove a packet from the shared queue; same algorithm as in ntdll
+ * returns 1 on success, 0 if the queue is empty and -1 if it is corrupted */
+static int shm_remove_packet( completion_shm_t *shm, struct comp_msg *msg )
+{
+    unsigned int attempts, pos = __atomic_load_n( &shm->head, __ATOMIC_RELAXED );
+    completion_packet_t *packet;
+
+    for (attempts = 0;; attempts++)
+    {
+        int diff;
+
+        if (attempts == SHM_MAX_ATTEMPTS) return -1;
+        packet = &shm->packets[pos % COMPLETION_SHM_PACKETS];
+        diff = __atomic_load_n( &packet->seq, __ATOMIC_ACQUIRE ) - (pos + 1);
+        if (diff < 0) return 0;  /* empty */
+        if (!diff && __atomic_compare_exchange_n( &shm->head, &pos, pos + 1, 0,
+                                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED )) break;
+        if (diff) pos = __atomic_load_n( &shm->head, __ATOMIC_RELAXED );
+    }
+    msg->ckey        = packet->ckey;
+    msg->cvalue      = packet->cvalue;
+    msg->status      = packet->status;
+    msg->information = packet->information;
+    __atomic_store_n( &packet->seq, pos + COMPLETION_SHM_PACKETS, __ATOMIC_RELEASE );
+    return 1;
+}
+
+static unsigned int shm_depth( const completion_shm_t *shm )
+{
+    int depth = __atomic_load_n( &shm->tail, __ATOMIC_ACQUIRE ) - __atomic_load_n( &shm->head, __ATOMIC_ACQUIRE );
+    return depth > 0 ? depth : 0;
+}
+
+/* check whether the shared queue of a completion port is in use */
+static int use_shm( const struct completion *completion )
+{
+    return completion->shm && !completion->shm_broken;
+}
+
+/* tell the clients about the packets left in the server queue */
+static void update_server_depth( struct completion *completion )
+{
+    /* a queue that never drains sends the clients of a broken queue to the server */
+    __atomic_store_n( &completion->shm->server_depth,
+                      completion->shm_broken ? ~0u : completion->depth, __ATOMIC_RELEASE );
+}
+
+/* stop using a shared queue that has been corrupted, the server queue takes over */
+static void set_shm_broken( struct completion *completion )
+{
+    if (debug_level) fprintf( stderr, "wineserver: corrupted completion port queue, using the server queue\n" );
+    completion->shm_broken = 1;
+    update_server_depth( completion );
+    /* wake up the clients waiting on the shared queue, they will find the server queue */
+    __atomic_add_fetch( &completion->shm->futex, 1, __ATOMIC_SEQ_CST );
+    wake_shm_waiters( completion->shm, 1 );
+}
+
+/* move the packets queued in the server to the shared queue, as long as there is room */
+static void flush_server_queue( struct completion *completion )
+{
+    struct comp_msg *msg, *next;
+    int ret;
+
+    LIST_FOR_EACH_ENTRY_SAFE( msg, next, &completion->queue, struct comp_msg, queue_entry )
+    {
+        if (completion->shm_broken) break;
+        if ((ret = shm_add_packet( completion->shm, msg->ckey, msg->cvalue, msg->status, msg->information )) <= 0)
+        {
+            if (ret < 0) set_shm_broken( completion );
+            break;
+        }
+        list_remove( &msg->queue_entry );
+        completion->depth--;
+        free( msg );
+    }
+    update_server_depth( completion );
 }
 
 static void completion_dump( struct object *obj, int verbose )
@@ -121,10 +270,28 @@ static void completion_dump( struct object *obj, int verbose )
     fprintf( stderr, "Completion depth=%u\n", completion->depth );
 }
 
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct completion *completion = (struct completion *)obj;
+
+    /* clients posting to the shared queue need to wake us up */
+    if (completion->shm) __atomic_add_fetch( &completion->shm->server_waiters, 1, __ATOMIC_SEQ_CST );
+    return add_queue( obj, entry );
+}
+
+static void completion_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct completion *completion = (struct completion *)obj;
+
+    if (completion->shm) __atomic_sub_fetch( &completion->shm->server_waiters, 1, __ATOMIC_SEQ_CST );
+    remove_queue( obj, entry );
+}
+
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct completion *completion = (struct completion *)obj;
 
+    if (use_shm( completion ) && shm_depth( completion->shm )) return 1;
     return !list_empty( &completion->queue );
 }
 
@@ -140,6 +307,9 @@ static struct completion *create_completion( struct object *root, const struct u
         {
             list_init( &completion->queue );
             completion->depth = 0;
+            completion->shm = NULL;
+            completion->shm_fd = -1;
+            completion->shm_broken = 0;
         }
     }
 
@@ -154,9 +324,21 @@ struct completion *get_completion_obj( struct process *process, obj_handle_t han
 void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
                      unsigned int status, apc_param_t information )
 {
-    struct comp_msg *msg = mem_alloc( sizeof( *msg ) );
+    struct comp_msg *msg;
+    int ret;
+
+    /* keep the packets in order, the server queue is only used when the shared one is full */
+    if (use_shm( completion ) && list_empty( &completion->queue ))
+    {
+        if ((ret = shm_add_packet( completion->shm, ckey, cvalue, status, information )) > 0)
+        {
+            wake_up( &completion->obj, 1 );
+            return;
+        }
+        if (ret < 0) set_shm_broken( completion );
+    }
 
-    if (!msg)
+    if (!(msg = mem_alloc( sizeof( *msg ) )))
         return;
 
     msg->ckey = ckey;
@@ -166,6 +348,7 @@ void add_completion( struct completion *completion, apc_param_t ckey, apc_param_
 
     list_add_tail( &completion->queue, &msg->queue_entry );
     completion->depth++;
+    if (completion->shm) update_server_depth( completion );
     wake_up( &completion->obj, 1 );
 }
 
@@ -216,12 +399,23 @@ DECL_HANDLER(remove_completion)
 {
     struct completion* completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
     struct list *entry;
-    struct comp_msg *msg;
+    struct comp_msg *msg, shm_msg;
+    int ret = 0;
 
     if (!completion) return;
 
+    if (use_shm( completion ) && (ret = shm_remove_packet( completion->shm, &shm_msg )) < 0)
+        set_shm_broken( completion );
     entry = list_head( &completion->queue );
-    if (!entry)
+    if (ret > 0)
+    {
+        reply->ckey = shm_msg.ckey;
+        reply->cvalue = shm_msg.cvalue;
+        reply->status = shm_msg.status;
+        reply->information = shm_msg.information;
+        flush_server_queue( completion );
+    }
+    else if (!entry)
         set_error( STATUS_PENDING );
     else
     {
@@ -233,11 +427,49 @@ DECL_HANDLER(remove_completion)
         reply->status = msg->status;
         reply->information = msg->information;
         free( msg );
+        if (completion->shm) flush_server_queue( completion );
     }
 
     release_object( completion );
 }
 
+/* get the shared memory queue of a completion port */
+DECL_HANDLER(get_completion_shm)
+{
+    struct completion *completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+
+    if (!completion) return;
+
+#if defined(__linux__) || defined(__APPLE__)
+    if (!completion->shm && (completion->shm = create_shared_memory( sizeof(*completion->shm), &completion->shm_fd )))
+    {
+        unsigned int i;
+
+        for (i = 0; i < COMPLETION_SHM_PACKETS; i++) completion->shm->packets[i].seq = i;
+        completion->shm->server_waiters = list_count( &completion->obj.wait_queue );
+        flush_server_queue( completion );
+    }
+    if (completion->shm)
+    {
+        reply->size = sizeof(*completion->shm);
+        send_client_fd( current->process, completion->shm_fd, current->id );
+    }
+#else
+    set_error( STATUS_NOT_SUPPORTED );
+#endif
+    release_object( completion );
+}
+
+/* wake up the threads waiting on a completion port in the server */
+DECL_HANDLER(wake_completion)
+{
+    struct completion *completion = get_completion_obj( current->process, req->handle, IO_COMPLETION_MODIFY_STATE );
+
+    if (!completion) return;
+    wake_up( &completion->obj, 0 );
+    release_object( completion );
+}
+
 /* get queue depth for completion port */
 DECL_HANDLER(query_completion)
 {
@@ -246,6 +478,7 @@ DECL_HANDLER(query_completion)
     if (!completion) return;
 
     reply->depth = completion->depth;
+    if (use_shm( completion )) reply->depth += shm_depth( completion->shm );
 
     release_object( completion );
 }
@@ -654,16 +654,45 @@ static inline void main_loop_epoll(void)
 
 static int kqueue_fd = -1;
 
+/* changes are queued and submitted together with the next wait */
+static struct kevent kqueue_changes[128];
+static int kqueue_change_count;
+
 static inline void init_epoll(void)
 {
     kqueue_fd = kqueue();
 }
 
+static void kqueue_error(void)
+{
+    if (errno == ENOMEM)  /* not enough memory, give up on kqueue */
+    {
+        close( kqueue_fd );
+        kqueue_fd = -1;
+    }
+    else perror( "kevent" );  /* should not happen */
+}
+
+/* submit the queued changes without waiting */
+static void flush_kqueue_changes(void)
+{
+    int count = kqueue_change_count;
+
+    kqueue_change_count = 0;
+    if (count && kevent( kqueue_fd, kqueue_changes, count, NULL, 0, NULL ) == -1) kqueue_error();
+}
+
 static inline void set_fd_epoll_events( struct fd *fd, int user, int events )
 {
-    struct kevent ev[2];
+    struct kevent *ev;
 
     if (kqueue_fd == -1) return;
+    if (kqueue_change_count == ARRAY_SIZE( kqueue_changes ))
+    {
+        flush_kqueue_changes();
+        if (kqueue_fd == -1) return;
+    }
+    ev = kqueue_changes + kqueue_change_count;
 
     EV_SET( &ev[0], fd->unix_fd, EVFILT_READ, 0, NOTE_LOWAT, 1, (void *)(long)user );
     EV_SET( &ev[1], fd->unix_fd, EVFILT_WRITE, 0, NOTE_LOWAT, 1, (void *)(long)user );
@@ -685,22 +714,17 @@ static inline void set_fd_epoll_events( struct fd *fd, int user, int events )
         ev[0].flags |= (events & POLLIN) ? EV_ENABLE : EV_DISABLE;
         ev[1].flags |= (events & POLLOUT) ? EV_ENABLE : EV_DISABLE;
     }
-
-    if (kevent( kqueue_fd, ev, 2, NULL, 0, NULL ) == -1)
-    {
-        if (errno == ENOMEM)  /* not enough memory, give up on kqueue */
-        {
-            close( kqueue_fd );
-            kqueue_fd = -1;
-        }
-        else perror( "kevent" );  /* should not happen */
-    }
+    kqueue_change_count += 2;
 }
 
 static inline void remove_epoll_user( struct fd *fd, int user )
 {
     if (kqueue_fd == -1) return;
 
+    /* the queued changes refer to the unix fd, which is about to be closed and reused */
+    flush_kqueue_changes();
+    if (kqueue_fd == -1) return;
+
     if (pollfd[user].fd != -1)
     {
         struct kevent ev[2];
@@ -713,7 +737,7 @@ static inline void remove_epoll_user( struct fd *fd, int user )
 
 static inline void main_loop_epoll(void)
 {
-    int i, ret, timeout;
+    int i, ret, timeout, count;
     struct kevent events[128];
 
     if (kqueue_fd == -1) return;
@@ -725,18 +749,27 @@ static inline void main_loop_epoll(void)
         if (!active_users) break;  /* last user removed by a timeout */
         if (kqueue_fd == -1) break;  /* an error occurred with kqueue */
 
+        count = kqueue_change_count;
+        kqueue_change_count = 0;
         if (timeout != -1)
         {
             struct timespec ts;
 
             ts.tv_sec = timeout / 1000;
             ts.tv_nsec = (timeout % 1000) * 1000000;
-            ret = kevent( kqueue_fd, NULL, 0, events, ARRAY_SIZE( events ), &ts );
+            ret = kevent( kqueue_fd, kqueue_changes, count, events, ARRAY_SIZE( events ), &ts );
         }
-        else ret = kevent( kqueue_fd, NULL, 0, events, ARRAY_SIZE( events ), NULL );
+        else ret = kevent( kqueue_fd, kqueue_changes, count, events, ARRAY_SIZE( events ), NULL );
 
         set_current_time();
 
+        if (ret == -1)
+        {
+            if (errno == EINTR) continue;
+            kqueue_error();
+            continue;
+        }
+
         /* put the events into the pollfd array first, like poll does */
         for (i = 0; i < ret; i++)
         {
@@ -746,11 +779,18 @@ static inline void main_loop_epoll(void)
         for (i = 0; i < ret; i++)
         {
             long user = (long)events[i].udata;
+
+            if (events[i].flags & EV_ERROR)  /* a queued change failed */
+            {
+                errno = events[i].data;
+                kqueue_error();
+                continue;
+            }
             if (events[i].filter == EVFILT_READ) pollfd[user].revents |= POLLIN;
             else if (events[i].filter == EVFILT_WRITE) pollfd[user].revents |= POLLOUT;
             if (events[i].flags & EV_EOF) pollfd[user].revents |= POLLHUP;
-            if (events[i].flags & EV_ERROR) pollfd[user].revents |= POLLERR;
         }
+        if (kqueue_fd == -1) break;
 
         /* read events from the pollfd array, as set_fd_events may modify them */
         for (i = 0; i < ret; i++)
@@ -186,6 +186,10 @@ extern struct mapping *create_fd_mapping( struct object *root, const struct unic
                                           unsigned int attr, const struct security_descriptor *sd );
 extern struct object *create_user_data_mapping( struct object *root, const struct unicode_str *name,
                                                 unsigned int attr, const struct security_descriptor *sd );
+extern struct object *create_shared_mapping( struct object *root, const struct unicode_str *name,
+                                             mem_size_t size, void **ptr );
+extern void *create_shared_memory( data_size_t size, int *unix_fd );
+extern void *create_read_only_shared_memory( data_size_t size, int *client_fd );
 extern struct mapping *create_mapping( struct object *root, const struct unicode_str *name,
                                        unsigned int attr, mem_size_t size, unsigned int flags,
                                        obj_handle_t handle, unsigned int file_access,
@@ -1140,6 +1140,67 @@ struct object *create_user_data_mapping( struct object *root, const struct unico
     return &mapping->obj;
 }
 
+/* create a named mapping shared with the clients that is also mapped in the server */
+struct object *create_shared_mapping( struct object *root, const struct unicode_str *name,
+                                      mem_size_t size, void **ptr )
+{
+    struct mapping *mapping;
+
+    if (!(mapping = create_mapping( root, name, OBJ_PERMANENT, size, SEC_COMMIT, 0,
+                                    FILE_READ_DATA | FILE_WRITE_DATA, NULL ))) return NULL;
+    *ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (*ptr == MAP_FAILED) *ptr = NULL;
+    return &mapping->obj;
+}
+
+/* create an anonymous shared memory area that can be passed to clients */
+void *create_shared_memory( data_size_t size, int *unix_fd )
+{
+    void *ptr;
+    int fd;
+
+    if ((fd = create_temp_file( size, NULL )) == -1) return NULL;
+    ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    if (ptr == MAP_FAILED)
+    {
+        file_set_error();
+        close( fd );
+        return NULL;
+    }
+    *unix_fd = fd;
+    return ptr;
+}
+
+/* create shared memory that the clients can only map for reading */
+void *create_read_only_shared_memory( data_size_t size, int *client_fd )
+{
+    char name[16];
+    void *ptr;
+    int fd;
+
+    if ((fd = create_temp_file( size, name )) == -1) return NULL;
+    if (temp_dir_fd != server_dir_fd) fchdir( temp_dir_fd );
+    *client_fd = open( name, O_RDONLY );
+    if (temp_dir_fd != server_dir_fd) fchdir( server_dir_fd );
+    unlink_temp_file( name );
+
+    if (*client_fd == -1)
+    {
+        file_set_error();
+        close( fd );
+        return NULL;
+    }
+    ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if (ptr == MAP_FAILED)
+    {
+        file_set_error();
+        close( *client_fd );
+        return NULL;
+    }
+    return ptr;
+}
+
 /* create a file mapping */
 DECL_HANDLER(create_mapping)
 {
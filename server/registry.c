@@ -36,6 +36,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <sys/mman.h>
 
 #if defined(__APPLE__) && defined(__x86_64__)
 #include <sys/utsname.h>
@@ -78,6 +79,112 @@ struct type_descr key_type =
     },
 };
 
+/*
+ * The binary hive format is an optional cache of a text registry branch that
+ * can be mapped directly into memory. Keys loaded from a hive only get their
+ * subkeys and values created the first time they are accessed. The text file
+ * remains authoritative: the hive records the identity of the text file it
+ * was generated from and is ignored if the text file has changed since, or
+ * if any part of the hive is invalid.
+ */
+
+#define HIVE_MAGIC   0x56494857  /* 'WHIV' */
+#define HIVE_VERSION 1
+
+/* binary hive file header */
+struct hive_header
+{
+    unsigned int magic;        /* HIVE_MAGIC */
+    unsigned int version;      /* HIVE_VERSION */
+    unsigned int size;         /* total size of the hive file */
+    unsigned int root;         /* offset of the root key node */
+    unsigned int prefix_type;  /* architecture of the prefix */
+    unsigned int reg_ino;      /* inode of the text file */
+    timeout_t    reg_size;     /* size of the text file */
+    timeout_t    reg_mtime;    /* modification time of the text file */
+};
+
+/* a key node in a binary hive */
+struct hive_key
+{
+    timeout_t    modif;        /* last modification time */
+    unsigned int flags;        /* saved key flags */
+    unsigned int name;         /* offset of key name */
+    unsigned int class;        /* offset of key class */
+    unsigned int namelen;      /* length of key name */
+    unsigned int classlen;     /* length of class name */
+    unsigned int subkey_count; /* number of subkeys */
+    unsigned int subkeys;      /* offset of the sorted array of subkey node offsets */
+    unsigned int value_count;  /* number of values */
+    unsigned int values;       /* offset of the sorted array of values */
+};
+
+/* a value in a binary hive */
+struct hive_value
+{
+    unsigned int type;         /* value type */
+    unsigned int name;         /* offset of value name */
+    unsigned int namelen;      /* length of value name */
+    unsigned int data;         /* offset of value data */
+    data_size_t  len;          /* value data length in bytes */
+};
+
+#define HIVE_ALIGN     8
+#define HIVE_KEY_FLAGS (KEY_SYMLINK | KEY_WOW64)  /* key flags stored in a hive */
+
+/* a mapped binary hive */
+struct hive
+{
+    const char  *base;         /* start of the mapping */
+    size_t       size;         /* size of the mapping */
+};
+
+/*
+ * When journaling is enabled, changes to the saved registry branches are
+ * appended to a journal file next to the text file instead of rewriting the
+ * whole branch on every periodic save. The journal is only compacted into
+ * the text file once it grows too large, and on shutdown. Like the binary
+ * hive, the journal records the identity of the text file it applies to.
+ */
+
+#define JOURNAL_MAGIC   0x4e524a57  /* 'WJRN' */
+#define JOURNAL_VERSION 1
+
+/* journal operations */
+#define JOURNAL_CREATE_KEY   1
+#define JOURNAL_DELETE_KEY   2
+#define JOURNAL_SET_VALUE    3
+#define JOURNAL_DELETE_VALUE 4
+
+/* journal file header */
+struct journal_header
+{
+    unsigned int magic;        /* JOURNAL_MAGIC */
+    unsigned int version;      /* JOURNAL_VERSION */
+    unsigned int reg_ino;      /* inode of the text file */
+    unsigned int reserved;
+    timeout_t    reg_size;     /* size of the text file */
+    timeout_t    reg_mtime;    /* modification time of the text file */
+};
+
+/* a journal record, followed by the key path, the name and the data */
+struct journal_entry
+{
+    unsigned int checksum;     /* checksum of the rest of the record */
+    unsigned int op;           /* JOURNAL_xxx operation */
+    unsigned int size;         /* total size of the record */
+    unsigned int type;         /* value type, or key flags for JOURNAL_CREATE_KEY */
+    timeout_t    modif;        /* key modification time after the operation */
+    unsigned int pathlen;      /* length of key path relative to the branch */
+    unsigned int namelen;      /* length of value name, or key class for JOURNAL_CREATE_KEY */
+    data_size_t  len;          /* value data length */
+    unsigned int reserved;
+};
+
+#define JOURNAL_ALIGN       8
+#define JOURNAL_MAX_PENDING (1024 * 1024)  /* max size of records waiting for the flush timer */
+#define JOURNAL_MIN_COMPACT (1024 * 1024)  /* min journal size before compacting it */
+
 /* a registry key */
 struct key
 {
@@ -96,6 +203,9 @@ struct key
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
+    const struct hive *hive;       /* hive containing the not yet loaded subkeys and values */
+    const struct hive_key *hive_node; /* node of this key in the hive */
+    unsigned int      cache_slot;  /* slot in the registry cache counters */
 };
 
 /* key flags */
@@ -126,9 +236,16 @@ struct key_value
 /* the root of the registry tree */
 static struct key *root_key;
 
+/* generation counters used by clients to validate their cached values */
+static volatile unsigned int *cache_counters;
+static int cache_fd = -1;
+static unsigned int next_cache_slot;
+
 static const timeout_t ticks_1601_to_1970 = (timeout_t)86400 * (369 * 365 + 89) * TICKS_PER_SEC;
 static const timeout_t save_period = 30 * -TICKS_PER_SEC;  /* delay between periodic saves */
 static struct timeout_user *save_timeout_user;  /* saving timer */
+static const timeout_t journal_period = -TICKS_PER_SEC;  /* delay between journal flushes */
+static struct timeout_user *journal_timeout_user;  /* journal flush timer */
 static enum prefix_type { PREFIX_UNKNOWN, PREFIX_32BIT, PREFIX_64BIT } prefix_type;
 
 static const WCHAR root_name[] = { '\\','R','e','g','i','s','t','r','y','\\' };
@@ -138,18 +255,41 @@ static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_va
 
 static void set_periodic_save_timer(void);
 static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static int load_hive_key( struct key *key );
+static void journal_record( unsigned int op, const struct key *key, const struct unicode_str *name,
+                            unsigned int type, const void *data, data_size_t len );
+static void set_branch_unjournaled( const struct key *key );
+
+/* make sure the subkeys and values of a key loaded from a hive have been created */
+static inline int expand_key( const struct key *key )
+{
+    if (!key->hive) return 1;
+    return load_hive_key( (struct key *)key );
+}
 
 /* information about where to save a registry branch */
 struct save_branch_info
 {
     struct key  *key;
     const char  *path;
+    int          hive_stale;     /* binary hive needs to be rewritten */
+    int          journal_fd;     /* journal file, or -1 if changes are not journaled */
+    int          unjournaled;    /* branch has changes that are missing from the journal */
+    char        *journal_buf;    /* journal records not yet written to the file */
+    size_t       journal_len;    /* length of pending records */
+    size_t       journal_alloc;  /* allocated size of the pending records buffer */
+    file_pos_t   journal_size;   /* current size of the journal file */
+    file_pos_t   base_size;      /* size of the text file the journal applies to */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
 static int save_branch_count;
 static struct save_branch_info save_branch_info[MAX_SAVE_BRANCH_INFO];
 
+static int save_branch( struct save_branch_info *info );
+static unsigned int replay_journal( struct save_branch_info *info );
+static void reset_journal( struct save_branch_info *info );
+
 unsigned int supported_machines_count = 0;
 unsigned short supported_machines[8];
 unsigned short native_machine = 0;
@@ -207,6 +347,29 @@ static inline int is_wow6432node( const WCHAR *name, unsigned int len )
     return (len == sizeof(wow6432node) && !memicmp_strW( name, wow6432node, sizeof( wow6432node )));
 }
 
+/* return a pointer to a range of data in a hive, or NULL if it is invalid */
+static const void *get_hive_data( const struct hive *hive, unsigned int offset, data_size_t len )
+{
+    if (offset % HIVE_ALIGN) return NULL;
+    if (offset > hive->size || len > hive->size - offset) return NULL;
+    return hive->base + offset;
+}
+
+/* return a key node of a hive, or NULL if it is invalid */
+static const struct hive_key *get_hive_key( const struct hive *hive, unsigned int offset )
+{
+    const struct hive_key *node;
+
+    if (!(node = get_hive_data( hive, offset, sizeof(*node) ))) return NULL;
+    if (!get_hive_data( hive, node->name, node->namelen )) return NULL;
+    if (!get_hive_data( hive, node->class, node->classlen )) return NULL;
+    if (node->subkey_count > hive->size / sizeof(unsigned int)) return NULL;
+    if (!get_hive_data( hive, node->subkeys, node->subkey_count * sizeof(unsigned int) )) return NULL;
+    if (node->value_count > hive->size / sizeof(struct hive_value)) return NULL;
+    if (!get_hive_data( hive, node->values, node->value_count * sizeof(struct hive_value) )) return NULL;
+    return node;
+}
+
 /*
  * The registry text file format v2 used by this code is similar to the one
  * used by REGEDIT import/export functionality, with the following differences:
@@ -281,27 +444,99 @@ static void dump_value( const struct key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
+/* dump the modification time, class and options of a key to a text file */
+static void dump_key_info( timeout_t modif, const WCHAR *class, data_size_t classlen,
+                           unsigned int flags, FILE *f )
+{
+    fprintf( f, "] %u\n", (unsigned int)((modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
+    fprintf( f, "#time=%x%08x\n", (unsigned int)(modif >> 32), (unsigned int)modif );
+    if (class)
+    {
+        fprintf( f, "#class=\"" );
+        dump_strW( class, classlen, f, "\"\"" );
+        fprintf( f, "\"\n" );
+    }
+    if (flags & KEY_SYMLINK) fputs( "#link\n", f );
+}
+
+/* path of a hive node relative to the key it was loaded for */
+struct hive_path
+{
+    const struct hive_path *parent;  /* path of the parent node, NULL for the key node itself */
+    const struct hive_key  *node;    /* hive node */
+};
+
+/* dump the full path of a hive node */
+static void dump_hive_path( const struct hive *hive, const struct hive_path *path,
+                            const struct key *key, const struct key *base, FILE *f )
+{
+    if (!path->parent)
+    {
+        if (key != base) dump_path( key, base, f );
+        return;
+    }
+    dump_hive_path( hive, path->parent, key, base, f );
+    if (path->parent->parent || key != base) fprintf( f, "\\\\" );
+    dump_strW( (const WCHAR *)(hive->base + path->node->name), path->node->namelen, f, "[]" );
+}
+
+/* save a hive node and all its subkeys to a text file, without creating the keys */
+static void save_hive_subkeys( const struct hive *hive, const struct hive_path *path,
+                               const struct key *key, const struct key *base, FILE *f )
+{
+    const struct hive_key *node = path->node;
+    const unsigned int *subkeys = (const unsigned int *)(hive->base + node->subkeys);
+    const struct hive_value *values = (const struct hive_value *)(hive->base + node->values);
+    struct hive_path child;
+    struct key_value value;
+    unsigned int i;
+
+    if (node->value_count || !node->subkey_count || node->classlen || (node->flags & KEY_SYMLINK))
+    {
+        fprintf( f, "\n[" );
+        dump_hive_path( hive, path, key, base, f );
+        dump_key_info( node->modif, node->classlen ? (const WCHAR *)(hive->base + node->class) : NULL,
+                       node->classlen, node->flags, f );
+        for (i = 0; i < node->value_count; i++)
+        {
+            if (!get_hive_data( hive, values[i].name, values[i].namelen ) ||
+                !get_hive_data( hive, values[i].data, values[i].len ))
+                continue;
+            value.name    = (WCHAR *)(hive->base + values[i].name);
+            value.namelen = values[i].namelen;
+            value.type    = values[i].type;
+            value.len     = values[i].len;
+            value.data    = (void *)(hive->base + values[i].data);
+            dump_value( &value, f );
+        }
+    }
+    child.parent = path;
+    for (i = 0; i < node->subkey_count; i++)
+    {
+        if (!(child.node = get_hive_key( hive, subkeys[i] ))) continue;
+        save_hive_subkeys( hive, &child, key, base, f );
+    }
+}
+
 /* save a registry and all its subkeys to a text file */
 static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
     if (key->flags & KEY_VOLATILE) return;
+    if (key->hive)
+    {
+        struct hive_path path = { NULL, key->hive_node };
+        save_hive_subkeys( key->hive, &path, key, base, f );
+        return;
+    }
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
     {
         fprintf( f, "\n[" );
         if (key != base) dump_path( key, base, f );
-        fprintf( f, "] %u\n", (unsigned int)((key->modif - ticks_1601_to_1970) / TICKS_PER_SEC) );
-        fprintf( f, "#time=%x%08x\n", (unsigned int)(key->modif >> 32), (unsigned int)key->modif );
-        if (key->class)
-        {
-            fprintf( f, "#class=\"" );
-            dump_strW( key->class, key->classlen, f, "\"\"" );
-            fprintf( f, "\"\n" );
-        }
-        if (key->flags & KEY_SYMLINK) fputs( "#link\n", f );
+        dump_key_info( key->modif, key->class, key->classlen, key->flags, f );
         for (i = 0; i <= key->last_value; i++) dump_value( &key->values[i], f );
     }
     for (i = 0; i <= key->last_subkey; i++) save_subkeys( key->subkeys[i], base, f );
@@ -531,6 +766,9 @@ static struct key *alloc_key( const struct unicode_str *name, timeout_t modif )
         key->values      = NULL;
         key->modif       = modif;
         key->parent      = NULL;
+        key->hive        = NULL;
+        key->hive_node   = NULL;
+        key->cache_slot  = next_cache_slot++ % (REGISTRY_CACHE_SLOTS - 1) + 1;
         list_init( &key->notify_list );
         if (name->len && !(key->name = memdup( name->str, name->len )))
         {
@@ -576,6 +814,12 @@ static void check_notify( struct key *key, unsigned int change, int not_subtree
     }
 }
 
+/* invalidate the values of a key cached by the clients */
+static void invalidate_key_cache( struct key *key )
+{
+    if (cache_counters) cache_counters[key->cache_slot]++;
+}
+
 /* update key modification time */
 static void touch_key( struct key *key, unsigned int change )
 {
@@ -583,6 +827,7 @@ static void touch_key( struct key *key, unsigned int change )
 
     key->modif = current_time;
     make_dirty( key );
+    invalidate_key_cache( key );
 
     /* do notifications */
     check_notify( key, change, 1 );
@@ -658,6 +903,7 @@ static void free_subkey( struct key *parent, int index )
     parent->last_subkey--;
     key->flags |= KEY_DELETED;
     key->parent = NULL;
+    invalidate_key_cache( key );
     if (is_wow6432node( key->name, key->namelen )) parent->flags &= ~KEY_WOW64;
     release_object( key );
 
@@ -680,6 +926,9 @@ static struct key *find_subkey( const struct key *key, const struct unicode_str
     int i, min, max, res;
     data_size_t len;
 
+    *index = 0;
+    if (!expand_key( key )) return NULL;
+
     min = 0;
     max = key->last_subkey;
     while (min <= max)
@@ -813,7 +1062,7 @@ static struct key *create_key( struct key *key, const struct unicode_str *name,
                                const struct security_descriptor *sd, int *created )
 {
     int index;
-    struct unicode_str token, next;
+    struct unicode_str token, next, key_class;
 
     *created = 0;
     if (!(key = open_key_prefix( key, name, access, &token, &index ))) return NULL;
@@ -869,6 +1118,9 @@ static struct key *create_key( struct key *key, const struct unicode_str *name,
         free(key->class);
         if (!(key->class = memdup( class->str, key->classlen ))) key->classlen = 0;
     }
+    key_class.str = key->class;
+    key_class.len = key->classlen;
+    journal_record( JOURNAL_CREATE_KEY, key, &key_class, key->flags & KEY_SYMLINK, NULL, 0 );
     touch_key( key->parent, REG_NOTIFY_CHANGE_NAME );
     grab_object( key );
     return key;
@@ -933,6 +1185,8 @@ static void enum_key( struct key *key, int index, int info_class, struct enum_ke
         return;
     }
 
+    if (!expand_key( key )) return;
+
     if (index != -1)  /* -1 means use the specified key directly */
     {
         if ((index < 0) || (index > key->last_subkey))
@@ -941,6 +1195,9 @@ static void enum_key( struct key *key, int index, int info_class, struct enum_ke
             return;
         }
         key = key->subkeys[index];
+        if ((info_class == KeyFullInformation || info_class == KeyCachedInformation) &&
+            !expand_key( key ))
+            return;
     }
 
     namelen = key->namelen;
@@ -1033,6 +1290,7 @@ static int delete_key( struct key *key, int recurse )
         set_error( STATUS_INVALID_HANDLE );
         return -1;
     }
+    if (!expand_key( key )) return -1;
 
     while (recurse && (key->last_subkey>=0))
         if (0 > delete_key(key->subkeys[key->last_subkey], 1))
@@ -1050,6 +1308,7 @@ static int delete_key( struct key *key, int recurse )
     }
 
     if (debug_level > 1) dump_operation( key, NULL, "Delete" );
+    journal_record( JOURNAL_DELETE_KEY, key, NULL, 0, NULL, 0 );
     free_subkey( parent, index );
     touch_key( parent, REG_NOTIFY_CHANGE_NAME );
     return 0;
@@ -1086,6 +1345,9 @@ static struct key_value *find_value( const struct key *key, const struct unicode
     int i, min, max, res;
     data_size_t len;
 
+    *index = 0;
+    if (!expand_key( key )) return NULL;
+
     min = 0;
     max = key->last_value;
     while (min <= max)
@@ -1132,6 +1394,56 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
     return value;
 }
 
+/* create the subkeys and values of a key from its hive node */
+static int load_hive_key( struct key *key )
+{
+    const struct hive *hive = key->hive;
+    const struct hive_key *node = key->hive_node;
+    const unsigned int *subkeys = (const unsigned int *)(hive->base + node->subkeys);
+    const struct hive_value *values = (const struct hive_value *)(hive->base + node->values);
+    const struct hive_key *child;
+    struct key_value *value;
+    struct unicode_str name;
+    struct key *subkey;
+    unsigned int i;
+
+    key->hive = NULL;
+    key->hive_node = NULL;
+
+    for (i = 0; i < node->subkey_count; i++)
+    {
+        if (!(child = get_hive_key( hive, subkeys[i] ))) goto corrupt;
+        name.str = (const WCHAR *)(hive->base + child->name);
+        name.len = child->namelen;
+        if (!(subkey = alloc_subkey( key, &name, key->last_subkey + 1, child->modif ))) return 0;
+        subkey->flags |= child->flags & HIVE_KEY_FLAGS;
+        subkey->hive = hive;
+        subkey->hive_node = child;
+        if (child->classlen && (subkey->class = memdup( hive->base + child->class, child->classlen )))
+            subkey->classlen = child->classlen;
+    }
+
+    for (i = 0; i < node->value_count; i++)
+    {
+        if (!get_hive_data( hive, values[i].name, values[i].namelen ) ||
+            !get_hive_data( hive, values[i].data, values[i].len ))
+            goto corrupt;
+        name.str = (const WCHAR *)(hive->base + values[i].name);
+        name.len = values[i].namelen;
+        if (!(value = insert_value( key, &name, key->last_value + 1 ))) return 0;
+        value->type = values[i].type;
+        if (values[i].len && !(value->data = memdup( hive->base + values[i].data, values[i].len )))
+            return 0;
+        value->len = values[i].len;
+    }
+    return 1;
+
+ corrupt:
+    fprintf( stderr, "wineserver: corrupted registry hive, some keys could not be loaded\n" );
+    set_error( STATUS_REGISTRY_CORRUPT );
+    return 0;
+}
+
 /* set a key value */
 static void set_value( struct key *key, const struct unicode_str *name,
                        int type, const void *data, data_size_t len )
@@ -1183,6 +1495,7 @@ static void set_value( struct key *key, const struct unicode_str *name,
     value->len   = len;
     value->data  = ptr;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
+    journal_record( JOURNAL_SET_VALUE, key, name, type, data, len );
     if (debug_level > 1) dump_operation( key, value, "Set" );
 }
 
@@ -1223,6 +1536,8 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
         return;
     }
 
+    if (!expand_key( key )) return;
+
     if (i < 0 || i > key->last_value) set_error( STATUS_NO_MORE_ENTRIES );
     else
     {
@@ -1292,6 +1607,7 @@ static void delete_value( struct key *key, const struct unicode_str *name )
     for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
     key->last_value--;
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
+    journal_record( JOURNAL_DELETE_VALUE, key, name, 0, NULL, 0 );
 
     /* try to shrink the array */
     nb_values = key->nb_values;
@@ -1645,6 +1961,7 @@ static int load_value( struct key *key, const char *buffer, struct file_load_inf
     value->data = newptr;
     value->len  = len;
     value->type = type;
+    invalidate_key_cache( key );
     return 1;
 
  error:
@@ -1771,18 +2088,151 @@ static void load_registry( struct key *key, obj_handle_t handle )
         {
             load_keys( key, NULL, f, -1 );
             fclose( f );
+            /* loaded keys are not journaled, the branch has to be saved in full */
+            set_branch_unjournaled( key );
         }
         else file_set_error();
     }
 }
 
+/* check whether the binary hive cache is enabled */
+static int use_registry_hive(void)
+{
+    static int use_hive = -1;
+
+    if (use_hive == -1) use_hive = getenv( "WINEREGHIVE" ) && atoi( getenv( "WINEREGHIVE" ));
+    return use_hive;
+}
+
+/* check whether registry changes are journaled */
+static int use_registry_journal(void)
+{
+    static int use_journal = -1;
+
+    if (use_journal == -1) use_journal = getenv( "WINEREGJOURNAL" ) && atoi( getenv( "WINEREGJOURNAL" ));
+    return use_journal;
+}
+
+/* build the name of the binary hive corresponding to a text registry file */
+static char *get_hive_path( const char *filename )
+{
+    char *path;
+
+    if ((path = malloc( strlen(filename) + sizeof(".hive") ))) sprintf( path, "%s.hive", filename );
+    return path;
+}
+
+/* return the modification time of a file with the best available precision */
+static timeout_t get_file_mtime( const struct stat *st )
+{
+    timeout_t ret = (timeout_t)st->st_mtime * TICKS_PER_SEC;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    ret += st->st_mtim.tv_nsec / 100;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    ret += st->st_mtimespec.tv_nsec / 100;
+#endif
+    return ret;
+}
+
+#define MAX_HIVE_DEPTH 512  /* maximum nesting of keys in a hive */
+
+/* check that a hive node and all its subkeys and values are valid */
+static int validate_hive_key( const struct hive *hive, const struct hive_key *node,
+                              unsigned int depth, unsigned int *count )
+{
+    const unsigned int *subkeys = (const unsigned int *)(hive->base + node->subkeys);
+    const struct hive_value *values = (const struct hive_value *)(hive->base + node->values);
+    const struct hive_key *child;
+    unsigned int i;
+
+    /* a node can't be reached more often than there is room for nodes, which catches loops */
+    if (depth > MAX_HIVE_DEPTH || ++*count > hive->size / sizeof(*node)) return 0;
+
+    for (i = 0; i < node->value_count; i++)
+    {
+        if (!get_hive_data( hive, values[i].name, values[i].namelen ) ||
+            !get_hive_data( hive, values[i].data, values[i].len ))
+            return 0;
+    }
+    for (i = 0; i < node->subkey_count; i++)
+    {
+        if (!(child = get_hive_key( hive, subkeys[i] ))) return 0;
+        if (!validate_hive_key( hive, child, depth + 1, count )) return 0;
+    }
+    return 1;
+}
+
+/* map the binary hive of a registry file if it is still up to date */
+static int load_hive( struct key *key, const char *filename )
+{
+    const struct hive_header *header;
+    const struct hive_key *root;
+    struct hive *hive;
+    struct stat st, reg_st;
+    unsigned int count = 0;
+    char *path;
+    void *base;
+    int fd;
+
+    if (key->last_subkey != -1 || key->last_value != -1) return 0;
+    if (stat( filename, &reg_st ) == -1) return 0;
+    if (!(path = get_hive_path( filename ))) return 0;
+    fd = open( path, O_RDONLY );
+    free( path );
+    if (fd == -1) return 0;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) || st.st_size > UINT_MAX)
+    {
+        close( fd );
+        return 0;
+    }
+    base = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (base == MAP_FAILED) return 0;
+
+    header = base;
+    if (header->magic != HIVE_MAGIC || header->version != HIVE_VERSION || header->size != st.st_size)
+        goto failed;
+    if (header->reg_ino != (unsigned int)reg_st.st_ino || header->reg_size != reg_st.st_size ||
+        header->reg_mtime != get_file_mtime( &reg_st ))
+        goto failed;  /* text file has been modified */
+    if (header->prefix_type != PREFIX_UNKNOWN && prefix_type != PREFIX_UNKNOWN &&
+        header->prefix_type != prefix_type)
+        goto failed;
+
+    if (!(hive = mem_alloc( sizeof(*hive) ))) goto failed;
+    hive->base = base;
+    hive->size = st.st_size;
+    /* the whole hive is checked up front, so that a corrupted one is ignored
+     * in favor of the text file instead of leaving keys half loaded */
+    if (!(root = get_hive_key( hive, header->root )) || !validate_hive_key( hive, root, 0, &count ))
+    {
+        fprintf( stderr, "wineserver: ignoring corrupted registry hive for %s\n", filename );
+        free( hive );
+        goto failed;
+    }
+    if (prefix_type == PREFIX_UNKNOWN) prefix_type = header->prefix_type;
+    key->flags |= root->flags & HIVE_KEY_FLAGS;
+    key->hive = hive;
+    key->hive_node = root;
+    return 1;
+
+ failed:
+    munmap( base, st.st_size );
+    return 0;
+}
+
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
+    timeout_t start = monotonic_counter();
+    struct save_branch_info *info;
+    int loaded, from_hive = 0;
     FILE *f;
 
-    if ((f = fopen( filename, "r" )))
+    if (use_registry_hive() && load_hive( key, filename )) loaded = from_hive = 1;
+    else if ((f = fopen( filename, "r" )))
     {
+        loaded = 1;
         load_keys( key, filename, f, 0 );
         fclose( f );
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
@@ -1791,13 +2241,28 @@ static int load_init_registry_from_file( const char *filename, struct key *key )
             return 1;
         }
     }
+    else loaded = 0;
+
+    if (debug_level && loaded)
+        fprintf( stderr, "wineserver: loaded %s%s in %u ms\n", filename, from_hive ? " from hive" : "",
+                 (unsigned int)((monotonic_counter() - start) / 10000) );
 
     assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
-    save_branch_info[save_branch_count].path = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    info = &save_branch_info[save_branch_count++];
+    info->path = filename;
+    info->hive_stale = use_registry_hive() && !from_hive;
+    info->journal_fd = -1;
+    info->key = (struct key *)grab_object( key );
     make_object_permanent( &key->obj );
-    return (f != NULL);
+
+    if (use_registry_journal())
+    {
+        /* changes recovered from the journal are saved right away before starting a new one */
+        if (!replay_journal( info )) reset_journal( info );
+        else if (!save_branch( info )) info->unjournaled = 1;
+    }
+    return loaded;
 }
 
 static WCHAR *format_user_registry_path( const struct sid *sid, struct unicode_str *path )
@@ -2033,9 +2498,477 @@ static void save_registry( struct key *key, obj_handle_t handle )
     }
 }
 
+/* buffer used to build a binary hive */
+struct hive_buffer
+{
+    char        *data;   /* buffer data */
+    size_t       pos;    /* current end of data */
+    size_t       size;   /* allocated size */
+    int          error;  /* an allocation failed */
+};
+
+/* append data to a hive buffer and return its offset */
+static unsigned int hive_append( struct hive_buffer *buf, const void *data, size_t len )
+{
+    size_t pos = (buf->pos + HIVE_ALIGN - 1) & ~(size_t)(HIVE_ALIGN - 1);
+
+    if (buf->error) return 0;
+    if (pos + len > UINT_MAX)
+    {
+        buf->error = 1;
+        return 0;
+    }
+    if (pos + len > buf->size)
+    {
+        size_t new_size = max( buf->size * 2, pos + len );
+        char *new_data;
+
+        if (!(new_data = realloc( buf->data, new_size )))
+        {
+            buf->error = 1;
+            return 0;
+        }
+        buf->data = new_data;
+        buf->size = new_size;
+    }
+    memset( buf->data + buf->pos, 0, pos - buf->pos );
+    if (len) memcpy( buf->data + pos, data, len );
+    buf->pos = pos + len;
+    return pos;
+}
+
+/* copy a hive node and all its subkeys to a new hive */
+static unsigned int hive_copy_key( struct hive_buffer *buf, const struct hive *hive,
+                                   const struct hive_key *node )
+{
+    const unsigned int *subkeys = (const unsigned int *)(hive->base + node->subkeys);
+    const struct hive_value *values = (const struct hive_value *)(hive->base + node->values);
+    struct hive_key new_node = *node;
+    struct hive_value *new_values;
+    const struct hive_key *child;
+    unsigned int *new_subkeys;
+    unsigned int i;
+
+    new_subkeys = malloc( max( node->subkey_count, 1 ) * sizeof(*new_subkeys) );
+    new_values = malloc( max( node->value_count, 1 ) * sizeof(*new_values) );
+    if (!new_subkeys || !new_values) buf->error = 1;
+
+    for (i = 0; i < node->subkey_count && !buf->error; i++)
+    {
+        if (!(child = get_hive_key( hive, subkeys[i] ))) buf->error = 1;
+        else new_subkeys[i] = hive_copy_key( buf, hive, child );
+    }
+    for (i = 0; i < node->value_count && !buf->error; i++)
+    {
+        if (!get_hive_data( hive, values[i].name, values[i].namelen ) ||
+            !get_hive_data( hive, values[i].data, values[i].len ))
+            buf->error = 1;
+        new_values[i] = values[i];
+        new_values[i].name = hive_append( buf, hive->base + values[i].name, values[i].namelen );
+        new_values[i].data = hive_append( buf, hive->base + values[i].data, values[i].len );
+    }
+    if (!buf->error)
+    {
+        new_node.name = hive_append( buf, hive->base + node->name, node->namelen );
+        new_node.class = hive_append( buf, hive->base + node->class, node->classlen );
+        new_node.subkeys = hive_append( buf, new_subkeys, node->subkey_count * sizeof(*new_subkeys) );
+        new_node.values = hive_append( buf, new_values, node->value_count * sizeof(*new_values) );
+    }
+    free( new_subkeys );
+    free( new_values );
+    return hive_append( buf, &new_node, sizeof(new_node) );
+}
+
+/* write a key and all its subkeys to a new hive */
+static unsigned int hive_write_key( struct hive_buffer *buf, const struct key *key )
+{
+    struct hive_value *values;
+    struct hive_key node;
+    unsigned int *subkeys;
+    int i;
+
+    if (key->hive) return hive_copy_key( buf, key->hive, key->hive_node );
+
+    memset( &node, 0, sizeof(node) );
+    node.modif = key->modif;
+    node.flags = key->flags & KEY_SYMLINK;
+
+    subkeys = malloc( (key->last_subkey + 2) * sizeof(*subkeys) );
+    values = malloc( (key->last_value + 2) * sizeof(*values) );
+    if (!subkeys || !values) buf->error = 1;
+
+    for (i = 0; i <= key->last_subkey && !buf->error; i++)
+    {
+        const struct key *subkey = key->subkeys[i];
+
+        if (subkey->flags & KEY_VOLATILE) continue;
+        if (is_wow6432node( subkey->name, subkey->namelen ) && !is_wow6432node( key->name, key->namelen ))
+            node.flags |= KEY_WOW64;
+        subkeys[node.subkey_count++] = hive_write_key( buf, subkey );
+    }
+    for (i = 0; i <= key->last_value && !buf->error; i++)
+    {
+        struct hive_value *value = &values[node.value_count++];
+
+        value->type    = key->values[i].type;
+        value->namelen = key->values[i].namelen;
+        value->len     = key->values[i].len;
+        value->name    = hive_append( buf, key->values[i].name, key->values[i].namelen );
+        value->data    = hive_append( buf, key->values[i].data, key->values[i].len );
+    }
+    if (!buf->error)
+    {
+        node.namelen  = key->namelen;
+        node.classlen = key->class ? key->classlen : 0;
+        node.name     = hive_append( buf, key->name, node.namelen );
+        node.class    = hive_append( buf, key->class, node.classlen );
+        node.subkeys  = hive_append( buf, subkeys, node.subkey_count * sizeof(*subkeys) );
+        node.values   = hive_append( buf, values, node.value_count * sizeof(*values) );
+    }
+    free( subkeys );
+    free( values );
+    return hive_append( buf, &node, sizeof(node) );
+}
+
+/* save a registry branch to the binary hive next to its text file */
+static int save_hive( struct key *key, const char *path )
+{
+    struct hive_buffer buf = { NULL, 0, 0, 0 };
+    struct hive_header header;
+    struct stat st;
+    char *hive_path = NULL, *tmp = NULL;
+    size_t pos;
+    ssize_t count;
+    int fd, ret = 0;
+
+    /* the hive is only valid for the current version of the text file */
+    if (stat( path, &st ) == -1) return 0;
+
+    memset( &header, 0, sizeof(header) );
+    hive_append( &buf, &header, sizeof(header) );
+    header.root = hive_write_key( &buf, key );
+    if (buf.error)
+    {
+        free( buf.data );
+        return 0;
+    }
+    header.magic       = HIVE_MAGIC;
+    header.version     = HIVE_VERSION;
+    header.size        = buf.pos;
+    header.prefix_type = prefix_type;
+    header.reg_ino     = st.st_ino;
+    header.reg_size    = st.st_size;
+    header.reg_mtime   = get_file_mtime( &st );
+    memcpy( buf.data, &header, sizeof(header) );
+
+    if (!(hive_path = get_hive_path( path ))) goto done;
+    if (!(tmp = malloc( strlen(hive_path) + sizeof(".tmp") ))) goto done;
+    sprintf( tmp, "%s.tmp", hive_path );
+    if ((fd = open( tmp, O_CREAT | O_TRUNC | O_WRONLY, 0666 )) == -1) goto done;
+
+    for (pos = 0; pos < buf.pos; pos += count)
+        if ((count = write( fd, buf.data + pos, buf.pos - pos )) <= 0) break;
+
+    ret = !close( fd ) && pos == buf.pos && !rename( tmp, hive_path );
+    if (!ret) unlink( tmp );
+
+ done:
+    free( buf.data );
+    free( hive_path );
+    free( tmp );
+    return ret;
+}
+
+/* build the name of the journal corresponding to a text registry file */
+static char *get_journal_path( const char *filename )
+{
+    char *path;
+
+    if ((path = malloc( strlen(filename) + sizeof(".journal") ))) sprintf( path, "%s.journal", filename );
+    return path;
+}
+
+/* find the saved registry branch containing a key */
+static struct save_branch_info *get_key_branch( const struct key *key )
+{
+    int i;
+
+    for ( ; key; key = key->parent)
+        for (i = 0; i < save_branch_count; i++)
+            if (save_branch_info[i].key == key) return &save_branch_info[i];
+    return NULL;
+}
+
+/* compute the checksum of a journal record */
+static unsigned int journal_checksum( const struct journal_entry *entry )
+{
+    const unsigned char *p = (const unsigned char *)&entry->checksum + sizeof(entry->checksum);
+    size_t len = entry->size - sizeof(entry->checksum);
+    unsigned int sum = 0x811c9dc5;  /* FNV-1a */
+
+    while (len--) sum = (sum ^ *p++) * 0x01000193;
+    return sum;
+}
+
+/* write the pending journal records of a branch to disk */
+static void flush_journal( struct save_branch_info *info )
+{
+    size_t pos;
+    ssize_t count;
+
+    if (info->journal_fd == -1 || !info->journal_len) return;
+
+    for (pos = 0; pos < info->journal_len; pos += count)
+        if ((count = write( info->journal_fd, info->journal_buf + pos, info->journal_len - pos )) <= 0) break;
+
+    info->journal_size += pos;
+    if (pos < info->journal_len || fsync( info->journal_fd ))
+    {
+        /* the whole branch will have to be saved instead */
+        if (debug_level) fprintf( stderr, "wineserver: could not write registry journal for %s\n", info->path );
+        close( info->journal_fd );
+        info->journal_fd = -1;
+        info->unjournaled = 1;
+    }
+    info->journal_len = 0;
+}
+
+/* journal flush timer callback */
+static void journal_timeout( void *arg )
+{
+    int i;
+
+    journal_timeout_user = NULL;
+    for (i = 0; i < save_branch_count; i++) flush_journal( &save_branch_info[i] );
+}
+
+/* append a record for a registry change to the journal of its branch */
+static void journal_record( unsigned int op, const struct key *key, const struct unicode_str *name,
+                            unsigned int type, const void *data, data_size_t len )
+{
+    struct save_branch_info *info;
+    struct journal_entry *entry;
+    const struct key *parent;
+    data_size_t pathlen = 0, namelen = name ? name->len : 0;
+    size_t size, pos;
+    WCHAR *path;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if (!(info = get_key_branch( key )) || info->journal_fd == -1) return;
+
+    for (parent = key; parent != info->key; parent = parent->parent)
+        pathlen += parent->namelen + sizeof(WCHAR);
+    if (pathlen) pathlen -= sizeof(WCHAR);
+
+    size = (sizeof(*entry) + pathlen + namelen + len + JOURNAL_ALIGN - 1) & ~(size_t)(JOURNAL_ALIGN - 1);
+    if (info->journal_len + size > info->journal_alloc)
+    {
+        size_t new_size = max( max( info->journal_alloc * 2, info->journal_len + size ), 4096 );
+        char *new_buf;
+
+        if (!(new_buf = realloc( info->journal_buf, new_size )))
+        {
+            info->unjournaled = 1;
+            return;
+        }
+        info->journal_buf = new_buf;
+        info->journal_alloc = new_size;
+    }
+
+    entry = (struct journal_entry *)(info->journal_buf + info->journal_len);
+    memset( entry, 0, size );
+    entry->op      = op;
+    entry->size    = size;
+    entry->type    = type;
+    entry->modif   = current_time;
+    entry->pathlen = pathlen;
+    entry->namelen = namelen;
+    entry->len     = len;
+
+    /* store the key path, starting from the end */
+    path = (WCHAR *)(entry + 1);
+    pos = pathlen / sizeof(WCHAR);
+    for (parent = key; parent != info->key; parent = parent->parent)
+    {
+        pos -= parent->namelen / sizeof(WCHAR);
+        memcpy( path + pos, parent->name, parent->namelen );
+        if (pos) path[--pos] = '\\';
+    }
+    if (namelen) memcpy( (char *)path + pathlen, name->str, namelen );
+    if (len) memcpy( (char *)path + pathlen + namelen, data, len );
+    entry->checksum = journal_checksum( entry );
+    info->journal_len += size;
+
+    if (info->journal_len >= JOURNAL_MAX_PENDING) flush_journal( info );
+    else if (!journal_timeout_user)
+        journal_timeout_user = add_timeout_user( journal_period, journal_timeout, NULL );
+}
+
+/* record that a branch has changes that are missing from its journal */
+static void set_branch_unjournaled( const struct key *key )
+{
+    struct save_branch_info *info;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if ((info = get_key_branch( key ))) info->unjournaled = 1;
+}
+
+/* apply a journal record to a registry branch */
+static void replay_journal_entry( struct key *branch, const struct journal_entry *entry )
+{
+    const char *ptr = (const char *)(entry + 1);
+    struct unicode_str path, name;
+    struct key *key, *parent;
+
+    path.str = (const WCHAR *)ptr;
+    path.len = entry->pathlen;
+    name.str = (const WCHAR *)(ptr + entry->pathlen);
+    name.len = entry->namelen;
+
+    if (!path.len) key = (struct key *)grab_object( branch );
+    else if (!(key = create_key_recursive( branch, &path, entry->modif ))) goto done;
+    parent = key->parent;
+
+    switch (entry->op)
+    {
+    case JOURNAL_CREATE_KEY:
+        key->flags |= entry->type & KEY_SYMLINK;
+        if (name.len)
+        {
+            free( key->class );
+            if ((key->class = memdup( name.str, name.len ))) key->classlen = name.len;
+            else key->classlen = 0;
+        }
+        key->modif = entry->modif;
+        if (parent) parent->modif = entry->modif;
+        break;
+    case JOURNAL_DELETE_KEY:
+        if (key != branch) delete_key( key, 1 );
+        if (parent) parent->modif = entry->modif;
+        break;
+    case JOURNAL_SET_VALUE:
+        set_value( key, &name, entry->type, ptr + entry->pathlen + entry->namelen, entry->len );
+        key->modif = entry->modif;
+        break;
+    case JOURNAL_DELETE_VALUE:
+        delete_value( key, &name );
+        key->modif = entry->modif;
+        break;
+    }
+    release_object( key );
+
+ done:
+    make_dirty( branch );
+    clear_error();
+}
+
+/* replay the journal of a branch after loading its text file; return the number of records applied */
+static unsigned int replay_journal( struct save_branch_info *info )
+{
+    const struct journal_header *header;
+    const struct journal_entry *entry;
+    struct stat st, reg_st;
+    unsigned int count = 0;
+    size_t pos;
+    char *path, *data;
+    ssize_t ret;
+    int fd;
+
+    if (stat( info->path, &reg_st ) == -1) return 0;
+    if (!(path = get_journal_path( info->path ))) return 0;
+    fd = open( path, O_RDONLY );
+    free( path );
+    if (fd == -1) return 0;
+
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) || !(data = malloc( st.st_size )))
+    {
+        close( fd );
+        return 0;
+    }
+    for (pos = 0; pos < st.st_size; pos += ret)
+        if ((ret = read( fd, data + pos, st.st_size - pos )) <= 0) break;
+    close( fd );
+
+    header = (const struct journal_header *)data;
+    if (pos < sizeof(*header) || header->magic != JOURNAL_MAGIC || header->version != JOURNAL_VERSION ||
+        header->reg_ino != (unsigned int)reg_st.st_ino || header->reg_size != reg_st.st_size ||
+        header->reg_mtime != get_file_mtime( &reg_st ))
+        goto done;  /* journal doesn't apply to the current text file */
+
+    for (pos = sizeof(*header); pos + sizeof(*entry) <= st.st_size; pos += entry->size)
+    {
+        entry = (const struct journal_entry *)(data + pos);
+        if (entry->size < sizeof(*entry) || entry->size % JOURNAL_ALIGN) break;
+        if (entry->size > st.st_size - pos) break;
+        if (entry->checksum != journal_checksum( entry )) break;
+        if (entry->pathlen % sizeof(WCHAR) || entry->namelen % sizeof(WCHAR)) break;
+        if ((size_t)entry->pathlen + entry->namelen + entry->len > entry->size - sizeof(*entry)) break;
+        replay_journal_entry( info->key, entry );
+        count++;
+    }
+    if (debug_level && count)
+        fprintf( stderr, "wineserver: replayed %u journal records for %s\n", count, info->path );
+
+ done:
+    free( data );
+    return count;
+}
+
+/* start a new empty journal for a branch once its text file contains all the changes */
+static void reset_journal( struct save_branch_info *info )
+{
+    struct journal_header header;
+    struct stat st;
+    char *path, *tmp = NULL;
+    int fd = -1;
+
+    if (info->journal_fd != -1) close( info->journal_fd );
+    info->journal_fd   = -1;
+    info->journal_len  = 0;
+    info->journal_size = 0;
+    info->unjournaled  = 0;
+
+    if (stat( info->path, &st ) == -1) return;
+    if (!(path = get_journal_path( info->path ))) return;
+    if (!(tmp = malloc( strlen(path) + sizeof(".tmp") ))) goto done;
+    sprintf( tmp, "%s.tmp", path );
+
+    memset( &header, 0, sizeof(header) );
+    header.magic     = JOURNAL_MAGIC;
+    header.version   = JOURNAL_VERSION;
+    header.reg_ino   = st.st_ino;
+    header.reg_size  = st.st_size;
+    header.reg_mtime = get_file_mtime( &st );
+
+    if ((fd = open( tmp, O_CREAT | O_TRUNC | O_WRONLY, 0666 )) == -1) goto done;
+    if (write( fd, &header, sizeof(header) ) != sizeof(header) || fsync( fd ) || rename( tmp, path ))
+    {
+        close( fd );
+        unlink( tmp );
+        fd = -1;
+        goto done;
+    }
+    info->journal_fd   = fd;
+    info->journal_size = sizeof(header);
+    info->base_size    = st.st_size;
+
+ done:
+    free( path );
+    free( tmp );
+}
+
+/* check whether the changes to a branch are safely stored in its journal */
+static int is_branch_journaled( const struct save_branch_info *info )
+{
+    if (info->journal_fd == -1 || info->unjournaled) return 0;
+    return info->journal_size + info->journal_len < max( JOURNAL_MIN_COMPACT, info->base_size / 2 );
+}
+
 /* save a registry branch to a file */
-static int save_branch( struct key *key, const char *path )
+static int save_branch( struct save_branch_info *info )
 {
+    struct key *key = info->key;
+    const char *path = info->path;
     struct stat st;
     char *p, *tmp = NULL;
     int fd, count = 0, ret = 0;
@@ -2044,6 +2977,7 @@ static int save_branch( struct key *key, const char *path )
     if (!(key->flags & KEY_DIRTY))
     {
         if (debug_level > 1) dump_operation( key, NULL, "Not saving clean" );
+        if (info->hive_stale) info->hive_stale = !save_hive( key, path );
         return 1;
     }
 
@@ -2103,7 +3037,12 @@ static int save_branch( struct key *key, const char *path )
 
 done:
     free( tmp );
-    if (ret) make_clean( key );
+    if (ret)
+    {
+        make_clean( key );
+        if (use_registry_hive()) info->hive_stale = !save_hive( key, path );
+        if (use_registry_journal()) reset_journal( info );
+    }
     return ret;
 }
 
@@ -2115,7 +3054,11 @@ static void periodic_save( void *arg )
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
+    {
+        /* only compact the journal once it becomes too large */
+        if (is_branch_journaled( &save_branch_info[i] )) flush_journal( &save_branch_info[i] );
+        else save_branch( &save_branch_info[i] );
+    }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2135,7 +3078,7 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].path ))
+        if (!save_branch( &save_branch_info[i] ))
         {
             fprintf( stderr, "wineserver: could not save registry branch to %s",
                      save_branch_info[i].path );
@@ -2229,10 +3172,12 @@ DECL_HANDLER(delete_key)
 /* flush a registry key */
 DECL_HANDLER(flush_key)
 {
+    struct save_branch_info *info;
     struct key *key = get_hkey_obj( req->hkey, 0 );
     if (key)
     {
-        /* we don't need to do anything here with the current implementation */
+        /* changes are saved periodically, only pending journal records need to be written */
+        if ((info = get_key_branch( key ))) flush_journal( info );
         release_object( key );
     }
 }
@@ -2284,10 +3229,25 @@ DECL_HANDLER(get_key_value)
     if ((key = get_hkey_obj( req->hkey, KEY_QUERY_VALUE )))
     {
         get_value( key, &name, &reply->type, &reply->total );
+        if (cache_counters)
+        {
+            reply->cache_slot = key->cache_slot;
+            reply->cache_gen  = cache_counters[key->cache_slot];
+        }
         release_object( key );
     }
 }
 
+/* retrieve the fd of the registry cache counters */
+DECL_HANDLER(get_registry_cache_fd)
+{
+    data_size_t size = REGISTRY_CACHE_SLOTS * sizeof(*cache_counters);
+
+    if (!cache_counters && !(cache_counters = create_shared_memory( size, &cache_fd ))) return;
+    reply->size = size;
+    send_client_fd( current->process, cache_fd, current->id );
+}
+
 /* enumerate the value of a registry key */
 DECL_HANDLER(enum_key_value)
 {
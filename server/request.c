@@ -159,7 +159,9 @@ void fatal_error( const char *err, ... )
 void *set_reply_data_size( data_size_t size )
 {
     assert( size <= get_reply_max_size() );
-    if (size && !(current->reply_data = mem_alloc( size ))) size = 0;
+    if (size && use_data_window( current, get_reply_max_size() ))
+        current->reply_data = current->data_window;
+    else if (size && !(current->reply_data = mem_alloc( size ))) size = 0;
     current->reply_size = size;
     return current->reply_data;
 }
@@ -253,7 +255,19 @@ static void send_reply( union generic_reply *reply )
 {
     int ret;
 
-    if (!current->reply_size)
+    if (current->reply_size && use_data_window( current, get_reply_max_size() ))
+    {
+        /* the data is returned through the window, only the header goes through the pipe */
+        if (current->reply_data != current->data_window)
+        {
+            memcpy( current->data_window, current->reply_data, current->reply_size );
+            free( current->reply_data );
+        }
+        current->reply_data = NULL;
+        if ((ret = write( get_unix_fd( current->reply_fd ),
+                          reply, sizeof(*reply) )) != sizeof(*reply)) goto error;
+    }
+    else if (!current->reply_size)
     {
         if ((ret = write( get_unix_fd( current->reply_fd ),
                           reply, sizeof(*reply) )) != sizeof(*reply)) goto error;
@@ -3440,6 +3440,19 @@ struct object *create_socket_device( struct object *root, const struct unicode_s
     return create_named_object( root, &socket_device_ops, name, attr, sd );
 }
 
+/* check if an I/O on the socket can complete without anything to signal on completion */
+static int sock_can_complete_directly( struct fd *fd, const async_data_t *data )
+{
+    struct completion *completion;
+    apc_param_t key;
+
+    if (data->apc || data->event) return 0;
+    if (!data->apc_context || (get_fd_comp_flags( fd ) & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS)) return 1;
+    if (!(completion = fd_get_completion( fd, &key ))) return 1;
+    release_object( completion );
+    return 0;
+}
+
 DECL_HANDLER(recv_socket)
 {
     struct sock *sock = (struct sock *)get_handle_obj( current->process, req->async.handle, 0, &sock_ops );
@@ -3480,6 +3493,22 @@ DECL_HANDLER(recv_socket)
     sock->pending_events &= ~(req->oob ? AFD_POLL_OOB : AFD_POLL_READ);
     sock->reported_events &= ~(req->oob ? AFD_POLL_OOB : AFD_POLL_READ);
 
+    if (status == STATUS_ALERTED && req->direct && !req->force_async &&
+        sock_can_complete_directly( fd, &req->async ))
+    {
+        /* Nothing is queued before this request, and nobody has to be notified
+         * of its completion, so the client can receive the data itself without
+         * reporting the result back. */
+        set_error( status );
+        set_fd_signaled( fd, 1 );
+        sock_reselect( sock );
+        reply->options = get_fd_options( fd );
+        reply->nonblocking = sock->nonblocking;
+        reply->direct = 1;
+        release_object( sock );
+        return;
+    }
+
     if ((async = create_request_async( fd, get_fd_comp_flags( fd ), &req->async )))
     {
         set_error( status );
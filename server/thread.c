@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <time.h>
 #include <poll.h>
@@ -251,6 +252,8 @@ static inline void init_thread_structure( struct thread *thread )
     thread->req_toread      = 0;
     thread->reply_data      = NULL;
     thread->reply_towrite   = 0;
+    thread->data_window     = NULL;
+    thread->data_window_size = 0;
     thread->request_fd      = NULL;
     thread->reply_fd        = NULL;
     thread->wait_fd         = NULL;
@@ -426,6 +429,14 @@ static struct list *thread_get_kernel_obj_list( struct object *obj )
     return &thread->kernel_object;
 }
 
+/* unmap the shared memory window used for large reply data */
+static void free_data_window( struct thread *thread )
+{
+    munmap( thread->data_window, thread->data_window_size );
+    thread->data_window = NULL;
+    thread->data_window_size = 0;
+}
+
 /* cleanup everything that is no longer needed by a dead thread */
 /* used by destroy_thread and kill_thread */
 static void cleanup_thread( struct thread *thread )
@@ -441,6 +452,12 @@ static void cleanup_thread( struct thread *thread )
     }
     clear_apc_queue( &thread->system_apc );
     clear_apc_queue( &thread->user_apc );
+    if (thread->data_window)
+    {
+        /* the reply data may point into the window */
+        if (thread->reply_data == thread->data_window) thread->reply_data = NULL;
+        free_data_window( thread );
+    }
     free( thread->req_data );
     free( thread->reply_data );
     if (thread->request_fd) release_object( thread->request_fd );
@@ -1531,6 +1548,28 @@ DECL_HANDLER(init_thread)
     reply->suspend = (current->suspend || current->process->suspend || current->context != NULL);
 }
 
+/* set up the shared memory window used for large reply data */
+DECL_HANDLER(set_data_window)
+{
+    void *ptr;
+    int fd;
+
+    if (req->size && (req->size < DATA_WINDOW_THRESHOLD || req->size > DATA_WINDOW_MAX_SIZE))
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    if (current->data_window) free_data_window( current );
+    if (!req->size) return;
+
+    /* the client only gets a read-only fd, so that it can't truncate the window under us */
+    if (!(ptr = create_read_only_shared_memory( req->size, &fd ))) return;
+    current->data_window = ptr;
+    current->data_window_size = req->size;
+    send_client_fd( current->process, fd, current->id );
+    close( fd );
+}
+
 /* terminate a thread */
 DECL_HANDLER(terminate_thread)
 {
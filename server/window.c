@@ -196,6 +196,9 @@ static struct window *shell_listview;
 static struct window *progman_window;
 static struct window *taskman_window;
 
+/* snapshot of the window tree shared with the clients */
+static window_shm_t *window_shm;
+
 /* magic HWND_TOP etc. pointers */
 #define WINPTR_TOP       ((struct window *)1L)
 #define WINPTR_BOTTOM    ((struct window *)2L)
@@ -311,6 +314,55 @@ static rectangle_t union_rect( const rectangle_t *src1, const rectangle_t *src2
     return r;
 }
 
+/* create the mapping for the shared window snapshot */
+struct object *create_window_shm_mapping( struct object *root, const struct unicode_str *name )
+{
+    return create_shared_mapping( root, name, WINDOW_SHM_ENTRIES * sizeof(*window_shm), (void **)&window_shm );
+}
+
+static volatile window_shm_t *get_window_shm( user_handle_t handle )
+{
+    if (!window_shm) return NULL;
+    return &window_shm[((handle & 0xffff) - FIRST_USER_HANDLE) >> 1];
+}
+
+/* update the shared snapshot of a window; the sequence number is odd while it is modified */
+static void update_window_shm( struct window *win )
+{
+    volatile window_shm_t *shm = get_window_shm( win->handle );
+    unsigned int seq;
+
+    if (!shm) return;
+    seq = shm->seq;
+    shm->seq = seq + 1;
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    shm->handle      = win->handle;
+    shm->parent      = win->parent ? win->parent->handle : 0;
+    shm->owner       = win->owner;
+    shm->style       = win->style;
+    shm->ex_style    = win->ex_style;
+    shm->tid         = win->thread ? get_thread_id( win->thread ) : 0;
+    shm->pid         = win->thread ? get_process_id( win->thread->process ) : 0;
+    shm->dpi         = win->dpi;
+    shm->window_rect = win->window_rect;
+    shm->client_rect = win->client_rect;
+    __atomic_store_n( &shm->seq, seq + 2, __ATOMIC_RELEASE );
+}
+
+/* remove a window from the shared snapshot */
+static void clear_window_shm( struct window *win )
+{
+    volatile window_shm_t *shm = get_window_shm( win->handle );
+    unsigned int seq;
+
+    if (!shm) return;
+    seq = shm->seq;
+    shm->seq = seq + 1;
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+    shm->handle = 0;
+    __atomic_store_n( &shm->seq, seq + 2, __ATOMIC_RELEASE );
+}
+
 /* link a window at the right place in the siblings list */
 static void link_window( struct window *win, struct window *previous )
 {
@@ -364,6 +416,7 @@ static void link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    update_window_shm( win );
 }
 
 /* change the parent of a window (or unlink the window if the new parent is NULL) */
@@ -408,6 +461,7 @@ static int set_parent_window( struct window *win, struct window *parent )
         win->is_linked = 0;
         win->is_orphan = 1;
     }
+    update_window_shm( win );
     return 1;
 }
 
@@ -546,6 +600,7 @@ static void detach_window_thread( struct window *win )
     /* destroyed when the desktop ref count reaches zero */
     release_object( win->desktop );
     win->thread = NULL;
+    update_window_shm( win );
 }
 
 /* get the process owning the top window of a given desktop */
@@ -680,6 +735,7 @@ static struct window *create_window( struct window *parent, struct window *owner
     }
 
     current->desktop_users++;
+    update_window_shm( win );
     return win;
 
 failed:
@@ -1839,6 +1895,7 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (!(swp_flags & SWP_NOZORDER) && win->parent) link_window( win, previous );
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    update_window_shm( win );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -1853,6 +1910,7 @@ static void set_window_pos( struct window *win, struct window *previous,
             offset_rect( &child->visible_rect, new_size - old_size, 0 );
             offset_rect( &child->surface_rect, new_size - old_size, 0 );
             offset_rect( &child->client_rect, new_size - old_size, 0 );
+            update_window_shm( child );
         }
     }
 
@@ -2070,6 +2128,7 @@ void free_window_handle( struct window *win )
     detach_window_thread( win );
 
     if (win->parent) set_parent_window( win, NULL );
+    clear_window_shm( win );
     free_user_handle( win->handle );
     win->handle = 0;
     release_object( win );
@@ -2221,6 +2280,7 @@ DECL_HANDLER(create_window)
     }
     win->style = req->style;
     win->ex_style = req->ex_style;
+    update_window_shm( win );
 
     reply->handle    = win->handle;
     reply->parent    = win->parent ? win->parent->handle : 0;
@@ -2288,6 +2348,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->top_window );
             desktop->top_window->style  = WS_POPUP | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_window_shm( desktop->top_window );
         }
     }
 
@@ -2300,6 +2361,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->msg_window );
             desktop->msg_window->style = WS_POPUP | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_window_shm( desktop->msg_window );
         }
     }
 
@@ -2335,6 +2397,7 @@ DECL_HANDLER(set_window_owner)
 
     reply->prev_owner = win->owner;
     reply->full_owner = win->owner = owner ? owner->handle : 0;
+    update_window_shm( win );
 }
 
 
@@ -2406,6 +2469,7 @@ DECL_HANDLER(set_window_info)
     if (req->flags & SET_WIN_USERDATA) win->user_data = req->user_data;
     if (req->flags & SET_WIN_EXTRA) memcpy( win->extra_bytes + req->extra_offset,
                                             &req->extra_value, req->extra_size );
+    if (req->flags & (SET_WIN_STYLE | SET_WIN_EXSTYLE)) update_window_shm( win );
 
     /* changing window style triggers a non-client paint */
     if (req->flags & SET_WIN_STYLE) win->paint_flags |= PAINT_NONCLIENT;